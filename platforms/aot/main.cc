@@ -0,0 +1,266 @@
+#include "../../src/cpu/aot.h"
+#include "../../src/cpu/block_cache.h"
+#include "../../src/cpu/cpu.h"
+#include "../../src/cpu/opcode_names.h"
+#include "../../src/cartridge/cartridge_info.h"
+#include "../../src/cartridge/rom_image.h"
+#include "../../src/util/log.h"
+
+#include <cstdio>
+#include <map>
+#include <utility>
+#include <vector>
+
+/*
+ * gbemu-aot translates the code reachable in a ROM into a C++ file which,
+ * when it's built into a frontend along with gbemu-core, runs those blocks
+ * natively rather than through the interpreter (see src/cpu/aot.h).
+ *
+ * The ROM is walked from the entry point and the interrupt and RST vectors,
+ * following jumps, calls and fall-through. Code in 0x4000-0x7FFF is assumed to
+ * be in the bank mapped at power on, unless it's reached from code already in
+ * a switchable bank. Anything the walk misses is interpreted at runtime.
+ */
+
+const uint ROM_BANK_SIZE = 0x4000;
+const uint POWER_ON_ROM_BANK = 1;
+const uint INTERRUPT_COUNT = 5;
+
+struct Location {
+    uint bank;
+    u16 address;
+};
+
+class RomWalker {
+public:
+    RomWalker(const RomImage& inRom);
+
+    void add_root(u16 address);
+    void walk();
+
+    const std::map<uint, Block>& blocks() const { return decoded; }
+    uint bank_of(uint key) const { return key >> 16; }
+
+private:
+    u8 read(uint bank, u16 address) const;
+    void follow(const Location& from, u16 target);
+    void successors(const Location& location, const Block& block);
+
+    const RomImage& rom;
+
+    std::vector<Location> pending;
+    std::map<uint, Block> decoded;
+};
+
+RomWalker::RomWalker(const RomImage& inRom) :
+    rom(inRom)
+{
+}
+
+u8 RomWalker::read(const uint bank, const u16 address) const {
+    std::size_t offset = address < ROM_BANK_SIZE
+        ? address
+        : bank * ROM_BANK_SIZE + (address - ROM_BANK_SIZE);
+
+    return offset < rom.size() ? rom[offset] : 0xFF;
+}
+
+void RomWalker::add_root(const u16 address) {
+    pending.push_back({0, address});
+}
+
+void RomWalker::follow(const Location& from, const u16 target) {
+    /* Code in RAM may be modified, so it's always interpreted */
+    if (target >= 0x8000) { return; }
+
+    if (target < ROM_BANK_SIZE) {
+        pending.push_back({0, target});
+    } else {
+        uint bank = from.address < ROM_BANK_SIZE ? POWER_ON_ROM_BANK : from.bank;
+        pending.push_back({bank, target});
+    }
+}
+
+void RomWalker::successors(const Location& location, const Block& block) {
+    const DecodedInstruction& last = block.instructions.back();
+    const u16 next = block.end;
+
+    if (last.cb) {
+        follow(location, next);
+        return;
+    }
+
+    const OpcodeSpec& spec = opcode_specs[last.opcode];
+    bool conditional = spec.condition != Condition::Always;
+
+    switch (spec.operation) {
+        case Operation::JP:
+            /* JP (HL) can't be followed */
+            if (spec.src != Operand::Imm16) { return; }
+            follow(location, last.operand);
+            if (conditional) { follow(location, next); }
+            return;
+
+        case Operation::JR:
+            follow(location, static_cast<u16>(next + static_cast<s8>(last.operand)));
+            if (conditional) { follow(location, next); }
+            return;
+
+        case Operation::CALL:
+            follow(location, last.operand);
+            follow(location, next);
+            return;
+
+        case Operation::RST:
+            follow(location, spec.param);
+            follow(location, next);
+            return;
+
+        case Operation::RET:
+            if (conditional) { follow(location, next); }
+            return;
+
+        case Operation::RETI:
+        case Operation::UNDEFINED:
+            return;
+
+        default:
+            /* HALT, STOP, or a block which was cut short */
+            if (next < 0x8000) { follow(location, next); }
+            return;
+    }
+}
+
+void RomWalker::walk() {
+    while (!pending.empty()) {
+        Location location = pending.back();
+        pending.pop_back();
+
+        uint bank = location.address < ROM_BANK_SIZE ? 0 : location.bank;
+        uint key = block_key(bank, location.address);
+        if (decoded.count(key) != 0) { continue; }
+
+        /* Banks past the end of the ROM don't exist */
+        if (bank * ROM_BANK_SIZE >= rom.size() && bank != 0) { continue; }
+
+        uint region_end = location.address < ROM_BANK_SIZE ? ROM_BANK_SIZE : 0x8000;
+        auto read_bank = [this, bank](u16 address) { return read(bank, address); };
+
+        Block block;
+        if (!BlockCache::decode(read_bank, location.address, region_end, block)) { continue; }
+
+        successors({bank, location.address}, block);
+        decoded.emplace(key, std::move(block));
+    }
+}
+
+static std::string instruction_name(const DecodedInstruction& instruction) {
+    return instruction.cb
+        ? opcode_cb_names[instruction.opcode]
+        : opcode_names[instruction.opcode];
+}
+
+static std::size_t write_translation(FILE* file, const std::string& rom_name, u64 rom_hash, const RomWalker& walker) {
+    fprintf(file, "/* Generated by gbemu-aot from %s. Do not edit. */\n\n", rom_name.c_str());
+    fprintf(file, "#include \"cpu/aot.h\"\n");
+    fprintf(file, "#include \"cpu/opcode_handlers.h\"\n\n");
+    fprintf(file, "namespace {\n\n");
+
+    std::vector<std::pair<uint, NativeSpan>> translated;
+
+    for (const auto& entry : walker.blocks()) {
+        const Block& block = entry.second;
+
+        NativeSpan span = native_span(block);
+        if (span.length == 0) { continue; }
+
+        uint bank = walker.bank_of(entry.first);
+        fprintf(file, "uint block_%02X_%04X(CPU& cpu) {\n", bank, block.start);
+
+        for (uint i = 0; i < span.length; i++) {
+            const DecodedInstruction& instruction = block.instructions[i];
+            const OpcodeSpec& spec = instruction.cb
+                ? cb_opcode_specs[instruction.opcode]
+                : opcode_specs[instruction.opcode];
+
+            /* Memory which isn't plain is left to the interpreter */
+            if (touches_memory(spec)) {
+                fprintf(file, "    if (!aot::plain_memory<%s, 0x%02X>(cpu, 0x%04X)) { aot::set_pc(cpu, 0x%04X); return %u; }\n",
+                    instruction.cb ? "true" : "false", instruction.opcode, instruction.operand,
+                    instruction.address, i);
+            }
+
+            if (i == span.length - 1) {
+                fprintf(file, "    aot::set_pc(cpu, 0x%04X);\n", instruction.address + instruction.length);
+            }
+
+            fprintf(file, "    aot::execute<%s, 0x%02X>(cpu, 0x%04X); /* 0x%04X: %s */\n",
+                instruction.cb ? "true" : "false", instruction.opcode, instruction.operand,
+                instruction.address, instruction_name(instruction).c_str());
+        }
+
+        fprintf(file, "    return %u;\n", span.length);
+        fprintf(file, "}\n\n");
+        translated.emplace_back(entry.first, span);
+    }
+
+    fprintf(file, "const AotBlock blocks[] = {\n");
+
+    for (const auto& entry : translated) {
+        const Block& block = walker.blocks().at(entry.first);
+        const DecodedInstruction& last = block.instructions[entry.second.length - 1];
+
+        fprintf(file, "    { 0x%06X, &block_%02X_%04X, 0x%04X, %u, %u, %u },\n",
+            entry.first, walker.bank_of(entry.first), block.start,
+            last.address + last.length,
+            entry.second.length, entry.second.cycles, entry.second.cycles_branched);
+    }
+
+    fprintf(file, "};\n\n");
+    fprintf(file, "[[maybe_unused]] const bool registered = aot::register_program({\n");
+    fprintf(file, "    0x%016llXull, blocks, sizeof(blocks) / sizeof(blocks[0])\n",
+        static_cast<unsigned long long>(rom_hash));
+    fprintf(file, "});\n\n");
+    fprintf(file, "} // namespace\n");
+
+    return translated.size();
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        fatal_error("usage: gbemu-aot <rom_file> <output.cc>");
+    }
+
+    std::string rom_name = argv[1];
+    auto image = RomImage::load(rom_name);
+    const RomImage& rom = *image;
+
+    if (rom.size() < 0x8000) {
+        fatal_error("%s is too small to be a ROM", rom_name.c_str());
+    }
+
+    RomWalker walker(rom);
+
+    walker.add_root(header::entry_point);
+
+    for (uint interrupt = 0; interrupt < INTERRUPT_COUNT; interrupt++) {
+        walker.add_root(static_cast<u16>(INTERRUPT_VECTOR_BASE + interrupt * 8));
+    }
+
+    for (u16 vector : {rst::rst1, rst::rst2, rst::rst3, rst::rst4, rst::rst5, rst::rst6, rst::rst7, rst::rst8}) {
+        walker.add_root(vector);
+    }
+
+    walker.walk();
+
+    FILE* file = fopen(argv[2], "w");
+    if (file == nullptr) {
+        fatal_error("Unable to write to %s", argv[2]);
+    }
+
+    std::size_t translated = write_translation(file, rom_name, aot::hash_rom(rom), walker);
+    fclose(file);
+
+    log_info("Translated %zu of the %zu blocks reachable in %s", translated, walker.blocks().size(), rom_name.c_str());
+    return 0;
+}
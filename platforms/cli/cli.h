@@ -9,6 +9,17 @@ struct CliOptions {
 };
 
 CliOptions get_cli_options(int argc, char* argv[]);
+
+static std::string without_extension(const std::string& filename) {
+    std::size_t extension = filename.rfind('.');
+    std::size_t directory = filename.rfind('/');
+
+    if (extension == std::string::npos || (directory != std::string::npos && extension < directory)) {
+        return filename;
+    }
+
+    return filename.substr(0, extension);
+}
 CliOptions get_cli_options(int argc, char* argv[]) {
     if (argc < 2) {
         fatal_error("Please provide a ROM file to run");
@@ -27,6 +38,18 @@ CliOptions get_cli_options(int argc, char* argv[]) {
         else if (flag == "--whole-framebuffer") { cliOptions.options.show_full_framebuffer = true; }
         else if (flag == "--exit-on-infinite-jr") { cliOptions.options.exit_on_infinite_jr = true; }
         else if (flag == "--print-serial") { cliOptions.options.print_serial = true; }
+        else if (flag == "--jit") { cliOptions.options.jit = true; }
+        else if (flag == "--opcode-histogram") { cliOptions.options.opcode_histogram = true; }
+        else if (flag == "--skip-boot") { cliOptions.options.skip_boot = true; }
+        else if (flag == "--accurate-dma") { cliOptions.options.accurate_dma = true; }
+        else if (flag == "--access-counts") { cliOptions.options.access_counts = true; }
+        else if (flag == "--profile") { cliOptions.options.profile = without_extension(cliOptions.filename); }
+        else if (flag == "--frame-trace") { cliOptions.options.frame_trace = without_extension(cliOptions.filename) + ".trace.json"; }
+        else if (flag == "--no-block-cache") { cliOptions.options.block_cache = false; }
+        else if (flag == "--no-fusion") { cliOptions.options.fusion = false; }
+        else if (flag == "--no-idle-skipping") { cliOptions.options.idle_skipping = false; }
+        else if (flag == "--no-chaining") { cliOptions.options.chain_instructions = false; }
+        else if (flag == "--no-aot") { cliOptions.options.aot = false; }
         else { fatal_error("Unknown flag: %s", flag.c_str()); }
     }
 
@@ -0,0 +1,95 @@
+#include "../../src/gameboy_prelude.h"
+#include "../../src/video/video.h"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/*
+ * usage: gbemu-dma-benchmark [frames]
+ *
+ * Runs a generated ROM which does nothing but start OAM DMA transfers from
+ * HRAM, back to back, and times it with instant and with accurate DMA.
+ */
+
+const uint DEFAULT_FRAMES = 3000;
+
+/* Copies the routine below into HRAM, then calls it forever */
+const std::vector<u8> MAIN_PROGRAM = {
+    0xF3,             /* DI */
+    0x31, 0xFE, 0xDF, /* LD SP,0xDFFE, out of the way of the code in HRAM */
+    0xAF,             /* XOR A */
+    0xE0, 0x40,       /* LDH (0x40),A, turning the LCD off so as to time DMA rather than drawing */
+    0x21, 0x80, 0xFF, /* LD HL,0xFF80 */
+    0x11, 0x00, 0x02, /* LD DE,0x0200 */
+    0x06, 0x0A,       /* LD B,10 */
+    0x1A,             /* copy: LD A,(DE) */
+    0x13,             /* INC DE */
+    0x22,             /* LD (HL+),A */
+    0x05,             /* DEC B */
+    0x20, 0xFA,       /* JR NZ,copy */
+    0xCD, 0x80, 0xFF, /* loop: CALL 0xFF80 */
+    0x18, 0xFB,       /* JR loop */
+};
+
+/* Starts a transfer from 0xC000 and waits it out */
+const std::vector<u8> HRAM_ROUTINE = {
+    0x3E, 0xC0, /* LD A,0xC0 */
+    0xE0, 0x46, /* LDH (0x46),A */
+    0x3E, 0x29, /* LD A,41 */
+    0x3D,       /* wait: DEC A */
+    0x20, 0xFD, /* JR NZ,wait */
+    0xC9,       /* RET */
+};
+
+static std::shared_ptr<const RomImage> benchmark_rom() {
+    std::vector<u8> rom(0x8000, 0x00);
+
+    /* Entry point: JP 0x0150. The header says ROM only, with no RAM. */
+    rom[0x101] = 0xC3;
+    rom[0x102] = 0x50;
+    rom[0x103] = 0x01;
+
+    std::copy(MAIN_PROGRAM.begin(), MAIN_PROGRAM.end(), rom.begin() + 0x150);
+    std::copy(HRAM_ROUTINE.begin(), HRAM_ROUTINE.end(), rom.begin() + 0x200);
+
+    return RomImage::from_bytes(std::move(rom));
+}
+
+/* Returns the host time taken to run the ROM for some number of frames */
+static double run(const std::shared_ptr<const RomImage>& rom, const bool accurate, const uint frames) {
+    Options options;
+    options.headless = true;
+    options.skip_boot = true;
+    options.accurate_dma = accurate;
+
+    log_set_level(LogLevel::Error);
+    Gameboy gameboy(rom, options);
+    log_set_level(LogLevel::Error);
+
+    uint frames_run = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    gameboy.run(
+        [&]() { return frames_run >= frames; },
+        [&](const FrameBuffer&) { frames_run++; }
+    );
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+int main(int argc, char* argv[]) {
+    uint frames = argc > 1 ? static_cast<uint>(std::stoul(argv[1])) : DEFAULT_FRAMES;
+
+    auto rom = benchmark_rom();
+
+    double instant = run(rom, false, frames);
+    double accurate = run(rom, true, frames);
+
+    printf("%-10s %10s %14s\n", "DMA", "seconds", "us per frame");
+    printf("%-10s %10.3f %14.2f\n", "instant", instant, instant * 1e6 / frames);
+    printf("%-10s %10.3f %14.2f\n", "accurate", accurate, accurate * 1e6 / frames);
+}
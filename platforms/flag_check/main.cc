@@ -0,0 +1,291 @@
+#include "../../src/gameboy_prelude.h"
+
+#include <array>
+#include <cstdio>
+#include <vector>
+
+/*
+ * usage: gbemu-flag-check
+ *
+ * Runs every flag-setting ALU, INC/DEC, DAA and rotate instruction on the CPU
+ * with every accumulator, operand and incoming flag state, and compares A and
+ * F with a reference model which builds the flags straight away. The CPU's
+ * own flag path is the one it was built with: lazy with GBEMU_LAZY_FLAGS,
+ * when the incoming flags are also given still pending from an earlier
+ * operation, or eager. ./scripts/run_flag_check builds and runs both.
+ *
+ * Exits with 1 if any case differs.
+ */
+
+/* Only the first few differences are reported */
+const uint MAX_REPORTED = 20;
+
+struct Outcome {
+    u8 a;
+    u8 f;
+};
+
+/* The flags going into an instruction, and the operation which left them
+ * pending, if they aren't in F yet */
+struct IncomingFlags {
+    u8 f;
+    FlagOperation operation = FlagOperation::None;
+    u8 lhs = 0;
+    u8 rhs = 0;
+    u8 carry = 0;
+};
+
+/* The instructions checked: binary operations take their operand from B,
+ * everything else works on A alone */
+struct CheckedInstruction {
+    bool cb;
+    u8 opcode;
+};
+
+const std::vector<CheckedInstruction> CHECKED_INSTRUCTIONS = {
+    /* ADD/ADC/SUB/SBC/AND/XOR/OR/CP A,B */
+    { false, 0x80 }, { false, 0x88 }, { false, 0x90 }, { false, 0x98 },
+    { false, 0xA0 }, { false, 0xA8 }, { false, 0xB0 }, { false, 0xB8 },
+
+    /* INC A, DEC A, DAA, CPL, SCF, CCF */
+    { false, 0x3C }, { false, 0x3D }, { false, 0x27 }, { false, 0x2F }, { false, 0x37 }, { false, 0x3F },
+
+    /* RLCA, RRCA, RLA, RRA */
+    { false, 0x07 }, { false, 0x0F }, { false, 0x17 }, { false, 0x1F },
+
+    /* RLC/RRC/RL/RR/SLA/SRA/SWAP/SRL A */
+    { true, 0x07 }, { true, 0x0F }, { true, 0x17 }, { true, 0x1F },
+    { true, 0x27 }, { true, 0x2F }, { true, 0x37 }, { true, 0x3F },
+};
+
+static u8 zero(const uint result) {
+    return (result & 0xFF) == 0 ? 0x80 : 0x00;
+}
+
+/* What each instruction does to A and F, building the flags directly */
+static Outcome reference(const Operation operation, const u8 a, const u8 b, const u8 f) {
+    uint carry = (f & 0x10) != 0 ? 1 : 0;
+    u8 kept_zero = f & 0x80;
+
+    switch (operation) {
+        case Operation::ADD:
+        case Operation::ADC: {
+            uint c = operation == Operation::ADC ? carry : 0;
+            uint result = a + b + c;
+            bool half_carry = (a & 0xF) + (b & 0xF) + c > 0xF;
+            return { static_cast<u8>(result), static_cast<u8>(zero(result) | (half_carry ? 0x20 : 0) | (result > 0xFF ? 0x10 : 0)) };
+        }
+
+        case Operation::SUB:
+        case Operation::SBC:
+        case Operation::CP: {
+            int c = operation == Operation::SBC ? static_cast<int>(carry) : 0;
+            int result = a - b - c;
+            bool half_carry = (a & 0xF) - (b & 0xF) - c < 0;
+            u8 flags = static_cast<u8>(zero(static_cast<uint>(result)) | 0x40 | (half_carry ? 0x20 : 0) | (result < 0 ? 0x10 : 0));
+            return { operation == Operation::CP ? a : static_cast<u8>(result), flags };
+        }
+
+        case Operation::AND: return { static_cast<u8>(a & b), static_cast<u8>(zero(a & b) | 0x20) };
+        case Operation::XOR: return { static_cast<u8>(a ^ b), zero(a ^ b) };
+        case Operation::OR: return { static_cast<u8>(a | b), zero(a | b) };
+
+        case Operation::INC: {
+            u8 result = static_cast<u8>(a + 1);
+            return { result, static_cast<u8>(zero(result) | ((result & 0xF) == 0x0 ? 0x20 : 0) | (f & 0x10)) };
+        }
+
+        case Operation::DEC: {
+            u8 result = static_cast<u8>(a - 1);
+            return { result, static_cast<u8>(zero(result) | 0x40 | ((result & 0xF) == 0xF ? 0x20 : 0) | (f & 0x10)) };
+        }
+
+        case Operation::DAA: {
+            bool subtract = (f & 0x40) != 0;
+            bool half_carry = (f & 0x20) != 0;
+            bool carry_out = carry != 0;
+            u8 result = a;
+
+            if (!subtract) {
+                if (carry_out || result > 0x99) { result = static_cast<u8>(result + 0x60); carry_out = true; }
+                if (half_carry || (result & 0xF) > 0x9) { result = static_cast<u8>(result + 0x06); }
+            } else {
+                if (carry_out) { result = static_cast<u8>(result - 0x60); }
+                if (half_carry) { result = static_cast<u8>(result - 0x06); }
+            }
+
+            return { result, static_cast<u8>(zero(result) | (f & 0x40) | (carry_out ? 0x10 : 0)) };
+        }
+
+        case Operation::CPL: return { static_cast<u8>(~a), static_cast<u8>((f & 0x90) | 0x60) };
+        case Operation::SCF: return { a, static_cast<u8>(kept_zero | 0x10) };
+        case Operation::CCF: return { a, static_cast<u8>(kept_zero | (carry ? 0 : 0x10)) };
+
+        /* The accumulator rotates always clear Z */
+        case Operation::RLCA: return { static_cast<u8>((a << 1) | (a >> 7)), static_cast<u8>((a & 0x80) >> 3) };
+        case Operation::RRCA: return { static_cast<u8>((a >> 1) | (a << 7)), static_cast<u8>((a & 0x01) << 4) };
+        case Operation::RLA: return { static_cast<u8>((a << 1) | carry), static_cast<u8>((a & 0x80) >> 3) };
+        case Operation::RRA: return { static_cast<u8>((a >> 1) | (carry << 7)), static_cast<u8>((a & 0x01) << 4) };
+
+        default:
+            break;
+    }
+
+    /* The CB rotates and shifts set Z from the result */
+    u8 result;
+    bool carry_out;
+
+    switch (operation) {
+        case Operation::RLC: result = static_cast<u8>((a << 1) | (a >> 7)); carry_out = (a & 0x80) != 0; break;
+        case Operation::RRC: result = static_cast<u8>((a >> 1) | (a << 7)); carry_out = (a & 0x01) != 0; break;
+        case Operation::RL: result = static_cast<u8>((a << 1) | carry); carry_out = (a & 0x80) != 0; break;
+        case Operation::RR: result = static_cast<u8>((a >> 1) | (carry << 7)); carry_out = (a & 0x01) != 0; break;
+        case Operation::SLA: result = static_cast<u8>(a << 1); carry_out = (a & 0x80) != 0; break;
+        case Operation::SRA: result = static_cast<u8>((a >> 1) | (a & 0x80)); carry_out = (a & 0x01) != 0; break;
+        case Operation::SRL: result = static_cast<u8>(a >> 1); carry_out = (a & 0x01) != 0; break;
+        case Operation::SWAP: result = static_cast<u8>((a << 4) | (a >> 4)); carry_out = false; break;
+        default: fatal_error("No reference for this instruction");
+    }
+
+    return { result, static_cast<u8>(zero(result) | (carry_out ? 0x10 : 0)) };
+}
+
+/* Every value of F as it is and, with lazy flags, as many as can be left
+ * pending by an earlier operation */
+static std::vector<IncomingFlags> incoming_flags() {
+    std::vector<IncomingFlags> incoming;
+
+    for (uint f = 0; f < 0x100; f += 0x10) {
+        incoming.push_back({ static_cast<u8>(f) });
+    }
+
+#ifdef GBEMU_LAZY_FLAGS
+    std::array<bool, 16> pending_found = {};
+
+    const std::array<FlagOperation, 7> operations = {
+        FlagOperation::Add, FlagOperation::Sub, FlagOperation::And, FlagOperation::Or,
+        FlagOperation::Inc, FlagOperation::Dec, FlagOperation::Shift,
+    };
+
+    for (FlagOperation operation : operations) {
+        for (uint lhs = 0; lhs < 0x100; lhs++) {
+            for (uint rhs = 0; rhs < 0x100; rhs++) {
+                for (u8 carry = 0; carry < 2; carry++) {
+                    u8 f = evaluate_flags(operation, static_cast<u8>(lhs), static_cast<u8>(rhs), carry, 0);
+                    if (pending_found[f >> 4]) { continue; }
+
+                    pending_found[f >> 4] = true;
+                    incoming.push_back({ f, operation, static_cast<u8>(lhs), static_cast<u8>(rhs), carry });
+                }
+            }
+        }
+    }
+#endif
+
+    return incoming;
+}
+
+/* A ROM which does nothing, as the CPU is driven directly */
+static std::shared_ptr<const RomImage> empty_rom() {
+    std::vector<u8> rom(0x8000, 0x00);
+
+    /* Entry point: JR -2 */
+    rom[0x100] = 0x18;
+    rom[0x101] = 0xFE;
+
+    return RomImage::from_bytes(std::move(rom));
+}
+
+class FlagCheck {
+public:
+    FlagCheck() :
+        gameboy(empty_rom(), options())
+    {
+    }
+
+    /* Returns the number of cases which differed */
+    uint64_t run(uint64_t& cases);
+
+private:
+    static Options& options();
+
+    Gameboy gameboy;
+};
+
+Options& FlagCheck::options() {
+    /* The Gameboy keeps a reference to its options */
+    static Options options;
+    options.headless = true;
+    return options;
+}
+
+uint64_t FlagCheck::run(uint64_t& cases) {
+    CPU& cpu = gameboy.cpu;
+    Registers& registers = cpu.registers;
+
+    std::vector<IncomingFlags> incoming = incoming_flags();
+    uint64_t differences = 0;
+
+    for (const CheckedInstruction& instruction : CHECKED_INSTRUCTIONS) {
+        const OpcodeSpec& spec = instruction.cb
+            ? cb_opcode_specs[instruction.opcode]
+            : opcode_specs[instruction.opcode];
+
+        const Opcode& op = instruction.cb
+            ? CPU::cb_opcodes[instruction.opcode]
+            : CPU::opcodes[instruction.opcode];
+
+        uint operands = spec.src == Operand::B ? 0x100 : 1;
+
+        for (uint a = 0; a < 0x100; a++) {
+            for (uint b = 0; b < operands; b++) {
+                for (const IncomingFlags& flags : incoming) {
+                    registers.a = static_cast<u8>(a);
+                    registers.b = static_cast<u8>(b);
+                    registers.f = flags.operation == FlagOperation::None ? flags.f : 0;
+                    registers.flag_operation = flags.operation;
+                    registers.flag_lhs = flags.lhs;
+                    registers.flag_rhs = flags.rhs;
+                    registers.flag_carry_in = flags.carry;
+
+                    op.execute(cpu, 0);
+                    cases++;
+
+                    Outcome expected = reference(spec.operation, static_cast<u8>(a), static_cast<u8>(b), flags.f);
+                    u8 f = registers.flags();
+
+                    if (registers.a == expected.a && f == expected.f && (registers.af_value() & 0xFF) == f) { continue; }
+
+                    if (differences++ < MAX_REPORTED) {
+                        printf("%s%02X with A=%02X B=%02X F=%02X (%s): got A=%02X F=%02X, expected A=%02X F=%02X\n",
+                            instruction.cb ? "CB " : "", instruction.opcode, a, b, flags.f,
+                            flags.operation == FlagOperation::None ? "in F" : "pending",
+                            registers.a, f, expected.a, expected.f);
+                    }
+                }
+            }
+        }
+    }
+
+    return differences;
+}
+
+int main() {
+    log_set_level(LogLevel::Error);
+
+    FlagCheck check;
+
+    uint64_t cases = 0;
+    uint64_t differences = check.run(cases);
+
+#ifdef GBEMU_LAZY_FLAGS
+    const char* path = "lazy";
+#else
+    const char* path = "eager";
+#endif
+
+    printf("%s flags: %llu cases, %llu differences\n", path,
+        static_cast<unsigned long long>(cases), static_cast<unsigned long long>(differences));
+
+    return differences == 0 ? 0 : 1;
+}
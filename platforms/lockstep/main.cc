@@ -0,0 +1,78 @@
+#include "../../src/gameboy_prelude.h"
+#include "../../src/lockstep.h"
+#include "../cli/cli.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/*
+ * usage: gbemu-lockstep <rom_file> [--every <instructions>] [--cycles <cycles>] [emulator flags]
+ *
+ * Runs the ROM on the reference interpreter and, in lockstep, with the fast
+ * paths enabled by the remaining flags (the defaults, plus e.g. --jit, or with
+ * --no-fusion to rule fusion out). Exits with 1 and a report if they diverge.
+ */
+
+/* Around 20 seconds of emulated time */
+const u64 DEFAULT_MAX_CYCLES = 20ull * CLOCK_RATE;
+
+/* Hashing the state takes far longer than running an instruction, so it's
+ * only compared every so often until the instances are known to diverge */
+const uint DEFAULT_COMPARE_EVERY = 1000;
+
+int main(int argc, char* argv[]) {
+    uint compare_every = DEFAULT_COMPARE_EVERY;
+    u64 max_cycles = DEFAULT_MAX_CYCLES;
+
+    /* Everything but the harness's own flags is passed on as usual */
+    std::vector<char*> emulator_args;
+
+    for (int i = 0; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg == "--every" && i + 1 < argc) { compare_every = static_cast<uint>(std::max(1ul, std::stoul(argv[++i]))); }
+        else if (arg == "--cycles" && i + 1 < argc) { max_cycles = std::stoull(argv[++i]); }
+        else { emulator_args.push_back(argv[i]); }
+    }
+
+    CliOptions cliOptions = get_cli_options(static_cast<int>(emulator_args.size()), emulator_args.data());
+    /* Both instances share the one image */
+    auto rom = RomImage::load(cliOptions.filename);
+
+    Options fast_options = cliOptions.options;
+    fast_options.headless = true;
+    fast_options.exit_on_infinite_jr = false;
+
+    Options reference_options;
+    reference_options.headless = true;
+    reference_options.block_cache = false;
+    reference_options.fusion = false;
+    reference_options.idle_skipping = false;
+    reference_options.chain_instructions = false;
+    reference_options.aot = false;
+
+    /* Both have to start from the same state */
+    reference_options.skip_boot = fast_options.skip_boot;
+    reference_options.accurate_dma = fast_options.accurate_dma;
+
+    Lockstep lockstep(rom, reference_options, fast_options);
+
+    if (lockstep.run(max_cycles, compare_every)) {
+        lockstep.report(stdout);
+        return 0;
+    }
+
+    /* Runs are deterministic, so the divergence can be narrowed down by
+     * running up to it again and comparing at every opportunity */
+    if (compare_every > 1) {
+        Lockstep replay(rom, reference_options, fast_options);
+        replay.run(lockstep.cycles(), 1);
+        replay.report(stdout);
+        return 1;
+    }
+
+    lockstep.report(stdout);
+    return 1;
+}
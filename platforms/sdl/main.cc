@@ -21,6 +21,23 @@ static CliOptions cliOptions;
 
 static bool should_exit = false;
 
+/* The per-frame timing overlay, toggled with T: a column for each recent
+ * frame, split by subsystem, with the 60fps budget at the top */
+static bool show_timing = false;
+
+static const uint TIMING_FRAMES = 120;
+static const u64 FRAME_BUDGET_NS = 1000000000 / 60;
+
+static const uint8_t subsystem_colors[SUBSYSTEM_COUNT][3] = {
+    { 220, 60, 60 },   /* CPU */
+    { 60, 120, 220 },  /* Video */
+    { 230, 200, 40 },  /* Timer */
+    { 160, 90, 200 },  /* Serial */
+    { 240, 140, 40 },  /* Debugger */
+    { 60, 190, 90 },   /* Vblank callback */
+    { 140, 140, 140 }, /* Present */
+};
+
 static std::unique_ptr<GbButton> get_gb_button(int keyCode) {
     switch (keyCode) {
         case SDLK_UP: return std::make_unique<GbButton>(GbButton::Up);
@@ -34,6 +51,10 @@ static std::unique_ptr<GbButton> get_gb_button(int keyCode) {
         case SDLK_b: gameboy->debug_toggle_background(); return nullptr;
         case SDLK_s: gameboy->debug_toggle_sprites(); return nullptr;
         case SDLK_w: gameboy->debug_toggle_window(); return nullptr;
+        case SDLK_t:
+            show_timing = !show_timing;
+            if (show_timing) { gameboy->frame_timing().set_enabled(true); }
+            return nullptr;
         default: return nullptr;
     }
 }
@@ -136,6 +157,39 @@ static void process_events() {
     }
 }
 
+static void draw_timing_overlay(const FrameTiming& timing) {
+    std::vector<FrameRecord> frames = timing.recent_frames(TIMING_FRAMES);
+
+    int column_width = static_cast<int>(width / TIMING_FRAMES);
+    if (column_width < 1) { column_width = 1; }
+
+    int graph_height = static_cast<int>(height / 3);
+    int bottom = static_cast<int>(height);
+
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+
+    for (std::size_t i = 0; i < frames.size(); i++) {
+        int x = static_cast<int>(i) * column_width;
+        int y = bottom;
+
+        for (uint subsystem = 0; subsystem < SUBSYSTEM_COUNT; subsystem++) {
+            int bar = static_cast<int>(frames[i].time[subsystem] * graph_height / FRAME_BUDGET_NS);
+            if (bar == 0) { continue; }
+
+            const uint8_t* color = subsystem_colors[subsystem];
+            SDL_SetRenderDrawColor(renderer, color[0], color[1], color[2], 200);
+
+            SDL_Rect rect = { x, y - bar, column_width, bar };
+            SDL_RenderFillRect(renderer, &rect);
+            y -= bar;
+        }
+    }
+
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+    SDL_RenderDrawLine(renderer, 0, bottom - graph_height, static_cast<int>(width), bottom - graph_height);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+}
+
 static void draw(const FrameBuffer& buffer) {
     process_events();
 
@@ -150,7 +204,13 @@ static void draw(const FrameBuffer& buffer) {
     SDL_UnlockTexture(gb_screen_texture);
 
     SDL_RenderCopy(renderer, gb_screen_texture, nullptr, nullptr);
+
+    FrameTiming& timing = gameboy->frame_timing();
+    if (show_timing) { draw_timing_overlay(timing); }
+
+    timing.switch_to(Subsystem::Present);
     SDL_RenderPresent(renderer);
+    timing.switch_to(Subsystem::VblankCallback);
 }
 
 static bool is_closed() {
@@ -184,13 +244,13 @@ int main(int argc, char* argv[]) {
         width, height
     );
 
-    auto rom_data = read_bytes(cliOptions.filename);
-    log_info("Read %d KB from %s", rom_data.size() / 1024, cliOptions.filename.c_str());
+    auto rom = RomImage::load(cliOptions.filename);
+    log_info("Read %zu KB from %s", rom->size() / 1024, cliOptions.filename.c_str());
 
     auto save_data = load_state();
     log_info("");
 
-    gameboy = std::make_unique<Gameboy>(rom_data, cliOptions.options, save_data);
+    gameboy = std::make_unique<Gameboy>(rom, cliOptions.options, save_data);
     gameboy->run(&is_closed, &draw);
 
     save_state();
@@ -158,13 +158,13 @@ int main(int argc, char* argv[]) {
     window->setKeyRepeatEnabled(false);
     window->display();
 
-    auto rom_data = read_bytes(options.filename);
-    log_info("Read %d KB from %s", rom_data.size() / 1024, options.filename.c_str());
+    auto rom = RomImage::load(options.filename);
+    log_info("Read %zu KB from %s", rom->size() / 1024, options.filename.c_str());
 
     auto save_data = load_state();
     log_info("");
 
-    gameboy = std::make_unique<Gameboy>(rom_data, options, save_data);
+    gameboy = std::make_unique<Gameboy>(rom, options, save_data);
     gameboy->run(&is_closed, &draw);
     return 0;
 }
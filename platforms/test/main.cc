@@ -12,7 +12,7 @@ static bool is_closed() {
 
 int main(int argc, char* argv[]) {
     CliOptions cliOptions = get_cli_options(argc, argv);
-    auto rom_data = read_bytes(cliOptions.filename);
-    gameboy = std::make_unique<Gameboy>(rom_data, cliOptions.options);
+    auto rom = RomImage::load(cliOptions.filename);
+    gameboy = std::make_unique<Gameboy>(rom, cliOptions.options);
     gameboy->run(&is_closed, &draw);
 }
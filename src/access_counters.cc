@@ -0,0 +1,62 @@
+#include "access_counters.h"
+
+#include <algorithm>
+#include <vector>
+
+const char* access_region_name(const AccessRegion region) {
+    switch (region) {
+        case AccessRegion::MirroredRam: return "Mirrored work RAM";
+        case AccessRegion::Unusable: return "Unusable memory";
+        case AccessRegion::UnimplementedIo: return "Unimplemented IO";
+    }
+
+    return "Unknown";
+}
+
+const AccessCount& AccessCounters::region(const AccessRegion region) const {
+    return regions[static_cast<uint>(region)];
+}
+
+const AccessCount& AccessCounters::io_register(const u16 address) const {
+    return io[address & 0x7F];
+}
+
+bool AccessCounters::any_unexpected() const {
+    const AccessCount& mirrored = region(AccessRegion::MirroredRam);
+    const AccessCount& unusable = region(AccessRegion::Unusable);
+
+    return mirrored.writes > 0 || unusable.reads > 0 || unusable.writes > 0;
+}
+
+void AccessCounters::reset() {
+    regions = {};
+    io = {};
+}
+
+void AccessCounters::write(FILE* file) const {
+    fprintf(file, "%-20s %12s %12s\n", "Region", "Reads", "Writes");
+
+    for (uint i = 0; i < ACCESS_REGION_COUNT; i++) {
+        fprintf(file, "%-20s %12llu %12llu\n",
+            access_region_name(static_cast<AccessRegion>(i)),
+            static_cast<unsigned long long>(regions[i].reads),
+            static_cast<unsigned long long>(regions[i].writes));
+    }
+
+    std::vector<uint> used;
+    for (uint i = 0; i < io.size(); i++) {
+        if (io[i].reads > 0 || io[i].writes > 0) { used.push_back(i); }
+    }
+
+    std::sort(used.begin(), used.end(), [this](uint a, uint b) {
+        return io[a].reads + io[a].writes > io[b].reads + io[b].writes;
+    });
+
+    fprintf(file, "\n%-20s %12s %12s\n", "IO register", "Reads", "Writes");
+
+    for (uint i : used) {
+        fprintf(file, "0x%04X %13s %12llu %12llu\n", 0xFF00 + i, "",
+            static_cast<unsigned long long>(io[i].reads),
+            static_cast<unsigned long long>(io[i].writes));
+    }
+}
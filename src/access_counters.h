@@ -0,0 +1,54 @@
+#pragma once
+
+#include "definitions.h"
+
+#include <array>
+#include <cstdio>
+
+/* Accesses which the hardware ignores or the emulator doesn't implement */
+enum class AccessRegion {
+    MirroredRam,
+    Unusable,
+    UnimplementedIo,
+};
+
+const uint ACCESS_REGION_COUNT = 3;
+
+const char* access_region_name(AccessRegion region);
+
+struct AccessCount {
+    u64 reads = 0;
+    u64 writes = 0;
+};
+
+/**
+ * Counts the accesses to each IO register, and to the regions of memory which
+ * well-behaved games shouldn't touch, in place of logging each one. Only the
+ * MMU's slow path counts, so plain memory never pays for it; the counts show
+ * which registers a game leans on, and whether it does anything unexpected.
+ */
+class AccessCounters {
+public:
+    void count_read(AccessRegion region) { regions[static_cast<uint>(region)].reads++; }
+    void count_write(AccessRegion region) { regions[static_cast<uint>(region)].writes++; }
+
+    void count_io_read(u16 address) { io[address & 0x7F].reads++; }
+    void count_io_write(u16 address) { io[address & 0x7F].writes++; }
+
+    const AccessCount& region(AccessRegion region) const;
+    const AccessCount& io_register(u16 address) const;
+
+    /* Whether mirrored work RAM was written or unusable memory accessed */
+    bool any_unexpected() const;
+
+    void reset();
+
+    /* Writes the regions, then each IO register which was used, busiest first */
+    void write(FILE* file) const;
+
+private:
+    std::array<AccessCount, ACCESS_REGION_COUNT> regions = {};
+
+    /* 0xFF00-0xFF7F */
+    std::array<AccessCount, 0x80> io = {};
+};
@@ -3,9 +3,6 @@
 Address::Address(u16 location) : addr(location) {
 }
 
-Address::Address(const RegisterPair& from) : addr(from.value()) {
-}
-
 Address::Address(const WordRegister& from) : addr(from.value()) {
 }
 
@@ -6,7 +6,6 @@
 class Address {
 public:
     Address(u16 location);
-    explicit Address(const RegisterPair& from);
     explicit Address(const WordRegister& from);
 
     u16 value() const;
@@ -3,163 +3,255 @@
 #include "../util/files.h"
 #include "../util/log.h"
 
-std::shared_ptr<Cartridge> get_cartridge(std::vector<u8> rom_data, std::vector<u8> ram_data) {
-    std::unique_ptr<CartridgeInfo> info = get_info(rom_data);
+const uint ROM_BANK_SIZE = 0x4000;
+const uint RAM_BANK_SIZE = 0x2000;
+
+/* Read in place of banks which the cartridge doesn't actually have */
+static const std::vector<u8> open_bus(ROM_BANK_SIZE, 0xFF);
+
+static bool ram_enable_value(const u8 value) {
+    return (value & 0x0F) == 0x0A;
+}
+
+/* One less than the smallest power of two which covers 'count' */
+static uint bank_mask(const uint count) {
+    uint banks = 1;
+    while (banks < count) { banks *= 2; }
+
+    return banks - 1;
+}
+
+std::shared_ptr<Cartridge> get_cartridge(std::shared_ptr<const RomImage> rom, std::vector<u8> ram_data) {
+    std::unique_ptr<CartridgeInfo> info = get_info(*rom);
 
     switch (info->type) {
         case CartridgeType::ROMOnly:
-            return std::make_shared<NoMBC>(rom_data, ram_data, std::move(info));
+            return std::make_shared<NoMBC>(std::move(rom), std::move(ram_data), std::move(info));
         case CartridgeType::MBC1:
-            return std::make_shared<MBC1>(rom_data, ram_data, std::move(info));
+            return std::make_shared<MBC1>(std::move(rom), std::move(ram_data), std::move(info));
         case CartridgeType::MBC2:
-            fatal_error("MBC2 is unimplemented");
+            return std::make_shared<MBC2>(std::move(rom), std::move(ram_data), std::move(info));
         case CartridgeType::MBC3:
-            return std::make_shared<MBC3>(rom_data, ram_data, std::move(info));
+            return std::make_shared<MBC3>(std::move(rom), std::move(ram_data), std::move(info));
         case CartridgeType::MBC4:
             fatal_error("MBC4 is unimplemented");
         case CartridgeType::MBC5:
-            fatal_error("MBC5 is unimplemented");
+            return std::make_shared<MBC5>(std::move(rom), std::move(ram_data), std::move(info));
         case CartridgeType::Unknown:
             fatal_error("Unknown cartridge type");
     }
 }
 
 Cartridge::Cartridge(
-    std::vector<u8> rom_data,
+    std::shared_ptr<const RomImage> rom_image,
     std::vector<u8> ram_data,
-    std::unique_ptr<CartridgeInfo> in_cartridge_info
+    std::unique_ptr<CartridgeInfo> in_cartridge_info,
+    uint built_in_ram_size
 ) :
-    rom(std::move(rom_data)),
+    rom(std::move(rom_image)),
     cartridge_info(std::move(in_cartridge_info))
 {
-    auto ram_size_for_cartridge = get_actual_ram_size(cartridge_info->ram_size);
+    auto ram_size_for_cartridge = built_in_ram_size != 0
+        ? built_in_ram_size
+        : get_actual_ram_size(cartridge_info->ram_size);
 
     if (ram_data.size() != 0) {
         if (ram_data.size() != ram_size_for_cartridge) { fatal_error("Invalid or corrupted RAM file. Read %d bytes, expected %d", ram_data.size(), ram_size_for_cartridge); }
-        ram = ram_data;
+        ram = std::move(ram_data);
     } else {
         ram = std::vector<u8>(ram_size_for_cartridge, 0);
     }
+
+    rom_bank_mask = bank_mask((rom->size() + ROM_BANK_SIZE - 1) / ROM_BANK_SIZE);
+    ram_bank_mask = bank_mask(ram.size() / RAM_BANK_SIZE);
+    ram_offset_mask = ram.size() < RAM_BANK_SIZE ? bank_mask(ram.size()) : RAM_BANK_SIZE - 1;
+
+    switch_banks(0, 1, false, 0);
+}
+
+const RomImage& Cartridge::get_rom() const {
+    return *rom;
 }
 
 const std::vector<u8>& Cartridge::get_cartridge_ram() const {
     return ram;
 }
 
+u8 Cartridge::read(const Address& address) const {
+    u16 addr = address.value();
+
+    if (addr < 0x4000) { return rom_bank_0[addr]; }
+    if (addr < 0x8000) { return rom_bank_n[addr - 0x4000]; }
+
+    if (ram_bank == nullptr) { return 0xFF; }
+    return ram_bank[addr & ram_offset_mask];
+}
+
+void Cartridge::write_ram(const Address& address, const u8 value) {
+    if (ram_bank == nullptr) { return; }
+
+    ram_bank[address.value() & ram_offset_mask] = value;
+}
+
+u8* Cartridge::ram_bank_memory() const {
+    return ram_offset_mask == RAM_BANK_SIZE - 1 ? ram_bank : nullptr;
+}
+
+void Cartridge::switch_banks(const uint bank_0, const uint bank_n, const bool ram_enabled, const uint ram_bank_number) {
+    auto rom_bank_pointer = [this](const uint bank) {
+        uint bank_offset = ROM_BANK_SIZE * bank;
+        if (bank_offset + ROM_BANK_SIZE > rom->size()) { return open_bus.data(); }
+
+        return rom->data() + bank_offset;
+    };
+
+    rom_bank_0_index = bank_0 & rom_bank_mask;
+    rom_bank_n_index = bank_n & rom_bank_mask;
+
+    rom_bank_0 = rom_bank_pointer(rom_bank_0_index);
+    rom_bank_n = rom_bank_pointer(rom_bank_n_index);
+
+    if (!ram_enabled || ram.empty()) {
+        ram_bank = nullptr;
+        return;
+    }
+
+    uint ram_bank_offset = RAM_BANK_SIZE * (ram_bank_number & ram_bank_mask);
+    ram_bank = ram_bank_offset < ram.size() ? ram.data() + ram_bank_offset : nullptr;
+}
+
 NoMBC::NoMBC(
-    std::vector<u8> rom_data,
+    std::shared_ptr<const RomImage> rom_image,
     std::vector<u8> ram_data,
     std::unique_ptr<CartridgeInfo> in_cartridge_info
 )
-    : Cartridge(rom_data, ram_data, std::move(in_cartridge_info))
+    : Cartridge(std::move(rom_image), std::move(ram_data), std::move(in_cartridge_info))
 {
+    /* Any RAM is wired straight to the bus */
+    switch_banks(0, 1, true, 0);
 }
 
 void NoMBC::write(const Address& address, u8 value) {
-    log_warn("Attempting to write to cartridge ROM without an MBC");
-    return;
-}
+    if (address.in_range(0xA000, 0xBFFF)) {
+        write_ram(address, value);
+        return;
+    }
 
-u8 NoMBC::read(const Address& address) const {
-    /* TODO: check this address is in sensible bounds */
-    return rom.at(address.value());
+    log_warn("Attempting to write to cartridge ROM without an MBC");
 }
 
 MBC1::MBC1(
-    std::vector<u8> rom_data,
+    std::shared_ptr<const RomImage> rom_image,
     std::vector<u8> ram_data,
     std::unique_ptr<CartridgeInfo> in_cartridge_info
 )
-    : Cartridge(rom_data, ram_data, std::move(in_cartridge_info))
+    : Cartridge(std::move(rom_image), std::move(ram_data), std::move(in_cartridge_info))
 {
-    unused(rom_banking_mode);
-
     rom_bank.set(0x1);
+    update_banks();
 }
 
 void MBC1::write(const Address& address, u8 value) {
+    if (address.in_range(0xA000, 0xBFFF)) {
+        write_ram(address, value);
+        return;
+    }
+
     if (address.in_range(0x0000, 0x1FFF)) {
-        ram_enabled = true;
+        ram_enabled = ram_enable_value(value);
     }
 
     if (address.in_range(0x2000, 0x3FFF)) {
-        if (value == 0x0) { rom_bank.set(0x1); }
-
-        if (value == 0x20) { rom_bank.set(0x21); return; }
-        if (value == 0x40) { rom_bank.set(0x41); return; }
-        if (value == 0x60) { rom_bank.set(0x61); return; }
-
-        u16 rom_bank_bits = value & 0x1F;
-        rom_bank.set(rom_bank_bits);
+        /* Bank 0 can't be selected here, so 0x20, 0x40 and 0x60 can't be
+         * switched into 0x4000-0x7FFF either */
+        u8 rom_bank_bits = value & 0x1F;
+        rom_bank.set(rom_bank_bits == 0x0 ? 0x1 : rom_bank_bits);
     }
 
     if (address.in_range(0x4000, 0x5FFF)) {
-        log_unimplemented("Unimplemented: Setting upper bits of ROM bank number");
+        upper_bank.set(value & 0x03);
     }
 
     if (address.in_range(0x6000, 0x7FFF)) {
-        log_unimplemented("Unimplemented: Selecting ROM/RAM Mode");
+        advanced_banking_mode = (value & 0x01) != 0;
     }
 
-    if (address.in_range(0xA000, 0xBFFF)) {
-        if (!ram_enabled) { return; }
+    update_banks();
+}
 
-        auto offset_into_ram = 0x2000 * ram_bank.value();
-        auto address_in_ram = (address - 0xA000) + offset_into_ram;
-        ram.at(address_in_ram.value()) = value;
-    }
+void MBC1::update_banks() {
+    uint upper_bits = upper_bank.value() << 5;
+
+    switch_banks(
+        advanced_banking_mode ? upper_bits : 0x0,
+        upper_bits | rom_bank.value(),
+        ram_enabled,
+        advanced_banking_mode ? upper_bank.value() : 0x0
+    );
 }
 
-u8 MBC1::read(const Address& address) const {
-    if (address.in_range(0x0000, 0x3FFF)) {
-        return rom.at(address.value());
-    }
+MBC2::MBC2(
+    std::shared_ptr<const RomImage> rom_image,
+    std::vector<u8> ram_data,
+    std::unique_ptr<CartridgeInfo> in_cartridge_info
+)
+    : Cartridge(std::move(rom_image), std::move(ram_data), std::move(in_cartridge_info), RAM_SIZE)
+{
+    /* Only the lower half of each byte is stored, and the upper half reads
+     * back as 1s. Keeping them set means reads don't have to mask. */
+    for (u8& byte : ram) { byte |= 0xF0; }
 
-    if (address.in_range(0x4000, 0x7FFF)) {
-        u16 address_into_bank = address.value() - 0x4000;
-        uint bank_offset = 0x4000 * rom_bank.value();
+    rom_bank.set(0x1);
+    update_banks();
+}
 
-        uint address_in_rom = bank_offset + address_into_bank;
-        return rom.at(address_in_rom);
+void MBC2::write(const Address& address, u8 value) {
+    if (address.in_range(0xA000, 0xBFFF)) {
+        write_ram(address, value | 0xF0);
+        return;
     }
 
-    if (address.in_range(0xA000, 0xBFFF)) {
-        auto offset_into_ram = 0x2000 * ram_bank.value();
-        auto address_in_ram = (address - 0xA000) + offset_into_ram;
-        return ram.at(address_in_ram.value());
+    /* Both registers sit in 0x0000-0x3FFF, told apart by bit 8 of the address */
+    if (address.in_range(0x0000, 0x3FFF)) {
+        if ((address.value() & 0x0100) == 0) {
+            ram_enabled = ram_enable_value(value);
+        } else {
+            u8 rom_bank_bits = value & 0x0F;
+            rom_bank.set(rom_bank_bits == 0x0 ? 0x1 : rom_bank_bits);
+        }
     }
 
-    fatal_error("Attempted to read from unmapped MBC1 address 0x%x", address.value());
+    update_banks();
+}
+
+void MBC2::update_banks() {
+    switch_banks(0x0, rom_bank.value(), ram_enabled, 0x0);
 }
 
 MBC3::MBC3(
-    std::vector<u8> rom_data,
+    std::shared_ptr<const RomImage> rom_image,
     std::vector<u8> ram_data,
     std::unique_ptr<CartridgeInfo> in_cartridge_info
 )
-    : Cartridge(rom_data, ram_data, std::move(in_cartridge_info))
+    : Cartridge(std::move(rom_image), std::move(ram_data), std::move(in_cartridge_info))
 {
-    unused(rom_banking_mode);
-
     rom_bank.set(0x1);
+    update_banks();
 }
 
 void MBC3::write(const Address& address, u8 value) {
-    if (address.in_range(0x0000, 0x1FFF)) {
-        if (value == 0x0A) {
-            ram_enabled = true;
-        }
+    if (address.in_range(0xA000, 0xBFFF)) {
+        write_ram(address, value);
+        return;
+    }
 
-        if (value == 0x0) {
-            ram_enabled = false;
-        }
+    if (address.in_range(0x0000, 0x1FFF)) {
+        ram_enabled = ram_enable_value(value);
     }
 
     if (address.in_range(0x2000, 0x3FFF)) {
-        if (value == 0x0) { rom_bank.set(0x1); }
-
-        u16 rom_bank_bits = value & 0x7F;
-        rom_bank.set(rom_bank_bits);
+        u8 rom_bank_bits = value & 0x7F;
+        rom_bank.set(rom_bank_bits == 0x0 ? 0x1 : rom_bank_bits);
     }
 
     if (address.in_range(0x4000, 0x5FFF)) {
@@ -178,35 +270,50 @@ void MBC3::write(const Address& address, u8 value) {
         log_unimplemented("Unimplemented: Latch clock data");
     }
 
-    if (address.in_range(0xA000, 0xBFFF)) {
-        if (!ram_enabled) { return; }
+    update_banks();
+}
 
-        if (ram_over_rtc) {
-            auto offset_into_ram = 0x2000 * ram_bank.value();
-            auto address_in_ram = (address - 0xA000) + offset_into_ram;
-            ram.at(address_in_ram.value()) = value;
-        }
-    }
+void MBC3::update_banks() {
+    /* The RTC registers aren't implemented, so they read as open bus */
+    switch_banks(0x0, rom_bank.value(), ram_enabled && ram_over_rtc, ram_bank.value());
 }
 
-u8 MBC3::read(const Address& address) const {
-    if (address.in_range(0x0000, 0x3FFF)) {
-        return rom.at(address.value());
+MBC5::MBC5(
+    std::shared_ptr<const RomImage> rom_image,
+    std::vector<u8> ram_data,
+    std::unique_ptr<CartridgeInfo> in_cartridge_info
+)
+    : Cartridge(std::move(rom_image), std::move(ram_data), std::move(in_cartridge_info))
+{
+    rom_bank.set(0x1);
+    update_banks();
+}
+
+void MBC5::write(const Address& address, u8 value) {
+    if (address.in_range(0xA000, 0xBFFF)) {
+        write_ram(address, value);
+        return;
     }
 
-    if (address.in_range(0x4000, 0x7FFF)) {
-        u16 address_into_bank = address.value() - 0x4000;
-        uint bank_offset = 0x4000 * rom_bank.value();
+    if (address.in_range(0x0000, 0x1FFF)) {
+        ram_enabled = ram_enable_value(value);
+    }
 
-        uint address_in_rom = bank_offset + address_into_bank;
-        return rom.at(address_in_rom);
+    if (address.in_range(0x2000, 0x2FFF)) {
+        rom_bank.set((rom_bank.value() & 0x100) | value);
     }
 
-    if (address.in_range(0xA000, 0xBFFF)) {
-        auto offset_into_ram = 0x2000 * ram_bank.value();
-        auto address_in_ram = (address - 0xA000) + offset_into_ram;
-        return ram.at(address_in_ram.value());
+    if (address.in_range(0x3000, 0x3FFF)) {
+        rom_bank.set(static_cast<u16>(((value & 0x01) << 8) | (rom_bank.value() & 0xFF)));
     }
 
-    fatal_error("Attempted to read from unmapped MBC1 address 0x%x", address.value());
+    if (address.in_range(0x4000, 0x5FFF)) {
+        ram_bank.set(value & 0x0F);
+    }
+
+    update_banks();
+}
+
+void MBC5::update_banks() {
+    switch_banks(0x0, rom_bank.value(), ram_enabled, ram_bank.value());
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "cartridge_info.h"
+#include "rom_image.h"
 #include "../address.h"
 #include "../register.h"
 
@@ -11,79 +12,156 @@
 class Cartridge {
 public:
     Cartridge(
-        std::vector<u8> rom_data,
+        std::shared_ptr<const RomImage> rom_image,
         std::vector<u8> ram_data,
-        std::unique_ptr<CartridgeInfo> cartridge_info
+        std::unique_ptr<CartridgeInfo> cartridge_info,
+        uint built_in_ram_size = 0
     );
     virtual ~Cartridge() = default;
 
-    virtual u8 read(const Address& address) const = 0;
+    /* Reads go straight through the current bank pointers */
+    u8 read(const Address& address) const;
     virtual void write(const Address& address, u8 value) = 0;
 
+    /* Host memory currently visible through the cartridge's address ranges,
+     * which the MMU maps directly into its page table. The ROM pointers each
+     * cover a full 0x4000 byte bank. RAM is null while it is disabled, or if
+     * a bank doesn't fill 0xA000-0xBFFF and so has to go through
+     * read()/write() to be mirrored. */
+    const u8* rom_bank_0_memory() const { return rom_bank_0; }
+    const u8* rom_bank_memory() const { return rom_bank_n; }
+    u8* ram_bank_memory() const;
+
+    /* The ROM banks currently switched into 0x0000-0x3FFF and 0x4000-0x7FFF */
+    uint rom_bank_0_number() const { return rom_bank_0_index; }
+    uint rom_bank_number() const { return rom_bank_n_index; }
+
+    const RomImage& get_rom() const;
     const std::vector<u8>& get_cartridge_ram() const;
 
 protected:
-    std::vector<u8> rom;
+    /* Points the banked windows at new banks. Controllers call this after
+     * a write to one of their registers, so that reads never have to work
+     * out where a bank lives. Bank numbers wrap around the banks which the
+     * cartridge actually has. */
+    void switch_banks(uint bank_0, uint bank_n, bool ram_enabled, uint ram_bank_number);
+
+    void write_ram(const Address& address, u8 value);
+
+    std::shared_ptr<const RomImage> rom;
     std::vector<u8> ram;
 
     std::unique_ptr<CartridgeInfo> cartridge_info;
+
+private:
+    const u8* rom_bank_0;
+    const u8* rom_bank_n;
+    u8* ram_bank = nullptr;
+
+    uint rom_bank_0_index = 0;
+    uint rom_bank_n_index = 1;
+
+    uint rom_bank_mask;
+    uint ram_bank_mask;
+
+    /* Banks smaller than 0x2000 bytes are mirrored across 0xA000-0xBFFF */
+    uint ram_offset_mask;
 };
 
-std::shared_ptr<Cartridge> get_cartridge(std::vector<u8> rom_data, std::vector<u8> ram_data = {});
+std::shared_ptr<Cartridge> get_cartridge(std::shared_ptr<const RomImage> rom, std::vector<u8> ram_data = {});
 
 class NoMBC : public Cartridge {
 public:
     NoMBC(
-        std::vector<u8> rom_data,
+        std::shared_ptr<const RomImage> rom_image,
         std::vector<u8> ram_data,
         std::unique_ptr<CartridgeInfo> cartridge_info
     );
 
-    u8 read(const Address& address) const override;
     void write(const Address& address, u8 value) override;
 };
 
 class MBC1 : public Cartridge {
 public:
     MBC1(
-        std::vector<u8> rom_data,
+        std::shared_ptr<const RomImage> rom_image,
         std::vector<u8> ram_data,
         std::unique_ptr<CartridgeInfo> cartridge_info
     );
 
-    u8 read(const Address& address) const override;
     void write(const Address& address, u8 value) override;
 
 private:
-    WordRegister rom_bank;
-    WordRegister ram_bank;
+    void update_banks();
+
+    /* The lower five bits of the ROM bank number */
+    ByteRegister rom_bank;
+
+    /* Two more bits, either for the ROM bank or (in mode 1) the RAM bank */
+    ByteRegister upper_bank;
+
     bool ram_enabled = false;
 
-    // TODO: ROM/RAM Mode Select (6000-7FFF)
-    // This 1bit Register selects whether the two bits of the above register should
-    // be used as upper two bits of the ROM Bank, or as RAM Bank Number.
-    bool rom_banking_mode = true;
+    /* In mode 1 the upper bits also select the RAM bank and the ROM bank
+     * at 0x0000-0x3FFF, rather than only the bank at 0x4000-0x7FFF */
+    bool advanced_banking_mode = false;
+};
+
+class MBC2 : public Cartridge {
+public:
+    /* 512 half-bytes of RAM are built into the controller */
+    static const uint RAM_SIZE = 0x200;
+
+    MBC2(
+        std::shared_ptr<const RomImage> rom_image,
+        std::vector<u8> ram_data,
+        std::unique_ptr<CartridgeInfo> cartridge_info
+    );
+
+    void write(const Address& address, u8 value) override;
+
+private:
+    void update_banks();
+
+    ByteRegister rom_bank;
+    bool ram_enabled = false;
 };
 
 class MBC3 : public Cartridge {
 public:
     MBC3(
-        std::vector<u8> rom_data,
+        std::shared_ptr<const RomImage> rom_image,
         std::vector<u8> ram_data,
         std::unique_ptr<CartridgeInfo> cartridge_info
     );
 
-    u8 read(const Address& address) const override;
     void write(const Address& address, u8 value) override;
 
 private:
-    WordRegister rom_bank;
-    WordRegister ram_bank;
+    void update_banks();
+
+    ByteRegister rom_bank;
+    ByteRegister ram_bank;
     bool ram_enabled = false;
     bool ram_over_rtc = true;
+};
+
+class MBC5 : public Cartridge {
+public:
+    MBC5(
+        std::shared_ptr<const RomImage> rom_image,
+        std::vector<u8> ram_data,
+        std::unique_ptr<CartridgeInfo> cartridge_info
+    );
+
+    void write(const Address& address, u8 value) override;
+
+private:
+    void update_banks();
 
-    // TODO: ROM/RAM Mode Select (6000-7FFF)
-    // This 1bit Register selects whether the two bits of the above register should
-    // be used as upper two bits of the ROM Bank, or as RAM Bank Number.
-    bool rom_banking_mode = true;
+    /* Nine bits, written in two halves. Unlike the other controllers, bank
+     * 0 can be switched into 0x4000-0x7FFF. */
+    WordRegister rom_bank;
+    ByteRegister ram_bank;
+    bool ram_enabled = false;
 };
@@ -2,7 +2,7 @@
 
 #include "../util/log.h"
 
-std::unique_ptr<CartridgeInfo> get_info(std::vector<u8> rom) {
+std::unique_ptr<CartridgeInfo> get_info(const RomImage& rom) {
     std::unique_ptr<CartridgeInfo> info = std::make_unique<CartridgeInfo>();
 
     u8 type_code = rom[header::cartridge_type];
@@ -124,6 +124,8 @@ ROMSize get_rom_size(u8 size_code) {
             return ROMSize::MB2;
         case 0x07:
             return ROMSize::MB4;
+        case 0x08:
+            return ROMSize::MB8;
         case 0x52:
             return ROMSize::MB1p1;
         case 0x53:
@@ -154,6 +156,8 @@ std::string describe(ROMSize size) {
             return "2MB (128 banks)";
         case ROMSize::MB4:
             return "4MB (256 banks)";
+        case ROMSize::MB8:
+            return "8MB (512 banks)";
         case ROMSize::MB1p1:
             return "1.1MB (72 banks)";
         case ROMSize::MB1p2:
@@ -240,7 +244,7 @@ std::string describe(Destination destination) {
     }
 }
 
-std::string get_title(std::vector<u8>& rom) {
+std::string get_title(const RomImage& rom) {
     char name[TITLE_LENGTH] = {0};
 
     for (u8 i = 0; i < TITLE_LENGTH; i++) {
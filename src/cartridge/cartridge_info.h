@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../definitions.h"
+#include "rom_image.h"
 
 #include <string>
 #include <vector>
@@ -39,7 +40,7 @@ enum class CartridgeType {
 extern CartridgeType get_type(u8 type);
 extern std::string describe(CartridgeType type);
 
-extern std::string get_title(std::vector<u8>& rom);
+extern std::string get_title(const RomImage& rom);
 
 extern std::string get_license(u16 old_license, u16 new_license);
 
@@ -52,6 +53,7 @@ enum class ROMSize {
     MB1,
     MB2,
     MB4,
+    MB8,
     MB1p1,
     MB1p2,
     MB1p5,
@@ -100,4 +102,4 @@ public:
     bool supports_sgb;
 };
 
-extern std::unique_ptr<CartridgeInfo> get_info(std::vector<u8> rom);
+extern std::unique_ptr<CartridgeInfo> get_info(const RomImage& rom);
@@ -0,0 +1,64 @@
+#include "rom_image.h"
+
+#include "../util/files.h"
+#include "../util/log.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+std::shared_ptr<const RomImage> RomImage::load(const std::string& filename) {
+#ifndef _WIN32
+    int file = open(filename.c_str(), O_RDONLY);
+    if (file < 0) {
+        fatal_error("Cannot read from file: %s", filename.c_str());
+    }
+
+    struct stat status;
+    void* mapping = MAP_FAILED;
+
+    if (fstat(file, &status) == 0 && status.st_size > 0) {
+        mapping = mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+    }
+
+    /* The mapping stays valid once the file is closed */
+    close(file);
+
+    if (mapping != MAP_FAILED) {
+        std::shared_ptr<RomImage> image(new RomImage());
+        image->mapping = mapping;
+        image->bytes = static_cast<const u8*>(mapping);
+        image->length = static_cast<std::size_t>(status.st_size);
+        return image;
+    }
+#endif
+
+    return from_bytes(read_bytes(filename));
+}
+
+std::shared_ptr<const RomImage> RomImage::from_bytes(std::vector<u8> bytes) {
+    std::shared_ptr<RomImage> image(new RomImage());
+    image->buffer = std::move(bytes);
+    image->bytes = image->buffer.data();
+    image->length = image->buffer.size();
+    return image;
+}
+
+RomImage::~RomImage() {
+#ifndef _WIN32
+    if (mapping != nullptr) {
+        munmap(mapping, length);
+    }
+#endif
+}
+
+u8 RomImage::at(const std::size_t offset) const {
+    if (offset >= length) {
+        fatal_error("Read from 0x%zX, past the end of the %zu byte ROM", offset, length);
+    }
+
+    return bytes[offset];
+}
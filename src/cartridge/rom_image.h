@@ -0,0 +1,48 @@
+#pragma once
+
+#include "../definitions.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * A cartridge's ROM, which never changes once it's loaded. Loaded from a file,
+ * it's a read-only mapping of the file, so nothing is copied and the host only
+ * reads in the pages which are used. Images are shared through
+ * std::shared_ptr<const RomImage>, so any number of instances running the
+ * same game (e.g. the lockstep harness's pair) use a single copy.
+ */
+class RomImage : Noncopyable {
+public:
+    /* Falls back to reading the file into a buffer where it can't be mapped */
+    static std::shared_ptr<const RomImage> load(const std::string& filename);
+
+    /* For ROMs which don't come from a file */
+    static std::shared_ptr<const RomImage> from_bytes(std::vector<u8> bytes);
+
+    ~RomImage();
+
+    const u8* data() const { return bytes; }
+    std::size_t size() const { return length; }
+
+    u8 operator[](std::size_t offset) const { return bytes[offset]; }
+
+    /* As operator[], but reading past the end is a fatal error */
+    u8 at(std::size_t offset) const;
+
+    const u8* begin() const { return bytes; }
+    const u8* end() const { return bytes + length; }
+
+private:
+    RomImage() = default;
+
+    const u8* bytes = nullptr;
+    std::size_t length = 0;
+
+    /* Set when the image is a mapping of a file */
+    void* mapping = nullptr;
+
+    /* Otherwise, the image owns its bytes */
+    std::vector<u8> buffer;
+};
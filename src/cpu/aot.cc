@@ -0,0 +1,60 @@
+#include "aot.h"
+
+#include "cpu.h"
+
+#include <algorithm>
+
+/* Function-local, as generated files register themselves during static
+ * initialisation */
+static std::vector<AotProgram>& registered_programs() {
+    static std::vector<AotProgram> programs;
+    return programs;
+}
+
+const AotBlock* AotProgram::find(const uint key) const {
+    const AotBlock* end = blocks + block_count;
+
+    const AotBlock* found = std::lower_bound(blocks, end, key,
+        [](const AotBlock& block, uint k) { return block.key < k; });
+
+    if (found == end || found->key != key) { return nullptr; }
+    return found;
+}
+
+namespace aot {
+
+u64 hash_rom(const RomImage& rom) {
+    /* 64-bit FNV-1a */
+    u64 hash = 0xCBF29CE484222325;
+
+    for (u8 byte : rom) {
+        hash ^= byte;
+        hash *= 0x100000001B3;
+    }
+
+    return hash;
+}
+
+bool register_program(const AotProgram& program) {
+    registered_programs().push_back(program);
+    return true;
+}
+
+const AotProgram* find_program(const RomImage& rom) {
+    const std::vector<AotProgram>& programs = registered_programs();
+    if (programs.empty()) { return nullptr; }
+
+    u64 hash = hash_rom(rom);
+
+    for (const AotProgram& program : programs) {
+        if (program.rom_hash == hash) { return &program; }
+    }
+
+    return nullptr;
+}
+
+void set_pc(CPU& cpu, const u16 address) {
+    cpu.registers.pc = address;
+}
+
+} // namespace aot
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "jit.h"
+#include "../definitions.h"
+#include "../cartridge/rom_image.h"
+
+#include <cstddef>
+#include <vector>
+
+class CPU;
+
+/* A block of ROM translated by gbemu-aot: native code for its first 'length'
+ * instructions, which end at 'end', and the cycles they take */
+struct AotBlock {
+    uint key;
+    NativeBlock execute;
+    u16 end;
+    u8 length;
+    u8 cycles;
+    u8 cycles_branched;
+};
+
+/**
+ * The code translated ahead of time for one ROM, identified by a hash of its
+ * contents. The blocks are sorted by their BlockCache key (bank and address).
+ *
+ * Translations are registered by the files gbemu-aot generates when they're
+ * linked into a frontend. Code which wasn't reached when the ROM was walked
+ * (e.g. jumped to through HL, or in a bank which wasn't mapped at the time)
+ * and code in RAM are left to the interpreter.
+ */
+struct AotProgram {
+    u64 rom_hash;
+    const AotBlock* blocks;
+    std::size_t block_count;
+
+    const AotBlock* find(uint key) const;
+};
+
+namespace aot {
+
+u64 hash_rom(const RomImage& rom);
+
+/* Called from a static initialiser in each generated file */
+bool register_program(const AotProgram& program);
+
+/* The translation linked in for a ROM, or null if there isn't one */
+const AotProgram* find_program(const RomImage& rom);
+
+/* Sets pc before the last instruction of a translated block, the only one
+ * which can read it, or to the instruction a block stops short at */
+void set_pc(CPU& cpu, u16 address);
+
+/* An instruction's handler, and whether the memory it's about to access is
+ * plain, called directly by generated code (see opcode_handlers.h) */
+template <bool cb, u8 opcode> void execute(CPU& cpu, u16 operand);
+template <bool cb, u8 opcode> bool plain_memory(const CPU& cpu, u16 operand);
+
+} // namespace aot
@@ -0,0 +1,308 @@
+#include "block_cache.h"
+
+#include "aot.h"
+#include "cpu.h"
+#include "../mmu.h"
+#include "../util/bitwise.h"
+
+using bitwise::compose_bytes;
+
+/* Blocks are cut short after this many instructions so that a long run of
+ * straight-line code (e.g. an unrolled copy) doesn't make a huge block */
+const uint MAX_BLOCK_INSTRUCTIONS = 64;
+
+static bool ends_block(const OpcodeSpec& spec) {
+    switch (spec.operation) {
+        case Operation::JP:
+        case Operation::JR:
+        case Operation::CALL:
+        case Operation::RET:
+        case Operation::RETI:
+        case Operation::RST:
+        case Operation::HALT:
+        case Operation::STOP:
+        case Operation::UNDEFINED:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool matches(const Block& block, const uint index, const FusedIdiom& idiom) {
+    if (index + idiom.count > block.instructions.size()) { return false; }
+
+    for (uint i = 0; i < idiom.count; i++) {
+        const DecodedInstruction& instruction = block.instructions[index + i];
+        if (instruction.cb || instruction.opcode != idiom.opcodes[i]) { return false; }
+    }
+
+    return true;
+}
+
+/* Marks the idioms in a block which can be run by a single fused handler.
+ * Only ROM blocks are fused: a block in RAM could be discarded by one of the
+ * idiom's own writes while the fused handler is still running. */
+static void fuse(Block& block) {
+    if (block.start >= 0x8000) { return; }
+
+    for (uint index = 0; index < block.instructions.size(); index++) {
+        for (const FusedIdiom& idiom : CPU::fused_idioms) {
+            if (!matches(block, index, idiom)) { continue; }
+
+            DecodedInstruction& first = block.instructions[index];
+            const DecodedInstruction& last = block.instructions[index + idiom.count - 1];
+
+            uint cycles = 0;
+            for (uint i = 0; i < idiom.count; i++) {
+                cycles += block.instructions[index + i].cycles;
+            }
+
+            first.fused = idiom.execute;
+            first.fused_count = static_cast<u8>(idiom.count);
+            first.fused_length = static_cast<u8>(last.address + last.length - first.address);
+            first.fused_cycles = static_cast<u8>(cycles);
+            first.fused_cycles_branched = static_cast<u8>(cycles - last.cycles + last.cycles_branched);
+
+            index += idiom.count - 1;
+            break;
+        }
+    }
+}
+
+static bool may_idle(const DecodedInstruction& instruction) {
+    const OpcodeSpec& spec = instruction.cb
+        ? cb_opcode_specs[instruction.opcode]
+        : opcode_specs[instruction.opcode];
+
+    switch (spec.operation) {
+        case Operation::STOP:
+        case Operation::HALT:
+        case Operation::DI:
+        case Operation::EI:
+        case Operation::UNDEFINED:
+        case Operation::PUSH:
+        case Operation::POP:
+        case Operation::CALL:
+        case Operation::RET:
+        case Operation::RETI:
+        case Operation::RST:
+            return false;
+        default:
+            return !is_memory_operand(spec.dst);
+    }
+}
+
+/* Checks whether the block is a loop which could spin without any effect on
+ * the rest of the system, e.g. polling LY until it reaches a line */
+static void find_idle_loop(Block& block) {
+    const DecodedInstruction& last = block.instructions.back();
+    if (last.cb) { return; }
+
+    const OpcodeSpec& spec = opcode_specs[last.opcode];
+
+    uint target;
+    if (spec.operation == Operation::JR) {
+        target = static_cast<u16>(last.address + last.length + static_cast<s8>(last.operand));
+    } else if (spec.operation == Operation::JP && spec.src == Operand::Imm16) {
+        target = last.operand;
+    } else {
+        return;
+    }
+
+    if (target != block.start) { return; }
+
+    uint cycles = 0;
+    for (const DecodedInstruction& instruction : block.instructions) {
+        if (!may_idle(instruction)) { return; }
+        cycles += instruction.cycles;
+    }
+
+    block.may_idle = true;
+    block.loop_cycles = cycles - last.cycles + last.cycles_branched;
+}
+
+BlockCache::BlockCache(MMU& inMMU) :
+    mmu(inMMU)
+{
+}
+
+Block* BlockCache::lookup(const u16 address) {
+    uint key;
+    uint region_end;
+    if (!key_for(address, key, region_end)) { return nullptr; }
+
+    auto cached = blocks.find(key);
+    if (cached != blocks.end()) { return &cached->second; }
+
+    auto read = [this](u16 code_address) { return mmu.read(code_address); };
+
+    Block block;
+    if (!decode(read, address, region_end, block)) { return nullptr; }
+
+    protect(key, block);
+    attach_translation(key, block);
+
+    return &blocks.emplace(key, std::move(block)).first->second;
+}
+
+uint code_bank(const MMU& mmu, const u16 address) {
+    if (address < 0x0100 && mmu.boot_rom_mapped()) { return BOOT_ROM_BANK; }
+    if (address < 0x4000) { return mmu.mapped_rom_bank_0(); }
+    if (address < 0x8000) { return mmu.mapped_rom_bank(); }
+
+    return 0;
+}
+
+bool BlockCache::key_for(const u16 address, uint& key, uint& region_end) const {
+    /* During an accurate OAM DMA transfer, code outside HRAM reads as 0xFF */
+    if (mmu.bus_blocked() && address < 0xFF80) { return false; }
+
+    if (address < 0x0100 && mmu.boot_rom_mapped()) {
+        region_end = 0x0100;
+    } else if (address < 0x4000) {
+        region_end = 0x4000;
+    } else if (address < 0x8000) {
+        region_end = 0x8000;
+    } else if (address >= 0xC000 && address < 0xE000) {
+        region_end = 0xE000;
+    } else if (address >= 0xFF80 && address < 0xFFFF) {
+        region_end = 0xFFFF;
+    } else {
+        return false;
+    }
+
+    key = block_key(code_bank(mmu, address), address);
+    return true;
+}
+
+bool BlockCache::decode(const CodeReader& read, const u16 address, const uint region_end, Block& block) {
+    uint pc = address;
+
+    while (block.instructions.size() < MAX_BLOCK_INSTRUCTIONS) {
+        u8 opcode = read(static_cast<u16>(pc));
+
+        bool cb = opcode == 0xCB;
+        if (cb && pc + 1 >= region_end) { break; }
+
+        if (cb) { opcode = read(static_cast<u16>(pc + 1)); }
+
+        const Opcode& op = cb ? CPU::cb_opcodes[opcode] : CPU::opcodes[opcode];
+        if (pc + op.length > region_end) { break; }
+
+        u16 operand = 0;
+        if (!cb && op.length == 2) {
+            operand = read(static_cast<u16>(pc + 1));
+        } else if (!cb && op.length == 3) {
+            u8 low_byte = read(static_cast<u16>(pc + 1));
+            u8 high_byte = read(static_cast<u16>(pc + 2));
+            operand = compose_bytes(high_byte, low_byte);
+        }
+
+        block.instructions.push_back({
+            op.execute, static_cast<u16>(pc), operand, opcode,
+            op.length, op.cycles, op.cycles_branched, cb
+        });
+
+        pc += op.length;
+
+        if (!cb && ends_block(opcode_specs[opcode])) { break; }
+    }
+
+    block.start = address;
+    block.end = static_cast<u16>(pc);
+
+    fuse(block);
+
+    if (!block.instructions.empty()) {
+        find_idle_loop(block);
+    }
+
+    return !block.instructions.empty();
+}
+
+void BlockCache::use_translation(const AotProgram* program) {
+    translation = program;
+}
+
+void BlockCache::attach_translation(const uint key, Block& block) const {
+    if (translation == nullptr) { return; }
+
+    const AotBlock* translated = translation->find(key);
+    if (translated == nullptr) { return; }
+
+    /* The translation was made from the same ROM, so this only fails if the
+     * two disagree about where the native part of the block ends */
+    if (translated->length == 0 || translated->length > block.instructions.size()) { return; }
+
+    const DecodedInstruction& last = block.instructions[translated->length - 1];
+    if (last.address + last.length != translated->end) { return; }
+
+    block.native = translated->execute;
+    block.native_length = translated->length;
+    block.native_cycles = translated->cycles;
+    block.native_cycles_branched = translated->cycles_branched;
+}
+
+void BlockCache::protect(const uint key, const Block& block) {
+    /* ROM can't be written to, so only blocks in RAM need to be tracked */
+    if (block.start < 0x8000) { return; }
+
+    for (uint page = block.start / PAGE_SIZE; page <= (block.end - 1u) / PAGE_SIZE; page++) {
+        page_blocks[page].push_back(key);
+        mmu.set_code_page(page, true);
+    }
+}
+
+void BlockCache::invalidate(const u16 address) {
+    uint page = address / PAGE_SIZE;
+
+    std::vector<uint>& keys = page_blocks[page];
+    if (keys.empty()) { return; }
+
+    for (auto key = keys.begin(); key != keys.end();) {
+        auto cached = blocks.find(*key);
+
+        /* The block may already have been discarded through another page */
+        if (cached == blocks.end()) {
+            key = keys.erase(key);
+            continue;
+        }
+
+        const Block& block = cached->second;
+        if (address >= block.start && address < block.end) {
+            blocks.erase(cached);
+            key = keys.erase(key);
+            current_generation++;
+            continue;
+        }
+
+        ++key;
+    }
+
+    if (keys.empty()) {
+        mmu.set_code_page(page, false);
+    }
+}
+
+void BlockCache::discard_compiled_code() {
+    for (auto& cached : blocks) {
+        Block& block = cached.second;
+        if (block.native == nullptr) { continue; }
+
+        block.executions = 0;
+        block.native = nullptr;
+        block.native_length = 0;
+        block.native_cycles = 0;
+        block.native_cycles_branched = 0;
+
+        attach_translation(cached.first, block);
+    }
+}
+
+uint BlockCache::generation() const {
+    return current_generation;
+}
+
+void BlockCache::remapped() {
+    current_generation++;
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "jit.h"
+#include "../definitions.h"
+
+#include <array>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+class MMU;
+class CPU;
+struct AotProgram;
+
+using OpcodeHandler = void (*)(CPU& cpu, u16 operand);
+
+/* Whether the memory an instruction is about to access is plain RAM or ROM,
+ * given the registers as they are now */
+using MemoryGuard = bool (*)(const CPU& cpu, u16 operand);
+
+struct DecodedInstruction;
+
+/* Runs a fused idiom, given the decoded instructions it's made up of, and
+ * returns how many of them were run. It stops early if one of them raises an
+ * interrupt, changes the memory map or brings an event due. */
+using FusedHandler = uint (*)(CPU& cpu, const DecodedInstruction* instructions);
+
+/* An instruction which has already been fetched and decoded, so executing it
+ * only has to advance pc and call its handler */
+struct DecodedInstruction {
+    OpcodeHandler execute;
+    u16 address;
+    u16 operand;
+    u8 opcode;
+    u8 length;
+    u8 cycles;
+    u8 cycles_branched;
+    bool cb;
+
+    /* Set on the first instruction of an idiom which can run as a single
+     * fused handler, along with the totals for the whole idiom */
+    FusedHandler fused = nullptr;
+    u8 fused_count = 0;
+    u8 fused_length = 0;
+    u8 fused_cycles = 0;
+    u8 fused_cycles_branched = 0;
+};
+
+/* Reads a byte of the code being decoded */
+using CodeReader = std::function<u8(u16 address)>;
+
+/* Stands in for the ROM bank while the boot ROM is mapped over 0x0000-0x00FF */
+const uint BOOT_ROM_BANK = 0xFFFF;
+
+/* Blocks are cached by their address and the ROM bank they were decoded from */
+inline uint block_key(const uint bank, const u16 address) {
+    return (bank << 16) | address;
+}
+
+/* The ROM bank which code at address is read from, BOOT_ROM_BANK, or 0 if the
+ * address isn't in ROM */
+uint code_bank(const MMU& mmu, u16 address);
+
+/* A run of straight-line instructions, ending at the first instruction which
+ * can change the flow of control */
+struct Block {
+    u16 start;
+    u16 end;
+    std::vector<DecodedInstruction> instructions;
+
+    /* How often the block has been entered, and the native code compiled for
+     * its first native_length instructions once it became hot */
+    uint executions = 0;
+    NativeBlock native = nullptr;
+    uint native_length = 0;
+    uint native_cycles = 0;
+    uint native_cycles_branched = 0;
+
+    /* Set when the block loops back to its own start without writing to
+     * memory, so that if it starts an iteration in the same state as the last
+     * one, it will keep doing so until an event changes what it reads.
+     * loop_cycles is the length of one iteration. */
+    bool may_idle = false;
+    uint loop_cycles = 0;
+};
+
+/**
+ * Caches decoded blocks of code, keyed by their address and the ROM bank (or
+ * boot ROM) mapped there. Only ROM, work RAM and HRAM are cached; blocks in RAM
+ * are thrown away when the memory they were decoded from is written to.
+ */
+class BlockCache {
+public:
+    BlockCache(MMU& inMMU);
+
+    /* Returns the block starting at address, decoding it on a miss, or null if
+     * code at that address can't be cached */
+    Block* lookup(u16 address);
+
+    /* Discards any blocks decoded from address */
+    void invalidate(u16 address);
+
+    /* Attaches the code translated ahead of time for this ROM (by gbemu-aot)
+     * to the blocks it covers as they're decoded */
+    void use_translation(const AotProgram* program);
+
+    /* Decodes the block starting at address, stopping at region_end. Used
+     * for the cache, and by gbemu-aot to walk a ROM. */
+    static bool decode(const CodeReader& read, u16 address, uint region_end, Block& block);
+
+    /* Forgets the code the JIT compiled for every block, so that its buffer
+     * can be reused. Code translated ahead of time is kept. */
+    void discard_compiled_code();
+
+    /* Incremented whenever blocks are discarded or the memory map changes, so
+     * a block which is part way through executing can be dropped */
+    uint generation() const;
+    void remapped();
+
+private:
+    /* Works out the key for code at address and the end of the region of
+     * memory it's in, returning false if it isn't cacheable */
+    bool key_for(u16 address, uint& key, uint& region_end) const;
+
+    void protect(uint key, const Block& block);
+    void attach_translation(uint key, Block& block) const;
+
+    MMU& mmu;
+    const AotProgram* translation = nullptr;
+
+    std::unordered_map<uint, Block> blocks;
+
+    /* The blocks overlapping each page of RAM, for invalidation */
+    std::array<std::vector<uint>, 0x100> page_blocks;
+
+    uint current_generation = 0;
+};
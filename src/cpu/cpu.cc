@@ -1,33 +1,151 @@
 #include "cpu.h"
 
-#include "opcode_cycles.h"
-#include "opcode_names.h"
 #include "../util/bitwise.h"
 #include "../util/log.h"
 
+#include <cstring>
+
 using bitwise::compose_bytes;
 
-CPU::CPU(MMU& inMMU, Options& inOptions) :
+CPU::CPU(MMU& inMMU, Scheduler& inScheduler, Options& inOptions) :
     mmu(inMMU),
+    scheduler(inScheduler),
     options(inOptions),
-    af(a, f),
-    bc(b, c),
-    de(d, e),
-    hl(h, l)
+    interrupts(registers),
+    block_cache(inMMU),
+    jit(*this, inMMU)
 {
+#ifdef GBEMU_PROFILE
+    if (!options.profile.empty()) {
+        profiler = std::make_unique<Profiler>(mmu, options.profile);
+    }
+
+    bool profiling = profiler != nullptr;
+#else
+    if (!options.profile.empty()) {
+        log_warn("--profile has no effect unless built with GBEMU_PROFILE");
+    }
+
+    bool profiling = false;
+#endif
+
+    every_instruction = options.trace || options.debugger || options.opcode_histogram || profiling;
+
+    /* Compiled blocks, fused idioms and skipped idle loops bypass tracing and
+     * the debugger's per-instruction checks. All of them work on decoded
+     * blocks, so they go along with the block cache. */
+    block_cache_enabled = options.block_cache;
+
+    bool fast_paths = block_cache_enabled && !every_instruction;
+    jit_enabled = options.jit && fast_paths;
+    native_enabled = jit_enabled;
+    fusion_enabled = options.fusion && fast_paths;
+    idle_detection_enabled = options.idle_skipping && fast_paths;
+    chain_instructions = options.chain_instructions && fast_paths;
+
+    if (options.opcode_histogram) {
+        histogram = std::make_unique<OpcodeHistogram>();
+    }
+
+#ifdef GBEMU_TRACE
+    if (options.trace) {
+        trace = std::make_unique<InstructionTrace>();
+    }
+#else
+    if (options.trace) {
+        log_warn("--trace has no effect unless built with GBEMU_TRACE");
+    }
+#endif
+}
+
+CPU::~CPU() {
+    if (histogram) {
+        histogram->write(stderr);
+    }
+
+#ifdef GBEMU_TRACE
+    if (trace) {
+        trace->write(stdout);
+    }
+#endif
+
+#ifdef GBEMU_PROFILE
+    if (profiler) {
+        profiler->write();
+    }
+#endif
 }
 
 Cycles CPU::tick() {
-    handle_interrupts();
+    idle_cycles = 0;
+
+    if (interrupts.dispatch_pending()) { service_interrupt(); }
+
+    /* A pending interrupt ends a HALT even if it isn't going to be serviced */
+    if (registers.halted) {
+        if (!interrupts.requested()) { return 1; }
+        registers.halted = false;
+    }
 
-    if (halted) { return 1; }
+    if (block_cache_enabled && next_decoded_instruction()) {
+        if (block_index == 0 && block->may_idle && idle_detection_enabled) {
+            check_idle_loop();
+        }
 
-    u16 opcode_pc = pc.value();
+        if (native_enabled && block_index == 0) {
+            if (block->native != nullptr) {
+                if (native_block_fits()) { return execute_native(); }
+            } else if (jit_enabled && ++block->executions == JIT_THRESHOLD) {
+                jit.compile(*block);
+            }
+        }
+
+        if (chain_instructions) { return execute_block(); }
+
+        if (fusion_enabled && block->instructions[block_index].fused != nullptr && fused_idiom_fits()) {
+            return execute_fused();
+        }
+
+        return execute_decoded(block->instructions[block_index++]);
+    }
+
+    u16 opcode_pc = registers.pc;
     auto opcode = get_byte_from_pc();
     auto cycles = execute_opcode(opcode, opcode_pc);
     return cycles;
 }
 
+bool CPU::is_halted() const {
+    return registers.halted;
+}
+
+uint CPU::idle_loop_cycles() const {
+    return idle_cycles;
+}
+
+void CPU::events_handled() {
+    idle_block = nullptr;
+}
+
+void CPU::check_idle_loop() {
+    /* The loop can't write to memory, so an iteration which starts in the
+     * same state as the previous one, with no events in between and having
+     * only read things which change on events, will go on to do exactly the
+     * same thing again */
+    bool repeated = block == idle_block
+        && !mmu.clock_registers_read()
+        && std::memcmp(&registers, &idle_registers, sizeof(Registers)) == 0;
+
+    if (repeated) {
+        idle_cycles = block->loop_cycles;
+        return;
+    }
+
+    idle_block = block;
+    idle_registers = registers;
+    mmu.reset_clock_registers_read();
+}
+
 Cycles CPU::execute_opcode(const u8 opcode, u16 opcode_pc) {
     branch_taken = false;
 
@@ -39,50 +157,205 @@ Cycles CPU::execute_opcode(const u8 opcode, u16 opcode_pc) {
     return execute_normal_opcode(opcode, opcode_pc);
 }
 
-void CPU::handle_interrupts() {
-    if (interrupts_enabled) {
-        u8 fired_interrupts = interrupt_flag.value() & interrupt_enabled.value();
+bool CPU::next_decoded_instruction() {
+    u16 address = registers.pc;
+
+    /* Carry on through the current block unless control left it, or it may
+     * have been discarded */
+    bool in_block = block != nullptr
+        && block_generation == block_cache.generation()
+        && block_index < block->instructions.size()
+        && block->instructions[block_index].address == address;
+
+    if (!in_block) {
+        block = block_cache.lookup(address);
+        block_index = 0;
+        block_generation = block_cache.generation();
+
+        /* Leaving a loop ends the iteration being watched */
+        if (block != idle_block) { idle_block = nullptr; }
+
+        if (block == nullptr) { return false; }
+    }
+
+    return true;
+}
+
+Cycles CPU::execute_decoded(const DecodedInstruction& instruction) {
+    trace_instruction(instruction.address, instruction.opcode, instruction.cb);
+
+    if (histogram) {
+        histogram->record(instruction.address, instruction.length, instruction.opcode, instruction.cb);
+    }
+
+    /* Copied, as executing the instruction can discard the block it's in */
+    const DecodedInstruction decoded = instruction;
+
+    branch_taken = false;
+    registers.pc = static_cast<u16>(decoded.address + decoded.length);
+    decoded.execute(*this, decoded.operand);
+
+    uint cycles = !branch_taken
+        ? decoded.cycles
+        : decoded.cycles_branched;
+
+    profile_instruction(decoded.address, decoded.opcode, decoded.cb, cycles);
+    return cycles;
+}
+
+bool CPU::block_continues() const {
+    /* The generation is checked first, as the block may have been discarded */
+    return block_generation == block_cache.generation()
+        && block_index < block->instructions.size()
+        && scheduler.now() < scheduler.next_deadline()
+        && !interrupts.dispatch_pending()
+        && !registers.halted;
+}
+
+bool CPU::starts_before_next_event(const uint cycles) const {
+    return scheduler.now() + cycles < scheduler.next_deadline();
+}
+
+bool CPU::fused_idiom_fits() const {
+    const DecodedInstruction& first = block->instructions[block_index];
+    const DecodedInstruction& last = block->instructions[block_index + first.fused_count - 1];
+
+    return starts_before_next_event(first.fused_cycles - last.cycles);
+}
+
+bool CPU::native_block_fits() const {
+    const DecodedInstruction& last = block->instructions[block->native_length - 1];
+
+    return starts_before_next_event(block->native_cycles - last.cycles);
+}
+
+#ifndef GBEMU_THREADED_DISPATCH
+
+Cycles CPU::execute_block() {
+    uint cycles = 0;
+
+    do {
+        cycles += fusion_enabled && block->instructions[block_index].fused != nullptr && fused_idiom_fits()
+            ? execute_fused().cycles
+            : execute_decoded(block->instructions[block_index++]).cycles;
+
+        scheduler.set_in_flight_cycles(cycles);
+    } while (block_continues());
+
+    scheduler.set_in_flight_cycles(0);
+    return cycles;
+}
+
+#endif
 
-        if (!fired_interrupts) { return; }
+Cycles CPU::execute_native() {
+    branch_taken = false;
+    uint completed = block->native(*this);
+    block_index = completed;
+
+    if (completed == block->native_length) {
+        return !branch_taken
+            ? block->native_cycles
+            : block->native_cycles_branched;
+    }
 
-        halted = false;
-        stack_push(pc);
+    /* The block stopped short of an instruction which accesses memory that
+     * isn't plain. Only the last instruction can branch, so the ones before
+     * it took their usual cycles; the rest is left to the interpreter, once
+     * time has caught up with them. */
+    uint cycles = 0;
+    for (uint i = 0; i < completed; i++) {
+        cycles += block->instructions[i].cycles;
+    }
 
-        bool handled_interrupt = false;
+    if (completed > 0) { return cycles; }
 
-        handled_interrupt = handle_interrupt(0, interrupts::vblank, fired_interrupts);
-        if (handled_interrupt) { return; }
+    return execute_decoded(block->instructions[block_index++]);
+}
 
-        handled_interrupt = handle_interrupt(1, interrupts::lcdc_status, fired_interrupts);
-        if (handled_interrupt) { return; }
+Cycles CPU::execute_fused() {
+    /* Idioms are only fused in ROM, so the block can't be discarded while
+     * they run */
+    const DecodedInstruction* instructions = &block->instructions[block_index];
+    const DecodedInstruction& first = instructions[0];
 
-        handled_interrupt = handle_interrupt(2, interrupts::timer, fired_interrupts);
-        if (handled_interrupt) { return; }
+    /* Only the last instruction of an idiom can read pc */
+    branch_taken = false;
+    registers.pc = static_cast<u16>(first.address + first.fused_length);
+    uint completed = first.fused(*this, instructions);
 
-        handled_interrupt = handle_interrupt(3, interrupts::serial, fired_interrupts);
-        if (handled_interrupt) { return; }
+    block_index += completed;
 
-        handled_interrupt = handle_interrupt(4, interrupts::joypad, fired_interrupts);
-        if (handled_interrupt) { return; }
+    if (completed == first.fused_count) {
+        return !branch_taken
+            ? first.fused_cycles
+            : first.fused_cycles_branched;
     }
+
+    /* Stopped after an instruction which raised an interrupt, remapped
+     * memory or brought an event due. None of those run so far can have
+     * branched. */
+    registers.pc = instructions[completed].address;
+
+    uint cycles = 0;
+    for (uint i = 0; i < completed; i++) {
+        cycles += instructions[i].cycles;
+    }
+
+    return cycles;
 }
 
-bool CPU::handle_interrupt(u8 interrupt_bit, u16 interrupt_vector, u8 fired_interrupts) {
-    using bitwise::check_bit;
+void CPU::code_written(const u16 address) {
+    block_cache.invalidate(address);
+}
 
-    if (!check_bit(fired_interrupts, interrupt_bit)) { return false; }
+void CPU::code_remapped() {
+    block_cache.remapped();
+    fetch_page_number = PAGE_COUNT;
+}
 
-    interrupt_flag.set_bit_to(interrupt_bit, false);
-    pc.set(interrupt_vector);
-    interrupts_enabled = false;
-    return true;
+void CPU::use_translation(const AotProgram* program) {
+    if (program == nullptr || every_instruction || !block_cache_enabled) { return; }
+
+    block_cache.use_translation(program);
+    native_enabled = true;
+}
+
+void CPU::set_post_boot_registers() {
+    registers.set_af(0x01B0);
+    registers.bc = 0x0013;
+    registers.de = 0x00D8;
+    registers.hl = 0x014D;
+    registers.sp = 0xFFFE;
+    registers.pc = 0x0100;
+}
+
+void CPU::service_interrupt() {
+    idle_block = nullptr;
+    registers.halted = false;
+    stack_push(registers.pc);
+    registers.pc = interrupts.acknowledge();
+
+#ifdef GBEMU_PROFILE
+    if (profiler) { profiler->interrupt(registers.pc); }
+#endif
+}
+
+void CPU::load_fetch_page(const uint page) {
+    fetch_page_number = page;
+    fetch_page = mmu.page_memory(page);
 }
 
 u8 CPU::get_byte_from_pc() {
-    u8 byte = mmu.read(Address(pc));
-    pc.increment();
+    u16 address = registers.pc++;
+
+    uint page = address / PAGE_SIZE;
+    if (page != fetch_page_number) { load_fetch_page(page); }
 
-    return byte;
+    /* Pages which aren't plain memory (e.g. IO) are read through the MMU */
+    if (fetch_page == nullptr) { return mmu.read(Address(address)); }
+
+    return fetch_page[address % PAGE_SIZE];
 }
 
 s8 CPU::get_signed_byte_from_pc() {
@@ -91,107 +364,83 @@ s8 CPU::get_signed_byte_from_pc() {
 }
 
 u16 CPU::get_word_from_pc() {
+    u16 address = registers.pc;
+    uint offset = address % PAGE_SIZE;
+
+    /* Both bytes are in the current page */
+    if (address / PAGE_SIZE == fetch_page_number && fetch_page != nullptr && offset + 1 < PAGE_SIZE) {
+        registers.pc = static_cast<u16>(address + 2);
+        return compose_bytes(fetch_page[offset + 1], fetch_page[offset]);
+    }
+
     u8 low_byte = get_byte_from_pc();
     u8 high_byte = get_byte_from_pc();
 
     return compose_bytes(high_byte, low_byte);
 }
 
-void CPU::set_flag_zero(bool set) { f.set_flag_zero(set); }
-void CPU::set_flag_subtract(bool set) { f.set_flag_subtract(set); }
-void CPU::set_flag_half_carry(bool set) { f.set_flag_half_carry(set); }
-void CPU::set_flag_carry(bool set) { f.set_flag_carry(set); }
-
-bool CPU::is_condition(Condition condition) {
-    bool should_branch;
-
-    switch (condition) {
-        case Condition::C:
-            should_branch = f.flag_carry();
-            break;
-        case Condition::NC:
-            should_branch = !f.flag_carry();
-            break;
-        case Condition::Z:
-            should_branch = f.flag_zero();
-            break;
-        case Condition::NZ:
-            should_branch = !f.flag_zero();
-            break;
+u16 CPU::get_operand_from_pc(u8 length) {
+    switch (length) {
+        case 2:
+            return get_byte_from_pc();
+        case 3:
+            return get_word_from_pc();
+        default:
+            return 0;
     }
-
-    /* If the branch is taken, remember so that the correct processor cycles
-     * can be used */
-    branch_taken = should_branch;
-    return should_branch;
 }
 
-void CPU::stack_push(const WordValue& reg) {
-    sp.decrement();
-    mmu.write(Address(sp), reg.high());
-    sp.decrement();
-    mmu.write(Address(sp), reg.low());
+void CPU::set_flag_zero(bool set) { registers.set_flag(0x80, set); }
+void CPU::set_flag_subtract(bool set) { registers.set_flag(0x40, set); }
+void CPU::set_flag_half_carry(bool set) { registers.set_flag(0x20, set); }
+void CPU::set_flag_carry(bool set) { registers.set_flag(0x10, set); }
+
+void CPU::stack_push(const u16 value) {
+    registers.sp--;
+    mmu.write(Address(registers.sp), static_cast<u8>(value >> 8));
+    registers.sp--;
+    mmu.write(Address(registers.sp), static_cast<u8>(value));
 }
 
-void CPU::stack_pop(WordValue& reg) {
-    u8 low_byte = mmu.read(Address(sp));
-    sp.increment();
-    u8 high_byte = mmu.read(Address(sp));
-    sp.increment();
+u16 CPU::stack_pop() {
+    u8 low_byte = mmu.read(Address(registers.sp));
+    registers.sp++;
+    u8 high_byte = mmu.read(Address(registers.sp));
+    registers.sp++;
 
-    u16 value = compose_bytes(high_byte, low_byte);
-    reg.set(value);
+    return compose_bytes(high_byte, low_byte);
 }
 
-/* clang-format off */
 Cycles CPU::execute_normal_opcode(const u8 opcode, u16 opcode_pc) {
-    log_trace("0x%04X: %s (0x%x)", opcode_pc, opcode_names[opcode].c_str(), opcode);
-
-    switch (opcode) {
-        case 0x00: opcode_00(); break; case 0x01: opcode_01(); break; case 0x02: opcode_02(); break; case 0x03: opcode_03(); break; case 0x04: opcode_04(); break; case 0x05: opcode_05(); break; case 0x06: opcode_06(); break; case 0x07: opcode_07(); break; case 0x08: opcode_08(); break; case 0x09: opcode_09(); break; case 0x0A: opcode_0A(); break; case 0x0B: opcode_0B(); break; case 0x0C: opcode_0C(); break; case 0x0D: opcode_0D(); break; case 0x0E: opcode_0E(); break; case 0x0F: opcode_0F(); break;
-        case 0x10: opcode_10(); break; case 0x11: opcode_11(); break; case 0x12: opcode_12(); break; case 0x13: opcode_13(); break; case 0x14: opcode_14(); break; case 0x15: opcode_15(); break; case 0x16: opcode_16(); break; case 0x17: opcode_17(); break; case 0x18: opcode_18(); break; case 0x19: opcode_19(); break; case 0x1A: opcode_1A(); break; case 0x1B: opcode_1B(); break; case 0x1C: opcode_1C(); break; case 0x1D: opcode_1D(); break; case 0x1E: opcode_1E(); break; case 0x1F: opcode_1F(); break;
-        case 0x20: opcode_20(); break; case 0x21: opcode_21(); break; case 0x22: opcode_22(); break; case 0x23: opcode_23(); break; case 0x24: opcode_24(); break; case 0x25: opcode_25(); break; case 0x26: opcode_26(); break; case 0x27: opcode_27(); break; case 0x28: opcode_28(); break; case 0x29: opcode_29(); break; case 0x2A: opcode_2A(); break; case 0x2B: opcode_2B(); break; case 0x2C: opcode_2C(); break; case 0x2D: opcode_2D(); break; case 0x2E: opcode_2E(); break; case 0x2F: opcode_2F(); break;
-        case 0x30: opcode_30(); break; case 0x31: opcode_31(); break; case 0x32: opcode_32(); break; case 0x33: opcode_33(); break; case 0x34: opcode_34(); break; case 0x35: opcode_35(); break; case 0x36: opcode_36(); break; case 0x37: opcode_37(); break; case 0x38: opcode_38(); break; case 0x39: opcode_39(); break; case 0x3A: opcode_3A(); break; case 0x3B: opcode_3B(); break; case 0x3C: opcode_3C(); break; case 0x3D: opcode_3D(); break; case 0x3E: opcode_3E(); break; case 0x3F: opcode_3F(); break;
-        case 0x40: opcode_40(); break; case 0x41: opcode_41(); break; case 0x42: opcode_42(); break; case 0x43: opcode_43(); break; case 0x44: opcode_44(); break; case 0x45: opcode_45(); break; case 0x46: opcode_46(); break; case 0x47: opcode_47(); break; case 0x48: opcode_48(); break; case 0x49: opcode_49(); break; case 0x4A: opcode_4A(); break; case 0x4B: opcode_4B(); break; case 0x4C: opcode_4C(); break; case 0x4D: opcode_4D(); break; case 0x4E: opcode_4E(); break; case 0x4F: opcode_4F(); break;
-        case 0x50: opcode_50(); break; case 0x51: opcode_51(); break; case 0x52: opcode_52(); break; case 0x53: opcode_53(); break; case 0x54: opcode_54(); break; case 0x55: opcode_55(); break; case 0x56: opcode_56(); break; case 0x57: opcode_57(); break; case 0x58: opcode_58(); break; case 0x59: opcode_59(); break; case 0x5A: opcode_5A(); break; case 0x5B: opcode_5B(); break; case 0x5C: opcode_5C(); break; case 0x5D: opcode_5D(); break; case 0x5E: opcode_5E(); break; case 0x5F: opcode_5F(); break;
-        case 0x60: opcode_60(); break; case 0x61: opcode_61(); break; case 0x62: opcode_62(); break; case 0x63: opcode_63(); break; case 0x64: opcode_64(); break; case 0x65: opcode_65(); break; case 0x66: opcode_66(); break; case 0x67: opcode_67(); break; case 0x68: opcode_68(); break; case 0x69: opcode_69(); break; case 0x6A: opcode_6A(); break; case 0x6B: opcode_6B(); break; case 0x6C: opcode_6C(); break; case 0x6D: opcode_6D(); break; case 0x6E: opcode_6E(); break; case 0x6F: opcode_6F(); break;
-        case 0x70: opcode_70(); break; case 0x71: opcode_71(); break; case 0x72: opcode_72(); break; case 0x73: opcode_73(); break; case 0x74: opcode_74(); break; case 0x75: opcode_75(); break; case 0x76: opcode_76(); break; case 0x77: opcode_77(); break; case 0x78: opcode_78(); break; case 0x79: opcode_79(); break; case 0x7A: opcode_7A(); break; case 0x7B: opcode_7B(); break; case 0x7C: opcode_7C(); break; case 0x7D: opcode_7D(); break; case 0x7E: opcode_7E(); break; case 0x7F: opcode_7F(); break;
-        case 0x80: opcode_80(); break; case 0x81: opcode_81(); break; case 0x82: opcode_82(); break; case 0x83: opcode_83(); break; case 0x84: opcode_84(); break; case 0x85: opcode_85(); break; case 0x86: opcode_86(); break; case 0x87: opcode_87(); break; case 0x88: opcode_88(); break; case 0x89: opcode_89(); break; case 0x8A: opcode_8A(); break; case 0x8B: opcode_8B(); break; case 0x8C: opcode_8C(); break; case 0x8D: opcode_8D(); break; case 0x8E: opcode_8E(); break; case 0x8F: opcode_8F(); break;
-        case 0x90: opcode_90(); break; case 0x91: opcode_91(); break; case 0x92: opcode_92(); break; case 0x93: opcode_93(); break; case 0x94: opcode_94(); break; case 0x95: opcode_95(); break; case 0x96: opcode_96(); break; case 0x97: opcode_97(); break; case 0x98: opcode_98(); break; case 0x99: opcode_99(); break; case 0x9A: opcode_9A(); break; case 0x9B: opcode_9B(); break; case 0x9C: opcode_9C(); break; case 0x9D: opcode_9D(); break; case 0x9E: opcode_9E(); break; case 0x9F: opcode_9F(); break;
-        case 0xA0: opcode_A0(); break; case 0xA1: opcode_A1(); break; case 0xA2: opcode_A2(); break; case 0xA3: opcode_A3(); break; case 0xA4: opcode_A4(); break; case 0xA5: opcode_A5(); break; case 0xA6: opcode_A6(); break; case 0xA7: opcode_A7(); break; case 0xA8: opcode_A8(); break; case 0xA9: opcode_A9(); break; case 0xAA: opcode_AA(); break; case 0xAB: opcode_AB(); break; case 0xAC: opcode_AC(); break; case 0xAD: opcode_AD(); break; case 0xAE: opcode_AE(); break; case 0xAF: opcode_AF(); break;
-        case 0xB0: opcode_B0(); break; case 0xB1: opcode_B1(); break; case 0xB2: opcode_B2(); break; case 0xB3: opcode_B3(); break; case 0xB4: opcode_B4(); break; case 0xB5: opcode_B5(); break; case 0xB6: opcode_B6(); break; case 0xB7: opcode_B7(); break; case 0xB8: opcode_B8(); break; case 0xB9: opcode_B9(); break; case 0xBA: opcode_BA(); break; case 0xBB: opcode_BB(); break; case 0xBC: opcode_BC(); break; case 0xBD: opcode_BD(); break; case 0xBE: opcode_BE(); break; case 0xBF: opcode_BF(); break;
-        case 0xC0: opcode_C0(); break; case 0xC1: opcode_C1(); break; case 0xC2: opcode_C2(); break; case 0xC3: opcode_C3(); break; case 0xC4: opcode_C4(); break; case 0xC5: opcode_C5(); break; case 0xC6: opcode_C6(); break; case 0xC7: opcode_C7(); break; case 0xC8: opcode_C8(); break; case 0xC9: opcode_C9(); break; case 0xCA: opcode_CA(); break; case 0xCB: opcode_CB(); break; case 0xCC: opcode_CC(); break; case 0xCD: opcode_CD(); break; case 0xCE: opcode_CE(); break; case 0xCF: opcode_CF(); break;
-        case 0xD0: opcode_D0(); break; case 0xD1: opcode_D1(); break; case 0xD2: opcode_D2(); break; case 0xD3: opcode_D3(); break; case 0xD4: opcode_D4(); break; case 0xD5: opcode_D5(); break; case 0xD6: opcode_D6(); break; case 0xD7: opcode_D7(); break; case 0xD8: opcode_D8(); break; case 0xD9: opcode_D9(); break; case 0xDA: opcode_DA(); break; case 0xDB: opcode_DB(); break; case 0xDC: opcode_DC(); break; case 0xDD: opcode_DD(); break; case 0xDE: opcode_DE(); break; case 0xDF: opcode_DF(); break;
-        case 0xE0: opcode_E0(); break; case 0xE1: opcode_E1(); break; case 0xE2: opcode_E2(); break; case 0xE3: opcode_E3(); break; case 0xE4: opcode_E4(); break; case 0xE5: opcode_E5(); break; case 0xE6: opcode_E6(); break; case 0xE7: opcode_E7(); break; case 0xE8: opcode_E8(); break; case 0xE9: opcode_E9(); break; case 0xEA: opcode_EA(); break; case 0xEB: opcode_EB(); break; case 0xEC: opcode_EC(); break; case 0xED: opcode_ED(); break; case 0xEE: opcode_EE(); break; case 0xEF: opcode_EF(); break;
-        case 0xF0: opcode_F0(); break; case 0xF1: opcode_F1(); break; case 0xF2: opcode_F2(); break; case 0xF3: opcode_F3(); break; case 0xF4: opcode_F4(); break; case 0xF5: opcode_F5(); break; case 0xF6: opcode_F6(); break; case 0xF7: opcode_F7(); break; case 0xF8: opcode_F8(); break; case 0xF9: opcode_F9(); break; case 0xFA: opcode_FA(); break; case 0xFB: opcode_FB(); break; case 0xFC: opcode_FC(); break; case 0xFD: opcode_FD(); break; case 0xFE: opcode_FE(); break; case 0xFF: opcode_FF(); break;
-    }
-
-    return !branch_taken
-        ? opcode_cycles[opcode]
-        : opcode_cycles_branched[opcode];
+    trace_instruction(opcode_pc, opcode, false);
+
+    const Opcode& op = opcodes[opcode];
+
+    if (histogram) {
+        histogram->record(opcode_pc, op.length, opcode, false);
+    }
+
+    op.execute(*this, get_operand_from_pc(op.length));
+
+    uint cycles = !branch_taken
+        ? op.cycles
+        : op.cycles_branched;
+
+    profile_instruction(opcode_pc, opcode, false, cycles);
+    return cycles;
 }
 
 Cycles CPU::execute_cb_opcode(const u8 opcode, u16 opcode_pc) {
-    log_trace("0x%04X: %s (CB 0x%x)", opcode_pc, opcode_cb_names[opcode].c_str(), opcode);
-
-    switch (opcode) {
-        case 0x00: opcode_CB_00(); break; case 0x01: opcode_CB_01(); break; case 0x02: opcode_CB_02(); break; case 0x03: opcode_CB_03(); break; case 0x04: opcode_CB_04(); break; case 0x05: opcode_CB_05(); break; case 0x06: opcode_CB_06(); break; case 0x07: opcode_CB_07(); break; case 0x08: opcode_CB_08(); break; case 0x09: opcode_CB_09(); break; case 0x0A: opcode_CB_0A(); break; case 0x0B: opcode_CB_0B(); break; case 0x0C: opcode_CB_0C(); break; case 0x0D: opcode_CB_0D(); break; case 0x0E: opcode_CB_0E(); break; case 0x0F: opcode_CB_0F(); break;
-        case 0x10: opcode_CB_10(); break; case 0x11: opcode_CB_11(); break; case 0x12: opcode_CB_12(); break; case 0x13: opcode_CB_13(); break; case 0x14: opcode_CB_14(); break; case 0x15: opcode_CB_15(); break; case 0x16: opcode_CB_16(); break; case 0x17: opcode_CB_17(); break; case 0x18: opcode_CB_18(); break; case 0x19: opcode_CB_19(); break; case 0x1A: opcode_CB_1A(); break; case 0x1B: opcode_CB_1B(); break; case 0x1C: opcode_CB_1C(); break; case 0x1D: opcode_CB_1D(); break; case 0x1E: opcode_CB_1E(); break; case 0x1F: opcode_CB_1F(); break;
-        case 0x20: opcode_CB_20(); break; case 0x21: opcode_CB_21(); break; case 0x22: opcode_CB_22(); break; case 0x23: opcode_CB_23(); break; case 0x24: opcode_CB_24(); break; case 0x25: opcode_CB_25(); break; case 0x26: opcode_CB_26(); break; case 0x27: opcode_CB_27(); break; case 0x28: opcode_CB_28(); break; case 0x29: opcode_CB_29(); break; case 0x2A: opcode_CB_2A(); break; case 0x2B: opcode_CB_2B(); break; case 0x2C: opcode_CB_2C(); break; case 0x2D: opcode_CB_2D(); break; case 0x2E: opcode_CB_2E(); break; case 0x2F: opcode_CB_2F(); break;
-        case 0x30: opcode_CB_30(); break; case 0x31: opcode_CB_31(); break; case 0x32: opcode_CB_32(); break; case 0x33: opcode_CB_33(); break; case 0x34: opcode_CB_34(); break; case 0x35: opcode_CB_35(); break; case 0x36: opcode_CB_36(); break; case 0x37: opcode_CB_37(); break; case 0x38: opcode_CB_38(); break; case 0x39: opcode_CB_39(); break; case 0x3A: opcode_CB_3A(); break; case 0x3B: opcode_CB_3B(); break; case 0x3C: opcode_CB_3C(); break; case 0x3D: opcode_CB_3D(); break; case 0x3E: opcode_CB_3E(); break; case 0x3F: opcode_CB_3F(); break;
-        case 0x40: opcode_CB_40(); break; case 0x41: opcode_CB_41(); break; case 0x42: opcode_CB_42(); break; case 0x43: opcode_CB_43(); break; case 0x44: opcode_CB_44(); break; case 0x45: opcode_CB_45(); break; case 0x46: opcode_CB_46(); break; case 0x47: opcode_CB_47(); break; case 0x48: opcode_CB_48(); break; case 0x49: opcode_CB_49(); break; case 0x4A: opcode_CB_4A(); break; case 0x4B: opcode_CB_4B(); break; case 0x4C: opcode_CB_4C(); break; case 0x4D: opcode_CB_4D(); break; case 0x4E: opcode_CB_4E(); break; case 0x4F: opcode_CB_4F(); break;
-        case 0x50: opcode_CB_50(); break; case 0x51: opcode_CB_51(); break; case 0x52: opcode_CB_52(); break; case 0x53: opcode_CB_53(); break; case 0x54: opcode_CB_54(); break; case 0x55: opcode_CB_55(); break; case 0x56: opcode_CB_56(); break; case 0x57: opcode_CB_57(); break; case 0x58: opcode_CB_58(); break; case 0x59: opcode_CB_59(); break; case 0x5A: opcode_CB_5A(); break; case 0x5B: opcode_CB_5B(); break; case 0x5C: opcode_CB_5C(); break; case 0x5D: opcode_CB_5D(); break; case 0x5E: opcode_CB_5E(); break; case 0x5F: opcode_CB_5F(); break;
-        case 0x60: opcode_CB_60(); break; case 0x61: opcode_CB_61(); break; case 0x62: opcode_CB_62(); break; case 0x63: opcode_CB_63(); break; case 0x64: opcode_CB_64(); break; case 0x65: opcode_CB_65(); break; case 0x66: opcode_CB_66(); break; case 0x67: opcode_CB_67(); break; case 0x68: opcode_CB_68(); break; case 0x69: opcode_CB_69(); break; case 0x6A: opcode_CB_6A(); break; case 0x6B: opcode_CB_6B(); break; case 0x6C: opcode_CB_6C(); break; case 0x6D: opcode_CB_6D(); break; case 0x6E: opcode_CB_6E(); break; case 0x6F: opcode_CB_6F(); break;
-        case 0x70: opcode_CB_70(); break; case 0x71: opcode_CB_71(); break; case 0x72: opcode_CB_72(); break; case 0x73: opcode_CB_73(); break; case 0x74: opcode_CB_74(); break; case 0x75: opcode_CB_75(); break; case 0x76: opcode_CB_76(); break; case 0x77: opcode_CB_77(); break; case 0x78: opcode_CB_78(); break; case 0x79: opcode_CB_79(); break; case 0x7A: opcode_CB_7A(); break; case 0x7B: opcode_CB_7B(); break; case 0x7C: opcode_CB_7C(); break; case 0x7D: opcode_CB_7D(); break; case 0x7E: opcode_CB_7E(); break; case 0x7F: opcode_CB_7F(); break;
-        case 0x80: opcode_CB_80(); break; case 0x81: opcode_CB_81(); break; case 0x82: opcode_CB_82(); break; case 0x83: opcode_CB_83(); break; case 0x84: opcode_CB_84(); break; case 0x85: opcode_CB_85(); break; case 0x86: opcode_CB_86(); break; case 0x87: opcode_CB_87(); break; case 0x88: opcode_CB_88(); break; case 0x89: opcode_CB_89(); break; case 0x8A: opcode_CB_8A(); break; case 0x8B: opcode_CB_8B(); break; case 0x8C: opcode_CB_8C(); break; case 0x8D: opcode_CB_8D(); break; case 0x8E: opcode_CB_8E(); break; case 0x8F: opcode_CB_8F(); break;
-        case 0x90: opcode_CB_90(); break; case 0x91: opcode_CB_91(); break; case 0x92: opcode_CB_92(); break; case 0x93: opcode_CB_93(); break; case 0x94: opcode_CB_94(); break; case 0x95: opcode_CB_95(); break; case 0x96: opcode_CB_96(); break; case 0x97: opcode_CB_97(); break; case 0x98: opcode_CB_98(); break; case 0x99: opcode_CB_99(); break; case 0x9A: opcode_CB_9A(); break; case 0x9B: opcode_CB_9B(); break; case 0x9C: opcode_CB_9C(); break; case 0x9D: opcode_CB_9D(); break; case 0x9E: opcode_CB_9E(); break; case 0x9F: opcode_CB_9F(); break;
-        case 0xA0: opcode_CB_A0(); break; case 0xA1: opcode_CB_A1(); break; case 0xA2: opcode_CB_A2(); break; case 0xA3: opcode_CB_A3(); break; case 0xA4: opcode_CB_A4(); break; case 0xA5: opcode_CB_A5(); break; case 0xA6: opcode_CB_A6(); break; case 0xA7: opcode_CB_A7(); break; case 0xA8: opcode_CB_A8(); break; case 0xA9: opcode_CB_A9(); break; case 0xAA: opcode_CB_AA(); break; case 0xAB: opcode_CB_AB(); break; case 0xAC: opcode_CB_AC(); break; case 0xAD: opcode_CB_AD(); break; case 0xAE: opcode_CB_AE(); break; case 0xAF: opcode_CB_AF(); break;
-        case 0xB0: opcode_CB_B0(); break; case 0xB1: opcode_CB_B1(); break; case 0xB2: opcode_CB_B2(); break; case 0xB3: opcode_CB_B3(); break; case 0xB4: opcode_CB_B4(); break; case 0xB5: opcode_CB_B5(); break; case 0xB6: opcode_CB_B6(); break; case 0xB7: opcode_CB_B7(); break; case 0xB8: opcode_CB_B8(); break; case 0xB9: opcode_CB_B9(); break; case 0xBA: opcode_CB_BA(); break; case 0xBB: opcode_CB_BB(); break; case 0xBC: opcode_CB_BC(); break; case 0xBD: opcode_CB_BD(); break; case 0xBE: opcode_CB_BE(); break; case 0xBF: opcode_CB_BF(); break;
-        case 0xC0: opcode_CB_C0(); break; case 0xC1: opcode_CB_C1(); break; case 0xC2: opcode_CB_C2(); break; case 0xC3: opcode_CB_C3(); break; case 0xC4: opcode_CB_C4(); break; case 0xC5: opcode_CB_C5(); break; case 0xC6: opcode_CB_C6(); break; case 0xC7: opcode_CB_C7(); break; case 0xC8: opcode_CB_C8(); break; case 0xC9: opcode_CB_C9(); break; case 0xCA: opcode_CB_CA(); break; case 0xCB: opcode_CB_CB(); break; case 0xCC: opcode_CB_CC(); break; case 0xCD: opcode_CB_CD(); break; case 0xCE: opcode_CB_CE(); break; case 0xCF: opcode_CB_CF(); break;
-        case 0xD0: opcode_CB_D0(); break; case 0xD1: opcode_CB_D1(); break; case 0xD2: opcode_CB_D2(); break; case 0xD3: opcode_CB_D3(); break; case 0xD4: opcode_CB_D4(); break; case 0xD5: opcode_CB_D5(); break; case 0xD6: opcode_CB_D6(); break; case 0xD7: opcode_CB_D7(); break; case 0xD8: opcode_CB_D8(); break; case 0xD9: opcode_CB_D9(); break; case 0xDA: opcode_CB_DA(); break; case 0xDB: opcode_CB_DB(); break; case 0xDC: opcode_CB_DC(); break; case 0xDD: opcode_CB_DD(); break; case 0xDE: opcode_CB_DE(); break; case 0xDF: opcode_CB_DF(); break;
-        case 0xE0: opcode_CB_E0(); break; case 0xE1: opcode_CB_E1(); break; case 0xE2: opcode_CB_E2(); break; case 0xE3: opcode_CB_E3(); break; case 0xE4: opcode_CB_E4(); break; case 0xE5: opcode_CB_E5(); break; case 0xE6: opcode_CB_E6(); break; case 0xE7: opcode_CB_E7(); break; case 0xE8: opcode_CB_E8(); break; case 0xE9: opcode_CB_E9(); break; case 0xEA: opcode_CB_EA(); break; case 0xEB: opcode_CB_EB(); break; case 0xEC: opcode_CB_EC(); break; case 0xED: opcode_CB_ED(); break; case 0xEE: opcode_CB_EE(); break; case 0xEF: opcode_CB_EF(); break;
-        case 0xF0: opcode_CB_F0(); break; case 0xF1: opcode_CB_F1(); break; case 0xF2: opcode_CB_F2(); break; case 0xF3: opcode_CB_F3(); break; case 0xF4: opcode_CB_F4(); break; case 0xF5: opcode_CB_F5(); break; case 0xF6: opcode_CB_F6(); break; case 0xF7: opcode_CB_F7(); break; case 0xF8: opcode_CB_F8(); break; case 0xF9: opcode_CB_F9(); break; case 0xFA: opcode_CB_FA(); break; case 0xFB: opcode_CB_FB(); break; case 0xFC: opcode_CB_FC(); break; case 0xFD: opcode_CB_FD(); break; case 0xFE: opcode_CB_FE(); break; case 0xFF: opcode_CB_FF(); break;
-    }
-
-    return opcode_cycles_cb[opcode];
+    trace_instruction(opcode_pc, opcode, true);
+
+    const Opcode& op = cb_opcodes[opcode];
+
+    if (histogram) {
+        histogram->record(opcode_pc, op.length, opcode, true);
+    }
+
+    op.execute(*this, 0);
+
+    profile_instruction(opcode_pc, opcode, true, op.cycles);
+    return op.cycles;
 }
@@ -0,0 +1,30 @@
+#include "instruction_trace.h"
+
+#include "opcode_names.h"
+
+#include <cinttypes>
+
+InstructionTrace::InstructionTrace() :
+    records(std::make_unique<TraceRecord[]>(CAPACITY))
+{
+}
+
+void InstructionTrace::write(FILE* file) const {
+    u64 first = next > CAPACITY ? next - CAPACITY : 0;
+
+    if (first > 0) {
+        fprintf(file, "(%" PRIu64 " earlier instructions were not kept)\n", first);
+    }
+
+    for (u64 index = first; index < next; index++) {
+        const TraceRecord& record = records[index & (CAPACITY - 1)];
+
+        const std::string& name = record.cb
+            ? opcode_cb_names[record.opcode]
+            : opcode_names[record.opcode];
+
+        fprintf(file, "%12" PRIu64 "  0x%04X: %-20s AF=%04X BC=%04X DE=%04X HL=%04X SP=%04X\n",
+            record.cycle, record.address, name.c_str(),
+            record.af, record.bc, record.de, record.hl, record.sp);
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "../definitions.h"
+
+#include <cstdio>
+#include <memory>
+
+/* The state before an instruction ran, as recorded with --trace */
+struct TraceRecord {
+    u64 cycle;
+    u16 address;
+    u16 af;
+    u16 bc;
+    u16 de;
+    u16 hl;
+    u16 sp;
+    u8 opcode;
+    bool cb;
+};
+
+static_assert(sizeof(TraceRecord) == 24, "Trace records should pack into 24 bytes");
+
+/**
+ * The most recent instructions, kept as fixed-size binary records in a ring
+ * so that recording one is just a copy. Nothing is formatted until the trace
+ * is written out, when the emulator exits.
+ */
+class InstructionTrace {
+public:
+    /* A power of two, so that wrapping around is a mask */
+    static const std::size_t CAPACITY = 1 << 16;
+
+    InstructionTrace();
+
+    void record(const TraceRecord& record) {
+        records[next++ & (CAPACITY - 1)] = record;
+    }
+
+    /* Writes a line per instruction, oldest first */
+    void write(FILE* file) const;
+
+private:
+    std::unique_ptr<TraceRecord[]> records;
+    u64 next = 0;
+};
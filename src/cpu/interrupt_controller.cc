@@ -0,0 +1,44 @@
+#include "interrupt_controller.h"
+
+/* Only the lower five bits of IF and IE correspond to interrupts */
+const u8 INTERRUPT_MASK = 0x1F;
+
+InterruptController::InterruptController(Registers& inRegisters) :
+    registers(inRegisters)
+{
+}
+
+void InterruptController::set_flag(const u8 value) {
+    interrupt_flag = value;
+    update();
+}
+
+void InterruptController::set_enabled(const u8 value) {
+    interrupt_enabled = value;
+    update();
+}
+
+void InterruptController::set_master_enabled(const bool enabled) {
+    registers.interrupts_enabled = enabled;
+    update();
+}
+
+void InterruptController::request(const Interrupt interrupt) {
+    interrupt_flag = static_cast<u8>(interrupt_flag | (1 << static_cast<uint>(interrupt)));
+    update();
+}
+
+u16 InterruptController::acknowledge() {
+    uint bit = static_cast<uint>(__builtin_ctz(dispatch_mask));
+
+    interrupt_flag = static_cast<u8>(interrupt_flag & ~(1 << bit));
+    registers.interrupts_enabled = false;
+    update();
+
+    return static_cast<u16>(INTERRUPT_VECTOR_BASE + bit * 8);
+}
+
+void InterruptController::update() {
+    requested_mask = interrupt_flag & interrupt_enabled & INTERRUPT_MASK;
+    dispatch_mask = registers.interrupts_enabled ? requested_mask : 0;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "../definitions.h"
+#include "registers.h"
+
+/* Interrupt sources, by their bit in IF and IE. Lower bits have priority. */
+enum class Interrupt : u8 {
+    VBlank = 0,
+    LcdStatus = 1,
+    Timer = 2,
+    Serial = 3,
+    Joypad = 4,
+};
+
+/* Interrupts jump to 0x40, 0x48, ... in order of their bit */
+const u16 INTERRUPT_VECTOR_BASE = 0x40;
+
+/**
+ * Holds IF and IE, and keeps the set of interrupts which are both requested
+ * and enabled up to date as they're written. The CPU only has to test the
+ * cached masks before each instruction, rather than working out which
+ * interrupt to take every time.
+ *
+ * The master enable (IME) stays in the CPU's registers. It's only changed
+ * through set_master_enabled, so that the masks follow it too.
+ */
+class InterruptController {
+public:
+    InterruptController(Registers& inRegisters);
+
+    u8 flag() const { return interrupt_flag; }
+    u8 enabled() const { return interrupt_enabled; }
+    bool master_enabled() const { return registers.interrupts_enabled; }
+
+    void set_flag(u8 value);
+    void set_enabled(u8 value);
+    void set_master_enabled(bool enabled);
+
+    /* Sets the interrupt's bit in IF */
+    void request(Interrupt interrupt);
+
+    /* Whether any interrupt is requested and enabled, which ends a HALT */
+    bool requested() const { return requested_mask != 0; }
+
+    /* Whether an interrupt should be serviced before the next instruction */
+    bool dispatch_pending() const { return dispatch_mask != 0; }
+
+    /* Takes the highest priority pending interrupt, clearing its bit in IF and
+     * disabling interrupts, and returns the address of its handler */
+    u16 acknowledge();
+
+private:
+    void update();
+
+    u8 interrupt_flag = 0;
+    u8 interrupt_enabled = 0;
+    Registers& registers;
+
+    /* IF & IE, and the same again if IME is set */
+    u8 requested_mask = 0;
+    u8 dispatch_mask = 0;
+};
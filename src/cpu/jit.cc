@@ -0,0 +1,837 @@
+#include "jit.h"
+
+#include "block_cache.h"
+#include "cpu.h"
+#include "../mmu.h"
+#include "../util/log.h"
+
+#include <cstddef>
+
+#ifdef GBEMU_JIT
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/* Executable memory reserved for compiled blocks. The code for blocks in RAM
+ * which are thrown away isn't reclaimed; once it's full, blocks which haven't
+ * been compiled yet keep being interpreted. */
+const std::size_t JIT_CODE_SIZE = 16 * 1024 * 1024;
+
+/* Upper bounds on the code emitted for an instruction, for the exit taken
+ * when an instruction stops a block short, and for a whole block (every
+ * instruction takes at least a cycle) */
+const std::size_t JIT_MAX_INSTRUCTION_SIZE = 192;
+const std::size_t JIT_EXIT_SIZE = 16;
+const std::size_t JIT_MAX_BLOCK_SIZE = 64 + JIT_MAX_BLOCK_CYCLES * (JIT_MAX_INSTRUCTION_SIZE + JIT_EXIT_SIZE);
+
+static bool touches_io(const DecodedInstruction& instruction, Operand operand) {
+    switch (operand) {
+        case Operand::HighImm8:
+            return !is_high_ram(static_cast<u16>(0xFF00 + instruction.operand));
+        case Operand::HighC:
+            return true;
+        case Operand::AddrImm16:
+            return instruction.operand >= 0xFE00 && !is_high_ram(instruction.operand);
+        default:
+            return false;
+    }
+}
+
+/* Whether an instruction can run inside a compiled block: it mustn't depend on
+ * interrupt state, or be certain to reach IO or the MBC registers (which would
+ * always stop the block short). Anything else which turns out not to access
+ * plain memory is caught as the block runs. */
+static bool can_compile(const DecodedInstruction& instruction) {
+    if (instruction.cb) { return true; }
+
+    const OpcodeSpec& spec = opcode_specs[instruction.opcode];
+
+    switch (spec.operation) {
+        case Operation::HALT:
+        case Operation::STOP:
+        case Operation::DI:
+        case Operation::EI:
+        case Operation::RETI:
+        case Operation::PREFIX_CB:
+        case Operation::UNDEFINED:
+            return false;
+        default:
+            break;
+    }
+
+    if (touches_io(instruction, spec.dst) || touches_io(instruction, spec.src)) {
+        return false;
+    }
+
+    /* Writes to the MBC registers */
+    if (spec.dst == Operand::AddrImm16 && instruction.operand < 0x8000) {
+        return false;
+    }
+
+    return true;
+}
+
+NativeSpan native_span(const Block& block) {
+    NativeSpan span;
+    uint max_cycles = 0;
+
+    for (const DecodedInstruction& instruction : block.instructions) {
+        uint longest = instruction.cycles > instruction.cycles_branched
+            ? instruction.cycles
+            : instruction.cycles_branched;
+
+        if (!can_compile(instruction) || max_cycles + longest > JIT_MAX_BLOCK_CYCLES) { break; }
+
+        span.cycles += instruction.cycles;
+        max_cycles += longest;
+        span.length++;
+    }
+
+    /* A single instruction gains nothing over the interpreter */
+    if (span.length < 2) { return {}; }
+
+    const DecodedInstruction& last = block.instructions[span.length - 1];
+    span.cycles_branched = span.cycles - last.cycles + last.cycles_branched;
+
+    return span;
+}
+
+#ifdef GBEMU_JIT
+
+/* x86-64 registers, by their encoding. The generated code keeps the guest
+ * registers at rbx, the MMU's page table pointer at r12 and the CPU at r13,
+ * and uses the others as scratch within an instruction. */
+enum Host : u8 {
+    EAX = 0,
+    ECX = 1,
+    EDX = 2,
+};
+
+static_assert(sizeof(MemoryPage) == 16 && offsetof(MemoryPage, write) == 8,
+    "The generated code indexes the page table as 16-byte read/write pairs");
+
+const uint F = offsetof(Registers, f);
+const uint PC = offsetof(Registers, pc);
+const uint SP = offsetof(Registers, sp);
+const uint FLAG_OPERATION = offsetof(Registers, flag_operation);
+
+static_assert(sizeof(Registers) < 0x80, "Registers are addressed with 8-bit displacements");
+
+static uint byte_offset(const Operand operand) {
+    switch (operand) {
+        case Operand::A: return offsetof(Registers, a);
+        case Operand::B: return offsetof(Registers, b);
+        case Operand::C: return offsetof(Registers, c);
+        case Operand::D: return offsetof(Registers, d);
+        case Operand::E: return offsetof(Registers, e);
+        case Operand::H: return offsetof(Registers, h);
+        case Operand::L: return offsetof(Registers, l);
+        default: fatal_error("Not a byte register");
+    }
+}
+
+static uint word_offset(const Operand operand) {
+    switch (operand) {
+        case Operand::AF: return offsetof(Registers, af);
+        case Operand::BC: return offsetof(Registers, bc);
+        case Operand::DE: return offsetof(Registers, de);
+        case Operand::HL: return offsetof(Registers, hl);
+        case Operand::SP: return SP;
+        default: fatal_error("Not a word register");
+    }
+}
+
+/* Memory addressed by a register pair or an immediate, which a load can go
+ * through */
+static bool addressed(const Operand operand) {
+    return is_memory_operand(operand) && operand != Operand::HighC;
+}
+
+static bool native_load(const OpcodeSpec& spec) {
+    if (is_byte_register(spec.dst)) {
+        return is_byte_register(spec.src) || spec.src == Operand::Imm8 || addressed(spec.src);
+    }
+
+    if (addressed(spec.dst)) {
+        return is_byte_register(spec.src) || (spec.dst == Operand::AddrHL && spec.src == Operand::Imm8);
+    }
+
+    return (spec.src == Operand::Imm16 && spec.dst != Operand::AF && spec.dst != Operand::AddrImm16)
+        || (spec.dst == Operand::SP && spec.src == Operand::HL);
+}
+
+/* Brings 'f' up to date, for code which reads or writes it directly */
+static void evaluate_lazy_flags(Registers& registers) {
+    registers.f = registers.flags();
+    registers.flag_operation = FlagOperation::None;
+}
+
+Jit::Jit(CPU& cpu, MMU& mmu) :
+    block_cache(cpu.block_cache),
+    registers_offset(static_cast<std::size_t>(reinterpret_cast<const u8*>(&cpu.registers) - reinterpret_cast<const u8*>(&cpu))),
+    branch_taken_offset(static_cast<std::size_t>(reinterpret_cast<const u8*>(&cpu.branch_taken) - reinterpret_cast<const u8*>(&cpu))),
+    page_table(&mmu.page_table),
+    high_ram(&mmu.high_ram)
+{
+    void* memory = mmap(nullptr, JIT_CODE_SIZE,
+        PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (memory == MAP_FAILED) {
+        log_warn("Unable to allocate memory for compiled code, the JIT is disabled");
+        return;
+    }
+
+    code = static_cast<u8*>(memory);
+}
+
+Jit::~Jit() {
+    if (code != nullptr) {
+        munmap(code, JIT_CODE_SIZE);
+    }
+}
+
+bool Jit::compile(Block& block) {
+    if (code == nullptr) { return false; }
+
+    NativeSpan span = native_span(block);
+    if (span.length == 0) { return false; }
+
+    if (code_used + JIT_MAX_BLOCK_SIZE > JIT_CODE_SIZE) {
+        flush();
+    }
+
+    std::size_t start = code_used;
+    protect(start, start + JIT_MAX_BLOCK_SIZE, false);
+
+    auto native = reinterpret_cast<NativeBlock>(code + start);
+
+    /* push rbx; push r12; push r13, which also aligns the stack for calls */
+    emit({0x53, 0x41, 0x54, 0x41, 0x55});
+
+    /* mov r13, rdi; lea rbx, [rdi + registers]; mov r12, &page_table */
+    emit({0x49, 0x89, 0xFD});
+    emit({0x48, 0x8D, 0x9F});
+    emit_u32(static_cast<uint>(registers_offset));
+    emit({0x49, 0xBC});
+    emit_u64(reinterpret_cast<unsigned long long>(page_table));
+
+    /* The flags may have been left to be evaluated lazily */
+    flags_eager = false;
+    exits.clear();
+
+    for (uint i = 0; i < span.length; i++) {
+        const DecodedInstruction& instruction = block.instructions[i];
+        bool last = i == span.length - 1;
+
+        /* Only the final instruction can read pc (jumps, calls and RST always
+         * end a block), so it's set once, before that instruction runs */
+        if (last) {
+            emit_register({0x66, 0xC7}, 0, PC);
+            emit_u16(static_cast<u16>(instruction.address + instruction.length));
+        }
+
+        const OpcodeSpec& spec = instruction.cb
+            ? cb_opcode_specs[instruction.opcode]
+            : opcode_specs[instruction.opcode];
+
+        if (instruction.cb || !emit_native(instruction, spec, i, last)) {
+            emit_handler(instruction, i);
+        }
+    }
+
+    /* mov eax, length */
+    emit_byte(0xB8);
+    emit_u32(span.length);
+
+    /* pop r13; pop r12; pop rbx; ret */
+    std::size_t epilogue = code_used;
+    emit({0x41, 0x5D, 0x41, 0x5C, 0x5B, 0xC3});
+
+    /* Stopping short of an instruction leaves pc at it, and returns how many
+     * instructions were completed before it */
+    std::vector<std::size_t> exit_code(span.length, 0);
+
+    for (const Exit& exit : exits) {
+        if (exit_code[exit.index] == 0) {
+            exit_code[exit.index] = code_used;
+
+            emit_register({0x66, 0xC7}, 0, PC);
+            emit_u16(block.instructions[exit.index].address);
+            emit_byte(0xB8);
+            emit_u32(exit.index);
+            patch_jump(emit_jump({0xE9}), epilogue);
+        }
+
+        patch_jump(exit.jump, exit_code[exit.index]);
+    }
+
+    if (code_used - start > JIT_MAX_BLOCK_SIZE) {
+        fatal_error("Compiled block at 0x%04X overran its buffer", block.start);
+    }
+
+    protect(start, code_used, true);
+
+    block.native = native;
+    block.native_length = span.length;
+    block.native_cycles = span.cycles;
+    block.native_cycles_branched = span.cycles_branched;
+
+    return true;
+}
+
+bool Jit::emit_native(const DecodedInstruction& instruction, const OpcodeSpec& spec, const uint index, const bool last) {
+    u16 next = static_cast<u16>(instruction.address + instruction.length);
+
+    switch (spec.operation) {
+        case Operation::NOP:
+            return true;
+
+        case Operation::LD:
+            if (!native_load(spec)) { return false; }
+            emit_load(spec, instruction.operand, index);
+            return true;
+
+        case Operation::INC:
+        case Operation::DEC:
+            if (is_word_operand(spec.dst)) {
+                /* inc/dec word [rbx + rr] */
+                emit_register({0x66, 0xFF}, spec.operation == Operation::INC ? 0 : 1, word_offset(spec.dst));
+                return true;
+            }
+
+            emit_inc_dec(spec, index);
+            return true;
+
+        case Operation::ADD:
+            if (spec.dst != Operand::A) { return false; }
+            emit_alu(spec, instruction.operand, index);
+            return true;
+
+        case Operation::ADC:
+        case Operation::SUB:
+        case Operation::SBC:
+        case Operation::AND:
+        case Operation::XOR:
+        case Operation::OR:
+        case Operation::CP:
+            emit_alu(spec, instruction.operand, index);
+            return true;
+
+        case Operation::CPL:
+            /* not byte [rbx + a]; or byte [rbx + f], N | H */
+            emit_eager_flags();
+            emit_register({0xF6}, 2, byte_offset(Operand::A));
+            emit_register({0x80}, 1, F);
+            emit_byte(0x60);
+            return true;
+
+        case Operation::SCF:
+            /* and byte [rbx + f], Z; or byte [rbx + f], C */
+            emit_eager_flags();
+            emit_register({0x80}, 4, F);
+            emit_byte(0x80);
+            emit_register({0x80}, 1, F);
+            emit_byte(0x10);
+            return true;
+
+        case Operation::CCF:
+            /* and byte [rbx + f], Z | C; xor byte [rbx + f], C */
+            emit_eager_flags();
+            emit_register({0x80}, 4, F);
+            emit_byte(0x90);
+            emit_register({0x80}, 6, F);
+            emit_byte(0x10);
+            return true;
+
+        case Operation::PUSH:
+            if (spec.src == Operand::AF) { emit_eager_flags(); }
+            emit_push(false, word_offset(spec.src), index);
+            return true;
+
+        case Operation::POP:
+            emit_pop(word_offset(spec.dst), spec.dst == Operand::AF, index);
+            return true;
+
+        default:
+            break;
+    }
+
+    /* Everything else changes the flow of control, so ends the block */
+    if (!last) { return false; }
+
+    switch (spec.operation) {
+        case Operation::JP: {
+            if (spec.src == Operand::HL) {
+                emit_register({0x0F, 0xB7}, EAX, word_offset(Operand::HL));
+                emit_register({0x66, 0x89}, EAX, PC);
+                return true;
+            }
+
+            std::size_t not_taken = emit_condition(spec);
+            emit_register({0x66, 0xC7}, 0, PC);
+            emit_u16(instruction.operand);
+            if (not_taken != 0) { patch_jump(not_taken, code_used); }
+            return true;
+        }
+
+        case Operation::JR: {
+            /* Left to the handler, which can exit on an infinite loop */
+            s8 offset = static_cast<s8>(instruction.operand);
+            if (offset == -2) { return false; }
+
+            std::size_t not_taken = emit_condition(spec);
+            emit_register({0x66, 0xC7}, 0, PC);
+            emit_u16(static_cast<u16>(next + offset));
+            if (not_taken != 0) { patch_jump(not_taken, code_used); }
+            return true;
+        }
+
+        case Operation::CALL: {
+            std::size_t not_taken = emit_condition(spec);
+            emit_push(true, next, index);
+            emit_register({0x66, 0xC7}, 0, PC);
+            emit_u16(instruction.operand);
+            if (not_taken != 0) { patch_jump(not_taken, code_used); }
+            return true;
+        }
+
+        case Operation::RET: {
+            std::size_t not_taken = emit_condition(spec);
+            emit_pop(PC, false, index);
+            if (not_taken != 0) { patch_jump(not_taken, code_used); }
+            return true;
+        }
+
+        case Operation::RST:
+            emit_push(true, next, index);
+            emit_register({0x66, 0xC7}, 0, PC);
+            emit_u16(spec.param);
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+void Jit::emit_handler(const DecodedInstruction& instruction, const uint index) {
+    const Opcode& op = instruction.cb
+        ? CPU::cb_opcodes[instruction.opcode]
+        : CPU::opcodes[instruction.opcode];
+
+    if (op.plain_memory != nullptr) {
+        /* mov rdi, r13; mov esi, operand; call guard; test al, al; jz exit */
+        emit({0x4C, 0x89, 0xEF});
+        emit_byte(0xBE);
+        emit_u32(instruction.operand);
+        emit_call_address(reinterpret_cast<const void*>(op.plain_memory));
+        emit({0x84, 0xC0});
+        exits.push_back({emit_jump({0x0F, 0x84}), index});
+    }
+
+    /* mov rdi, r13; mov esi, operand; call handler */
+    emit({0x4C, 0x89, 0xEF});
+    emit_byte(0xBE);
+    emit_u32(instruction.operand);
+    emit_call_address(reinterpret_cast<const void*>(instruction.execute));
+
+    /* The handler may have left the flags to be evaluated lazily */
+    flags_eager = false;
+}
+
+void Jit::emit_eager_flags() {
+    if (flags_eager) { return; }
+
+    /* cmp byte [rbx + flag_operation], None; je done; mov rdi, rbx; call */
+    emit_register({0x80}, 7, FLAG_OPERATION);
+    emit_byte(static_cast<u8>(FlagOperation::None));
+    std::size_t done = emit_jump({0x0F, 0x84});
+    emit({0x48, 0x89, 0xDF});
+    emit_call_address(reinterpret_cast<const void*>(&evaluate_lazy_flags));
+    patch_jump(done, code_used);
+
+    flags_eager = true;
+}
+
+void Jit::emit_alu(const OpcodeSpec& spec, const u16 operand, const uint index) {
+    /* Before anything is loaded, as it may call out */
+    emit_eager_flags();
+
+    /* The operand goes in ecx */
+    if (is_byte_register(spec.src)) {
+        emit_register({0x0F, 0xB6}, ECX, byte_offset(spec.src));
+    } else if (spec.src == Operand::Imm8) {
+        emit_byte(0xB9);
+        emit_u32(operand & 0xFF);
+    } else {
+        /* (HL): movzx ecx, byte [rdx] */
+        emit_memory_pointer(spec.src, operand, false, index);
+        emit({0x0F, 0xB6, 0x0A});
+    }
+
+    emit_register({0x0F, 0xB6}, EAX, byte_offset(Operand::A));
+
+    /* The carry flag goes into CF: movzx edx, byte [rbx + f]; bt edx, 4 */
+    if (spec.operation == Operation::ADC || spec.operation == Operation::SBC) {
+        emit_register({0x0F, 0xB6}, EDX, F);
+        emit({0x0F, 0xBA, 0xE2, 0x04});
+    }
+
+    /* <op> al, cl */
+    u8 opcode;
+    switch (spec.operation) {
+        case Operation::ADD: opcode = 0x00; break;
+        case Operation::ADC: opcode = 0x10; break;
+        case Operation::SUB: opcode = 0x28; break;
+        case Operation::SBC: opcode = 0x18; break;
+        case Operation::AND: opcode = 0x20; break;
+        case Operation::XOR: opcode = 0x30; break;
+        case Operation::OR: opcode = 0x08; break;
+        default: opcode = 0x38; break;
+    }
+    emit({opcode, 0xC8});
+
+    bool logical = spec.operation == Operation::AND || spec.operation == Operation::XOR || spec.operation == Operation::OR;
+
+    if (logical) {
+        /* setz cl; movzx ecx, cl; shl ecx, 7, leaving Z in bit 7 */
+        emit({0x0F, 0x94, 0xC1, 0x0F, 0xB6, 0xC9, 0xC1, 0xE1, 0x07});
+
+        /* or ecx, H */
+        if (spec.operation == Operation::AND) { emit({0x83, 0xC9, 0x20}); }
+    } else {
+        /* x86's ZF, AF and CF match Z, H and C for additions and
+         * subtractions. lahf; movzx edx, ah; mov ecx, edx; and ecx, ZF | AF;
+         * add ecx, ecx; and edx, CF; shl edx, 4; or ecx, edx */
+        emit({0x9F, 0x0F, 0xB6, 0xD4, 0x89, 0xD1, 0x83, 0xE1, 0x50, 0x01, 0xC9});
+        emit({0x83, 0xE2, 0x01, 0xC1, 0xE2, 0x04, 0x09, 0xD1});
+
+        /* or ecx, N */
+        if (spec.operation != Operation::ADD && spec.operation != Operation::ADC) {
+            emit({0x83, 0xC9, 0x40});
+        }
+    }
+
+    emit_register({0x88}, ECX, F);
+
+    if (spec.operation != Operation::CP) {
+        emit_register({0x88}, EAX, byte_offset(Operand::A));
+    }
+}
+
+void Jit::emit_inc_dec(const OpcodeSpec& spec, const uint index) {
+    bool increment = spec.operation == Operation::INC;
+
+    emit_eager_flags();
+
+    /* (HL): mov rdi, rdx */
+    if (spec.dst == Operand::AddrHL) {
+        emit_memory_pointer(spec.dst, 0, true, index);
+        emit({0x48, 0x89, 0xD7});
+    }
+
+    /* The carry flag is kept: movzx ecx, byte [rbx + f]; and ecx, C */
+    emit_register({0x0F, 0xB6}, ECX, F);
+    emit({0x83, 0xE1, 0x10});
+
+    if (spec.dst == Operand::AddrHL) {
+        /* inc/dec byte [rdi] */
+        emit({0xFE, static_cast<u8>(increment ? 0x07 : 0x0F)});
+    } else {
+        emit_register({0xFE}, increment ? 0 : 1, byte_offset(spec.dst));
+    }
+
+    /* lahf; movzx edx, ah; and edx, ZF | AF; add edx, edx; or ecx, edx */
+    emit({0x9F, 0x0F, 0xB6, 0xD4, 0x83, 0xE2, 0x50, 0x01, 0xD2, 0x09, 0xD1});
+
+    if (!increment) { emit({0x83, 0xC9, 0x40}); }
+
+    emit_register({0x88}, ECX, F);
+}
+
+void Jit::emit_load(const OpcodeSpec& spec, const u16 operand, const uint index) {
+    /* (HL+) and (HL-) adjust HL once the access has been made */
+    auto adjust_hl = [this](Operand memory) {
+        if (memory == Operand::AddrHLI || memory == Operand::AddrHLD) {
+            emit_register({0x66, 0xFF}, memory == Operand::AddrHLI ? 0 : 1, word_offset(Operand::HL));
+        }
+    };
+
+    if (is_byte_register(spec.dst) && is_byte_register(spec.src)) {
+        emit_register({0x0F, 0xB6}, EAX, byte_offset(spec.src));
+        emit_register({0x88}, EAX, byte_offset(spec.dst));
+    } else if (is_byte_register(spec.dst) && spec.src == Operand::Imm8) {
+        emit_register({0xC6}, 0, byte_offset(spec.dst));
+        emit_byte(static_cast<u8>(operand));
+    } else if (is_byte_register(spec.dst)) {
+        /* movzx ecx, byte [rdx] */
+        emit_memory_pointer(spec.src, operand, false, index);
+        emit({0x0F, 0xB6, 0x0A});
+        emit_register({0x88}, ECX, byte_offset(spec.dst));
+        adjust_hl(spec.src);
+    } else if (addressed(spec.dst)) {
+        emit_memory_pointer(spec.dst, operand, true, index);
+
+        if (spec.src == Operand::Imm8) {
+            /* mov byte [rdx], imm */
+            emit({0xC6, 0x02, static_cast<u8>(operand)});
+        } else {
+            /* mov [rdx], cl */
+            emit_register({0x0F, 0xB6}, ECX, byte_offset(spec.src));
+            emit({0x88, 0x0A});
+        }
+
+        adjust_hl(spec.dst);
+    } else if (spec.src == Operand::Imm16) {
+        emit_register({0x66, 0xC7}, 0, word_offset(spec.dst));
+        emit_u16(operand);
+    } else {
+        /* LD SP,HL */
+        emit_register({0x0F, 0xB7}, EAX, word_offset(Operand::HL));
+        emit_register({0x66, 0x89}, EAX, SP);
+    }
+}
+
+void Jit::emit_push(const bool immediate, const uint value, const uint index) {
+    /* Both bytes are checked before either is written. movzx eax, word [rbx +
+     * sp]; sub eax, 1; movzx eax, ax; <pointer>; mov rdi, rdx */
+    emit_register({0x0F, 0xB7}, EAX, SP);
+    emit({0x83, 0xE8, 0x01, 0x0F, 0xB7, 0xC0});
+    emit_host_pointer(true, index);
+    emit({0x48, 0x89, 0xD7});
+
+    /* movzx eax, word [rbx + sp]; sub eax, 2; movzx eax, ax; <pointer> */
+    emit_register({0x0F, 0xB7}, EAX, SP);
+    emit({0x83, 0xE8, 0x02, 0x0F, 0xB7, 0xC0});
+    emit_host_pointer(true, index);
+
+    /* The value goes in ecx: mov ecx, imm or movzx ecx, word [rbx + rr] */
+    if (immediate) {
+        emit_byte(0xB9);
+        emit_u32(value);
+    } else {
+        emit_register({0x0F, 0xB7}, ECX, value);
+    }
+
+    /* mov [rdx], cl; shr ecx, 8; mov [rdi], cl; sub word [rbx + sp], 2 */
+    emit({0x88, 0x0A, 0xC1, 0xE9, 0x08, 0x88, 0x0F});
+    emit_register({0x66, 0x83}, 5, SP);
+    emit_byte(0x02);
+}
+
+void Jit::emit_pop(const uint offset, const bool af, const uint index) {
+    /* movzx eax, word [rbx + sp]; <pointer>; mov rdi, rdx */
+    emit_register({0x0F, 0xB7}, EAX, SP);
+    emit_host_pointer(false, index);
+    emit({0x48, 0x89, 0xD7});
+
+    /* movzx eax, word [rbx + sp]; add eax, 1; movzx eax, ax; <pointer> */
+    emit_register({0x0F, 0xB7}, EAX, SP);
+    emit({0x83, 0xC0, 0x01, 0x0F, 0xB7, 0xC0});
+    emit_host_pointer(false, index);
+
+    /* movzx ecx, byte [rdi]; movzx eax, byte [rdx]; shl eax, 8; or eax, ecx */
+    emit({0x0F, 0xB6, 0x0F, 0x0F, 0xB6, 0x02, 0xC1, 0xE0, 0x08, 0x09, 0xC8});
+
+    if (af) {
+        /* and eax, 0xFFF0, as the lower nibble of f is always 0s */
+        emit_byte(0x25);
+        emit_u32(0xFFF0);
+        emit_register({0xC6}, 0, FLAG_OPERATION);
+        emit_byte(static_cast<u8>(FlagOperation::None));
+        flags_eager = true;
+    }
+
+    /* add word [rbx + sp], 2; mov [rbx + rr], ax */
+    emit_register({0x66, 0x83}, 0, SP);
+    emit_byte(0x02);
+    emit_register({0x66, 0x89}, EAX, offset);
+}
+
+std::size_t Jit::emit_condition(const OpcodeSpec& spec) {
+    if (spec.condition == Condition::Always) { return 0; }
+
+    emit_eager_flags();
+
+    /* test byte [rbx + f], flag */
+    bool zero = spec.condition == Condition::Z || spec.condition == Condition::NZ;
+    emit_register({0xF6}, 0, F);
+    emit_byte(zero ? 0x80 : 0x10);
+
+    /* Skip the branch with jz (Z, C) or jnz (NZ, NC) */
+    bool flag_set = spec.condition == Condition::Z || spec.condition == Condition::C;
+    std::size_t not_taken = emit_jump({0x0F, static_cast<u8>(flag_set ? 0x84 : 0x85)});
+
+    emit_branch_taken();
+    return not_taken;
+}
+
+void Jit::emit_branch_taken() {
+    /* mov byte [r13 + branch_taken], 1 */
+    emit({0x41, 0xC6, 0x85});
+    emit_u32(static_cast<uint>(branch_taken_offset));
+    emit_byte(0x01);
+}
+
+void Jit::emit_memory_pointer(const Operand memory, const u16 operand, const bool write, const uint index) {
+    u16 address = memory == Operand::HighImm8
+        ? static_cast<u16>(0xFF00 + operand)
+        : operand;
+
+    /* HRAM isn't in the page table. mov rdx, &high_ram; mov rdx, [rdx] or
+     * [rdx + 8] */
+    if (memory == Operand::HighImm8 || (memory == Operand::AddrImm16 && is_high_ram(address))) {
+        emit({0x48, 0xBA});
+        emit_u64(reinterpret_cast<unsigned long long>(high_ram));
+
+        if (write) {
+            /* mov rdx, [rdx + 8]; test rdx, rdx; jz exit */
+            emit({0x48, 0x8B, 0x52, 0x08, 0x48, 0x85, 0xD2});
+            exits.push_back({emit_jump({0x0F, 0x84}), index});
+        } else {
+            emit({0x48, 0x8B, 0x12});
+        }
+
+        /* add rdx, offset */
+        emit({0x48, 0x81, 0xC2});
+        emit_u32(address % PAGE_SIZE);
+        return;
+    }
+
+    /* The address goes in eax: mov eax, imm or movzx eax, word [rbx + rr] */
+    if (memory == Operand::AddrImm16) {
+        emit_byte(0xB8);
+        emit_u32(address);
+    } else {
+        Operand pair = memory == Operand::AddrBC ? Operand::BC
+            : memory == Operand::AddrDE ? Operand::DE
+            : Operand::HL;
+
+        emit_register({0x0F, 0xB7}, EAX, word_offset(pair));
+    }
+
+    emit_host_pointer(write, index);
+}
+
+void Jit::emit_host_pointer(const bool write, const uint index) {
+    /* Looks up the page of the guest address in eax, leaving a pointer to
+     * the byte in rdx, or stopping the block short if the page isn't plain
+     * memory. Memory which is writable can also be read through the same
+     * pointer. mov rdx, [r12]; mov esi, eax; shr esi, 8; shl esi, 4 */
+    emit({0x49, 0x8B, 0x14, 0x24, 0x89, 0xC6, 0xC1, 0xEE, 0x08, 0xC1, 0xE6, 0x04});
+
+    if (write) {
+        /* mov rdx, [rdx + rsi + 8] */
+        emit({0x48, 0x8B, 0x54, 0x32, 0x08});
+    } else {
+        /* mov rdx, [rdx + rsi] */
+        emit({0x48, 0x8B, 0x14, 0x32});
+    }
+
+    /* test rdx, rdx; jz exit */
+    emit({0x48, 0x85, 0xD2});
+    exits.push_back({emit_jump({0x0F, 0x84}), index});
+
+    /* movzx esi, al; add rdx, rsi */
+    emit({0x0F, 0xB6, 0xF0, 0x48, 0x01, 0xF2});
+}
+
+void Jit::emit_register(std::initializer_list<u8> opcode, const u8 host, const uint offset) {
+    /* <opcode> with a ModRM addressing [rbx + disp8] */
+    emit(opcode);
+    emit_byte(static_cast<u8>(0x43 | (host << 3)));
+    emit_byte(static_cast<u8>(offset));
+}
+
+std::size_t Jit::emit_jump(std::initializer_list<u8> opcode) {
+    emit(opcode);
+
+    std::size_t jump = code_used;
+    emit_u32(0);
+    return jump;
+}
+
+void Jit::patch_jump(const std::size_t jump, const std::size_t target) {
+    uint offset = static_cast<uint>(target - (jump + 4));
+
+    for (uint i = 0; i < 4; i++) {
+        code[jump + i] = static_cast<u8>(offset >> (8 * i));
+    }
+}
+
+void Jit::emit_call_address(const void* function) {
+    /* mov rax, function; call rax */
+    emit({0x48, 0xB8});
+    emit_u64(reinterpret_cast<unsigned long long>(function));
+    emit({0xFF, 0xD0});
+}
+
+void Jit::emit(std::initializer_list<u8> bytes) {
+    for (u8 byte : bytes) { emit_byte(byte); }
+}
+
+void Jit::emit_byte(const u8 byte) {
+    code[code_used++] = byte;
+}
+
+void Jit::emit_u16(const u16 value) {
+    emit_byte(static_cast<u8>(value));
+    emit_byte(static_cast<u8>(value >> 8));
+}
+
+void Jit::emit_u32(const uint value) {
+    emit_u16(static_cast<u16>(value));
+    emit_u16(static_cast<u16>(value >> 16));
+}
+
+void Jit::emit_u64(const unsigned long long value) {
+    emit_u32(static_cast<uint>(value));
+    emit_u32(static_cast<uint>(value >> 32));
+}
+
+void Jit::protect(const std::size_t start, const std::size_t end, const bool executable) {
+    /* Blocks share pages, so one which was finished may have to be made
+     * writable again while the next is written after it. Nothing runs
+     * natively while a block is compiled. */
+    std::size_t page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    std::size_t first = start / page_size * page_size;
+    std::size_t last = std::min((end + page_size - 1) / page_size * page_size, JIT_CODE_SIZE);
+
+    int protection = executable
+        ? PROT_READ | PROT_EXEC
+        : PROT_READ | PROT_WRITE;
+
+    if (mprotect(code + first, last - first, protection) != 0) {
+        fatal_error("Unable to change the protection of compiled code");
+    }
+}
+
+void Jit::flush() {
+    /* Nothing runs natively while a block is compiled, so no compiled code
+     * can be in use */
+    log_debug("JIT code buffer is full, discarding all compiled code");
+
+    block_cache.discard_compiled_code();
+    code_used = 0;
+}
+
+#else
+
+Jit::Jit(CPU& cpu, MMU& mmu) :
+    block_cache(cpu.block_cache),
+    registers_offset(0),
+    branch_taken_offset(0),
+    page_table(nullptr),
+    high_ram(nullptr)
+{
+    unused(mmu, code, code_used, flags_eager);
+}
+
+Jit::~Jit() = default;
+
+bool Jit::compile(Block& block) {
+    unused(block);
+    return false;
+}
+
+#endif
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "../definitions.h"
+
+#include <cstddef>
+#include <initializer_list>
+#include <vector>
+
+class BlockCache;
+class CPU;
+class MMU;
+struct Block;
+struct DecodedInstruction;
+struct OpcodeSpec;
+enum class Operand;
+struct Registers;
+
+/* Native code compiled for the start of a block. It executes the compiled
+ * instructions back to back and returns how many of them it completed. It
+ * stops short, with pc left at the instruction, when an instruction would
+ * access memory which isn't plain RAM or ROM (IO registers, MBC registers,
+ * memory holding cached code, anything while OAM DMA blocks the bus), so
+ * that the interpreter can run it at the right time. */
+using NativeBlock = uint (*)(CPU& cpu);
+
+/* Blocks are compiled once they've been entered this many times */
+const uint JIT_THRESHOLD = 32;
+
+/* The cycles a compiled block may take. A block only runs natively when no
+ * event falls due part way through it, so longer blocks would rarely run. */
+const uint JIT_MAX_BLOCK_CYCLES = 64;
+
+/* The instructions at the start of a block which can run as native code, and
+ * the cycles they take with and without the final branch. Both the JIT and
+ * gbemu-aot compile exactly this much of a block. */
+struct NativeSpan {
+    uint length = 0;
+    uint cycles = 0;
+    uint cycles_branched = 0;
+};
+
+NativeSpan native_span(const Block& block);
+
+/**
+ * Translates hot blocks of code into x86-64. Loads, register and ALU
+ * operations, the stack and branches are generated inline, working on the
+ * guest registers through rbx; anything else calls the instruction's
+ * handler. Only built when GBEMU_JIT is defined; otherwise nothing is ever
+ * compiled and blocks are always interpreted.
+ *
+ * Instructions which touch interrupt state or always reach IO are left to the
+ * interpreter. Other accesses are checked against the MMU's page table as
+ * they're made, and the block stops short at any which isn't to plain memory,
+ * so a compiled block can only observe the rest of the system through
+ * ordinary memory and never needs to know the time. Pages of RAM holding
+ * cached code aren't writable through the page table, so a block which would
+ * modify code also stops short, and the interpreter throws the old code away.
+ *
+ * The code buffer is never writable and executable at once: the pages a
+ * block is written to are made executable once it's finished. When it fills
+ * up, everything compiled so far is thrown away and blocks are compiled
+ * again as they become hot.
+ */
+class Jit {
+public:
+    Jit(CPU& cpu, MMU& mmu);
+    ~Jit();
+
+    Jit(const Jit&) = delete;
+    Jit& operator=(const Jit&) = delete;
+
+    /* Compiles as much of the start of the block as can be, returning false
+     * if nothing worth running natively could be compiled */
+    bool compile(Block& block);
+
+private:
+    /* A jump to be pointed at the exit for an instruction, or at the end of
+     * the block */
+    struct Exit {
+        std::size_t jump;
+        uint index;
+    };
+
+    bool emit_native(const DecodedInstruction& instruction, const OpcodeSpec& spec, uint index, bool last);
+    void emit_handler(const DecodedInstruction& instruction, uint index);
+
+    void emit_eager_flags();
+    void emit_alu(const OpcodeSpec& spec, u16 operand, uint index);
+    void emit_inc_dec(const OpcodeSpec& spec, uint index);
+    void emit_load(const OpcodeSpec& spec, u16 operand, uint index);
+    void emit_push(bool immediate, uint value, uint index);
+    void emit_pop(uint offset, bool af, uint index);
+    std::size_t emit_condition(const OpcodeSpec& spec);
+    void emit_branch_taken();
+
+    void emit_memory_pointer(Operand memory, u16 operand, bool write, uint index);
+    void emit_host_pointer(bool write, uint index);
+    void emit_register(std::initializer_list<u8> opcode, u8 host, uint offset);
+    std::size_t emit_jump(std::initializer_list<u8> opcode);
+    void patch_jump(std::size_t jump, std::size_t target);
+    void emit_call_address(const void* function);
+
+    void emit(std::initializer_list<u8> bytes);
+    void emit_byte(u8 byte);
+    void emit_u16(u16 value);
+    void emit_u32(uint value);
+    void emit_u64(unsigned long long value);
+
+    void protect(std::size_t start, std::size_t end, bool executable);
+    void flush();
+
+    BlockCache& block_cache;
+
+    u8* code = nullptr;
+    std::size_t code_used = 0;
+
+    /* Where the CPU's state lives, relative to the CPU */
+    std::size_t registers_offset;
+    std::size_t branch_taken_offset;
+    const void* page_table;
+    const void* high_ram;
+
+    /* While compiling: whether the flags are known to be held in 'f' rather
+     * than lazily, and the jumps to each instruction's exit */
+    bool flags_eager = false;
+    std::vector<Exit> exits;
+};
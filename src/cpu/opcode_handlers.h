@@ -0,0 +1,328 @@
+#pragma once
+
+#include "cpu.h"
+#include "../util/bitwise.h"
+
+/**
+ * The functions which map to actual opcodes executed by the Gameboy's
+ * processor. Rather than writing one function per opcode, each
+ * handler is instantiated from its entry in opcode_specs/cb_opcode_specs, so
+ * the operand accesses are resolved at compile time.
+ *
+ * They're kept in a header, apart from the dispatch tables built from them,
+ * so that code which knows which instruction it will run can call (and
+ * inline) its handler directly.
+ */
+
+namespace handlers {
+template <Operand operand> struct invalid_operand { static const bool value = false; };
+} // namespace handlers
+
+template <Condition condition> bool CPU::is_condition() {
+    bool should_branch;
+
+    if constexpr (condition == Condition::Always) {
+        return true;
+    } else if constexpr (condition == Condition::C) {
+        should_branch = registers.flag_carry();
+    } else if constexpr (condition == Condition::NC) {
+        should_branch = !registers.flag_carry();
+    } else if constexpr (condition == Condition::Z) {
+        should_branch = registers.flag_zero();
+    } else {
+        should_branch = !registers.flag_zero();
+    }
+
+    /* If the branch is taken, remember so that the correct processor cycles
+     * can be used */
+    branch_taken = should_branch;
+    return should_branch;
+}
+
+template <Operand operand> u8& CPU::byte_register() {
+    if constexpr (operand == Operand::A) { return registers.a; }
+    else if constexpr (operand == Operand::B) { return registers.b; }
+    else if constexpr (operand == Operand::C) { return registers.c; }
+    else if constexpr (operand == Operand::D) { return registers.d; }
+    else if constexpr (operand == Operand::E) { return registers.e; }
+    else if constexpr (operand == Operand::H) { return registers.h; }
+    else if constexpr (operand == Operand::L) { return registers.l; }
+    else { static_assert(handlers::invalid_operand<operand>::value, "Not a byte register"); }
+}
+
+template <Operand operand> u8 CPU::read_operand(const u16 immediate) {
+    if constexpr (is_byte_register(operand)) {
+        return byte_register<operand>();
+    } else if constexpr (operand == Operand::AddrBC) {
+        return mmu.read(Address(registers.bc));
+    } else if constexpr (operand == Operand::AddrDE) {
+        return mmu.read(Address(registers.de));
+    } else if constexpr (operand == Operand::AddrHL) {
+        return mmu.read(Address(registers.hl));
+    } else if constexpr (operand == Operand::AddrHLI) {
+        u8 value = mmu.read(Address(registers.hl));
+        registers.hl++;
+        return value;
+    } else if constexpr (operand == Operand::AddrHLD) {
+        u8 value = mmu.read(Address(registers.hl));
+        registers.hl--;
+        return value;
+    } else if constexpr (operand == Operand::Imm8) {
+        return static_cast<u8>(immediate);
+    } else if constexpr (operand == Operand::AddrImm16) {
+        return mmu.read(immediate);
+    } else if constexpr (operand == Operand::HighImm8) {
+        return mmu.read(static_cast<u16>(0xFF00 + immediate));
+    } else if constexpr (operand == Operand::HighC) {
+        return mmu.read(static_cast<u16>(0xFF00 + registers.c));
+    } else {
+        static_assert(handlers::invalid_operand<operand>::value, "Operand can't be read as a byte");
+    }
+}
+
+template <Operand operand> void CPU::write_operand(const u16 immediate, const u8 value) {
+    if constexpr (is_byte_register(operand)) {
+        byte_register<operand>() = value;
+    } else if constexpr (operand == Operand::AddrBC) {
+        mmu.write(Address(registers.bc), value);
+    } else if constexpr (operand == Operand::AddrDE) {
+        mmu.write(Address(registers.de), value);
+    } else if constexpr (operand == Operand::AddrHL) {
+        mmu.write(Address(registers.hl), value);
+    } else if constexpr (operand == Operand::AddrHLI) {
+        mmu.write(Address(registers.hl), value);
+        registers.hl++;
+    } else if constexpr (operand == Operand::AddrHLD) {
+        mmu.write(Address(registers.hl), value);
+        registers.hl--;
+    } else if constexpr (operand == Operand::AddrImm16) {
+        mmu.write(immediate, value);
+    } else if constexpr (operand == Operand::HighImm8) {
+        mmu.write(static_cast<u16>(0xFF00 + immediate), value);
+    } else if constexpr (operand == Operand::HighC) {
+        mmu.write(static_cast<u16>(0xFF00 + registers.c), value);
+    } else {
+        static_assert(handlers::invalid_operand<operand>::value, "Operand can't be written as a byte");
+    }
+}
+
+template <Operand operand> u16 CPU::read_word_operand(const u16 immediate) {
+    if constexpr (operand == Operand::AF) { return registers.af_value(); }
+    else if constexpr (operand == Operand::BC) { return registers.bc; }
+    else if constexpr (operand == Operand::DE) { return registers.de; }
+    else if constexpr (operand == Operand::HL) { return registers.hl; }
+    else if constexpr (operand == Operand::SP) { return registers.sp; }
+    else if constexpr (operand == Operand::Imm16) { return immediate; }
+    else { static_assert(handlers::invalid_operand<operand>::value, "Operand can't be read as a word"); }
+}
+
+template <Operand operand> void CPU::write_word_operand(const u16 immediate, const u16 value) {
+    if constexpr (operand == Operand::AF) {
+        registers.set_af(value);
+    } else if constexpr (operand == Operand::BC) {
+        registers.bc = value;
+    } else if constexpr (operand == Operand::DE) {
+        registers.de = value;
+    } else if constexpr (operand == Operand::HL) {
+        registers.hl = value;
+    } else if constexpr (operand == Operand::SP) {
+        registers.sp = value;
+    } else if constexpr (operand == Operand::AddrImm16) {
+        mmu.write(immediate, static_cast<u8>(value));
+        mmu.write(static_cast<u16>(immediate + 1), static_cast<u8>(value >> 8));
+    } else {
+        static_assert(handlers::invalid_operand<operand>::value, "Operand can't be written as a word");
+    }
+}
+
+template <bool cb, u8 opcode> void CPU::dispatch(CPU& cpu, const u16 operand) {
+    cpu.execute<cb, opcode>(operand);
+}
+
+template <bool cb, u8 opcode> void CPU::execute(const u16 operand) {
+    constexpr OpcodeSpec spec = cb ? cb_opcode_specs[opcode] : opcode_specs[opcode];
+    constexpr Operation operation = spec.operation;
+    constexpr Operand dst = spec.dst;
+    constexpr Operand src = spec.src;
+
+    /* Loads */
+    if constexpr (operation == Operation::LD) {
+        if constexpr (is_word_operand(dst) || is_word_operand(src)) {
+            write_word_operand<dst>(operand, read_word_operand<src>(operand));
+        } else {
+            write_operand<dst>(operand, read_operand<src>(operand));
+        }
+    } else if constexpr (operation == Operation::LDHL) {
+        opcode_ldhl(static_cast<s8>(operand));
+    } else if constexpr (operation == Operation::PUSH) {
+        stack_push(read_word_operand<src>(operand));
+    } else if constexpr (operation == Operation::POP) {
+        write_word_operand<dst>(operand, stack_pop());
+    }
+
+    /* Arithmetic & logic */
+    else if constexpr (operation == Operation::INC) {
+        if constexpr (is_word_operand(dst)) {
+            write_word_operand<dst>(operand, static_cast<u16>(read_word_operand<dst>(operand) + 1));
+        } else {
+            write_operand<dst>(operand, _opcode_inc(read_operand<dst>(operand)));
+        }
+    } else if constexpr (operation == Operation::DEC) {
+        if constexpr (is_word_operand(dst)) {
+            write_word_operand<dst>(operand, static_cast<u16>(read_word_operand<dst>(operand) - 1));
+        } else {
+            write_operand<dst>(operand, _opcode_dec(read_operand<dst>(operand)));
+        }
+    } else if constexpr (operation == Operation::ADD) {
+        if constexpr (dst == Operand::HL) {
+            _opcode_add_hl(read_word_operand<src>(operand));
+        } else if constexpr (dst == Operand::SP) {
+            opcode_add_sp(static_cast<s8>(operand));
+        } else {
+            _opcode_add(registers.a, read_operand<src>(operand));
+        }
+    } else if constexpr (operation == Operation::ADC) {
+        _opcode_adc(read_operand<src>(operand));
+    } else if constexpr (operation == Operation::SUB) {
+        _opcode_sub(read_operand<src>(operand));
+    } else if constexpr (operation == Operation::SBC) {
+        _opcode_sbc(read_operand<src>(operand));
+    } else if constexpr (operation == Operation::AND) {
+        _opcode_and(read_operand<src>(operand));
+    } else if constexpr (operation == Operation::XOR) {
+        _opcode_xor(read_operand<src>(operand));
+    } else if constexpr (operation == Operation::OR) {
+        _opcode_or(read_operand<src>(operand));
+    } else if constexpr (operation == Operation::CP) {
+        _opcode_cp(read_operand<src>(operand));
+    } else if constexpr (operation == Operation::DAA) {
+        opcode_daa();
+    } else if constexpr (operation == Operation::CPL) {
+        opcode_cpl();
+    } else if constexpr (operation == Operation::SCF) {
+        opcode_scf();
+    } else if constexpr (operation == Operation::CCF) {
+        opcode_ccf();
+    }
+
+    /* Rotates & shifts */
+    else if constexpr (operation == Operation::RLCA) {
+        opcode_rlca();
+    } else if constexpr (operation == Operation::RLA) {
+        opcode_rla();
+    } else if constexpr (operation == Operation::RRCA) {
+        opcode_rrca();
+    } else if constexpr (operation == Operation::RRA) {
+        opcode_rra();
+    } else if constexpr (operation == Operation::RLC) {
+        write_operand<dst>(operand, _opcode_rlc(read_operand<dst>(operand)));
+    } else if constexpr (operation == Operation::RRC) {
+        write_operand<dst>(operand, _opcode_rrc(read_operand<dst>(operand)));
+    } else if constexpr (operation == Operation::RL) {
+        write_operand<dst>(operand, _opcode_rl(read_operand<dst>(operand)));
+    } else if constexpr (operation == Operation::RR) {
+        write_operand<dst>(operand, _opcode_rr(read_operand<dst>(operand)));
+    } else if constexpr (operation == Operation::SLA) {
+        write_operand<dst>(operand, _opcode_sla(read_operand<dst>(operand)));
+    } else if constexpr (operation == Operation::SRA) {
+        write_operand<dst>(operand, _opcode_sra(read_operand<dst>(operand)));
+    } else if constexpr (operation == Operation::SWAP) {
+        write_operand<dst>(operand, _opcode_swap(read_operand<dst>(operand)));
+    } else if constexpr (operation == Operation::SRL) {
+        write_operand<dst>(operand, _opcode_srl(read_operand<dst>(operand)));
+    }
+
+    /* Single bit operations */
+    else if constexpr (operation == Operation::BIT) {
+        _opcode_bit(spec.param, read_operand<src>(operand));
+    } else if constexpr (operation == Operation::RES) {
+        write_operand<dst>(operand, bitwise::clear_bit(read_operand<dst>(operand), spec.param));
+    } else if constexpr (operation == Operation::SET) {
+        write_operand<dst>(operand, bitwise::set_bit(read_operand<dst>(operand), spec.param));
+    }
+
+    /* Control flow */
+    else if constexpr (operation == Operation::JP) {
+        if (is_condition<spec.condition>()) { opcode_jp(read_word_operand<src>(operand)); }
+    } else if constexpr (operation == Operation::JR) {
+        if (is_condition<spec.condition>()) { opcode_jr(static_cast<s8>(operand)); }
+    } else if constexpr (operation == Operation::CALL) {
+        if (is_condition<spec.condition>()) { opcode_call(operand); }
+    } else if constexpr (operation == Operation::RET) {
+        if (is_condition<spec.condition>()) { opcode_ret(); }
+    } else if constexpr (operation == Operation::RETI) {
+        opcode_reti();
+    } else if constexpr (operation == Operation::RST) {
+        opcode_rst(spec.param);
+    }
+
+    /* Misc */
+    else if constexpr (operation == Operation::NOP) {
+        opcode_nop();
+    } else if constexpr (operation == Operation::STOP) {
+        opcode_stop();
+    } else if constexpr (operation == Operation::HALT) {
+        opcode_halt();
+    } else if constexpr (operation == Operation::DI) {
+        opcode_di();
+    } else if constexpr (operation == Operation::EI) {
+        opcode_ei();
+    }
+
+    /* PREFIX_CB is handled by execute_opcode, and the undefined opcodes
+     * do nothing */
+}
+
+template <Operand operand> u16 CPU::operand_address(const u16 immediate) const {
+    if constexpr (operand == Operand::AddrBC) { return registers.bc; }
+    else if constexpr (operand == Operand::AddrDE) { return registers.de; }
+    else if constexpr (operand == Operand::AddrHL || operand == Operand::AddrHLI || operand == Operand::AddrHLD) { return registers.hl; }
+    else if constexpr (operand == Operand::AddrImm16) { return immediate; }
+    else if constexpr (operand == Operand::HighImm8) { return static_cast<u16>(0xFF00 + immediate); }
+    else if constexpr (operand == Operand::HighC) { return static_cast<u16>(0xFF00 + registers.c); }
+    else { static_assert(handlers::invalid_operand<operand>::value, "Not a memory operand"); }
+}
+
+template <bool cb, u8 opcode> bool CPU::guard(const CPU& cpu, const u16 operand) {
+    return cpu.plain_memory<cb, opcode>(operand);
+}
+
+template <bool cb, u8 opcode> bool CPU::plain_memory(const u16 operand) const {
+    constexpr OpcodeSpec spec = cb ? cb_opcode_specs[opcode] : opcode_specs[opcode];
+    constexpr Operation operation = spec.operation;
+    constexpr Operand dst = spec.dst;
+    constexpr Operand src = spec.src;
+
+    /* Conditional calls and returns are checked whether or not they'll be
+     * taken */
+    if constexpr (operation == Operation::PUSH || operation == Operation::CALL || operation == Operation::RST) {
+        return mmu.plain_write(static_cast<u16>(registers.sp - 1))
+            && mmu.plain_write(static_cast<u16>(registers.sp - 2));
+    } else if constexpr (operation == Operation::POP || operation == Operation::RET || operation == Operation::RETI) {
+        return mmu.plain_read(registers.sp)
+            && mmu.plain_read(static_cast<u16>(registers.sp + 1));
+    } else if constexpr (is_memory_operand(dst) && is_word_operand(src)) {
+        /* LD (nn),SP */
+        return mmu.plain_write(operand) && mmu.plain_write(static_cast<u16>(operand + 1));
+    } else if constexpr (is_memory_operand(dst)) {
+        /* Everything but a load reads the operand before writing it back */
+        u16 address = operand_address<dst>(operand);
+        return mmu.plain_write(address) && (operation == Operation::LD || mmu.plain_read(address));
+    } else if constexpr (is_memory_operand(src)) {
+        return mmu.plain_read(operand_address<src>(operand));
+    } else {
+        return true;
+    }
+}
+
+namespace aot {
+
+template <bool cb, u8 opcode> void execute(CPU& cpu, const u16 operand) {
+    cpu.execute<cb, opcode>(operand);
+}
+
+template <bool cb, u8 opcode> bool plain_memory(const CPU& cpu, const u16 operand) {
+    return cpu.plain_memory<cb, opcode>(operand);
+}
+
+} // namespace aot
@@ -0,0 +1,58 @@
+#include "opcode_histogram.h"
+
+#include "opcode_names.h"
+
+#include <algorithm>
+#include <vector>
+
+static std::string opcode_name(const uint opcode) {
+    return opcode < 0x100
+        ? opcode_names[opcode]
+        : opcode_cb_names[opcode - 0x100];
+}
+
+void OpcodeHistogram::record(const u16 address, const u8 length, const u8 opcode, const bool cb) {
+    uint current = cb ? 0x100u + opcode : opcode;
+
+    /* Anything other than falling through from the last instruction (a jump,
+     * or an interrupt) starts a new sequence */
+    if (address != next_address) {
+        previous = NO_OPCODE;
+        before_previous = NO_OPCODE;
+    }
+
+    if (previous != NO_OPCODE) {
+        pairs[(previous << 9) | current]++;
+    }
+
+    if (before_previous != NO_OPCODE) {
+        triples[(u64(before_previous) << 18) | (previous << 9) | current]++;
+    }
+
+    before_previous = previous;
+    previous = current;
+    next_address = address + length;
+}
+
+void OpcodeHistogram::write(FILE* file) const {
+    std::vector<std::pair<u64, std::string>> lines;
+
+    for (const auto& pair : pairs) {
+        lines.emplace_back(pair.second, "pair\t"
+            + opcode_name(pair.first >> 9) + " ; "
+            + opcode_name(pair.first & 0x1FF));
+    }
+
+    for (const auto& triple : triples) {
+        lines.emplace_back(triple.second, "triple\t"
+            + opcode_name(static_cast<uint>(triple.first >> 18)) + " ; "
+            + opcode_name((triple.first >> 9) & 0x1FF) + " ; "
+            + opcode_name(triple.first & 0x1FF));
+    }
+
+    std::sort(lines.begin(), lines.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+
+    for (const auto& line : lines) {
+        fprintf(file, "%llu\t%s\n", static_cast<unsigned long long>(line.first), line.second.c_str());
+    }
+}
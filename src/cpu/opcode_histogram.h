@@ -0,0 +1,32 @@
+#pragma once
+
+#include "../definitions.h"
+
+#include <cstdio>
+#include <unordered_map>
+
+/**
+ * Counts how often each sequence of two and three instructions is executed
+ * back to back, for finding idioms which are worth fusing into a single
+ * handler. Only instructions which follow on directly from the previous one
+ * are counted as a sequence, since a fused idiom can't span a jump.
+ */
+class OpcodeHistogram {
+public:
+    void record(u16 address, u8 length, u8 opcode, bool cb);
+
+    /* Writes a line per sequence: its count, "pair" or "triple", and the
+     * instructions' names separated by " ; " */
+    void write(FILE* file) const;
+
+private:
+    /* Opcodes are numbered 0x000-0x1FF, with CB-prefixed opcodes at 0x100 */
+    static const uint NO_OPCODE = 0x200;
+
+    uint previous = NO_OPCODE;
+    uint before_previous = NO_OPCODE;
+    uint next_address = 0x10000;
+
+    std::unordered_map<uint, u64> pairs;
+    std::unordered_map<u64, u64> triples;
+};
@@ -1,4 +1,7 @@
 #pragma once
+
+#include <string>
+
 /* clang-format off */
 
 static const std::string opcode_names[256] = {
@@ -0,0 +1,540 @@
+#pragma once
+
+#include "opcode_cycles.h"
+#include "../definitions.h"
+
+#include <array>
+
+/**
+ * A compile-time description of the instruction set. Each opcode is described
+ * by the operation it performs and the operands it reads from and writes to;
+ * the CPU generates a specialised handler for every entry and builds its
+ * dispatch tables from them (see opcode_mapping.cc).
+ */
+
+enum class Condition {
+    Always,
+    NZ,
+    Z,
+    NC,
+    C,
+};
+
+namespace rst {
+const u16 rst1 = 0x00;
+const u16 rst2 = 0x08;
+const u16 rst3 = 0x10;
+const u16 rst4 = 0x18;
+const u16 rst5 = 0x20;
+const u16 rst6 = 0x28;
+const u16 rst7 = 0x30;
+const u16 rst8 = 0x38;
+} // namespace rst
+
+enum class Operation {
+    NOP,
+    STOP,
+    HALT,
+    DI,
+    EI,
+    PREFIX_CB,
+    UNDEFINED,
+
+    /* Loads */
+    LD,
+    LDHL,
+    PUSH,
+    POP,
+
+    /* Arithmetic & logic */
+    INC,
+    DEC,
+    ADD,
+    ADC,
+    SUB,
+    SBC,
+    AND,
+    XOR,
+    OR,
+    CP,
+    DAA,
+    CPL,
+    SCF,
+    CCF,
+
+    /* Rotates & shifts */
+    RLCA,
+    RLA,
+    RRCA,
+    RRA,
+    RLC,
+    RRC,
+    RL,
+    RR,
+    SLA,
+    SRA,
+    SWAP,
+    SRL,
+
+    /* Single bit operations */
+    BIT,
+    RES,
+    SET,
+
+    /* Control flow */
+    JP,
+    JR,
+    CALL,
+    RET,
+    RETI,
+    RST,
+};
+
+enum class Operand {
+    None,
+
+    /* 8-bit registers */
+    A, B, C, D, E, H, L,
+
+    /* 16-bit registers */
+    AF, BC, DE, HL, SP,
+
+    /* Memory addressed by a register pair. (HL+) and (HL-) adjust HL
+     * after the access. */
+    AddrBC, AddrDE, AddrHL, AddrHLI, AddrHLD,
+
+    /* Immediate data following the opcode */
+    Imm8, SignedImm8, Imm16,
+
+    /* Memory at (nn), (0xFF00+n) and (0xFF00+C) */
+    AddrImm16, HighImm8, HighC,
+};
+
+struct OpcodeSpec {
+    Operation operation = Operation::UNDEFINED;
+    Operand dst = Operand::None;
+    Operand src = Operand::None;
+    Condition condition = Condition::Always;
+
+    /* The bit used by BIT/RES/SET, or the address jumped to by RST */
+    u8 param = 0;
+
+    /* Filled in by make_opcode_specs() and make_cb_opcode_specs() */
+    u8 length = 0;
+    u8 cycles = 0;
+    u8 cycles_branched = 0;
+};
+
+constexpr bool is_byte_register(Operand operand) {
+    return operand == Operand::A || operand == Operand::B || operand == Operand::C
+        || operand == Operand::D || operand == Operand::E || operand == Operand::H
+        || operand == Operand::L;
+}
+
+constexpr bool is_word_operand(Operand operand) {
+    return operand == Operand::AF || operand == Operand::BC || operand == Operand::DE
+        || operand == Operand::HL || operand == Operand::SP || operand == Operand::Imm16;
+}
+
+/* Whether an operand refers to memory rather than a register or immediate data */
+constexpr bool is_memory_operand(Operand operand) {
+    switch (operand) {
+        case Operand::AddrBC:
+        case Operand::AddrDE:
+        case Operand::AddrHL:
+        case Operand::AddrHLI:
+        case Operand::AddrHLD:
+        case Operand::AddrImm16:
+        case Operand::HighImm8:
+        case Operand::HighC:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/* Whether an instruction reads or writes memory, through an operand or the stack */
+constexpr bool touches_memory(const OpcodeSpec& spec) {
+    switch (spec.operation) {
+        case Operation::PUSH:
+        case Operation::POP:
+        case Operation::CALL:
+        case Operation::RET:
+        case Operation::RETI:
+        case Operation::RST:
+            return true;
+        default:
+            return is_memory_operand(spec.dst) || is_memory_operand(spec.src);
+    }
+}
+
+/* Whether an instruction writes to memory, through an operand or the stack */
+constexpr bool writes_memory(const OpcodeSpec& spec) {
+    switch (spec.operation) {
+        case Operation::PUSH:
+        case Operation::CALL:
+        case Operation::RST:
+            return true;
+        default:
+            return is_memory_operand(spec.dst);
+    }
+}
+
+/* The number of bytes of immediate data an operand reads from after the opcode */
+constexpr u8 immediate_length(Operand operand) {
+    switch (operand) {
+        case Operand::Imm8:
+        case Operand::SignedImm8:
+        case Operand::HighImm8:
+            return 1;
+        case Operand::Imm16:
+        case Operand::AddrImm16:
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+/* clang-format off */
+constexpr OpcodeSpec base_opcode_specs[256] = {
+    /* 0x00 */ { Operation::NOP },
+    /* 0x01 */ { Operation::LD, Operand::BC, Operand::Imm16 },
+    /* 0x02 */ { Operation::LD, Operand::AddrBC, Operand::A },
+    /* 0x03 */ { Operation::INC, Operand::BC },
+    /* 0x04 */ { Operation::INC, Operand::B },
+    /* 0x05 */ { Operation::DEC, Operand::B },
+    /* 0x06 */ { Operation::LD, Operand::B, Operand::Imm8 },
+    /* 0x07 */ { Operation::RLCA },
+    /* 0x08 */ { Operation::LD, Operand::AddrImm16, Operand::SP },
+    /* 0x09 */ { Operation::ADD, Operand::HL, Operand::BC },
+    /* 0x0A */ { Operation::LD, Operand::A, Operand::AddrBC },
+    /* 0x0B */ { Operation::DEC, Operand::BC },
+    /* 0x0C */ { Operation::INC, Operand::C },
+    /* 0x0D */ { Operation::DEC, Operand::C },
+    /* 0x0E */ { Operation::LD, Operand::C, Operand::Imm8 },
+    /* 0x0F */ { Operation::RRCA },
+
+    /* 0x10 */ { Operation::STOP },
+    /* 0x11 */ { Operation::LD, Operand::DE, Operand::Imm16 },
+    /* 0x12 */ { Operation::LD, Operand::AddrDE, Operand::A },
+    /* 0x13 */ { Operation::INC, Operand::DE },
+    /* 0x14 */ { Operation::INC, Operand::D },
+    /* 0x15 */ { Operation::DEC, Operand::D },
+    /* 0x16 */ { Operation::LD, Operand::D, Operand::Imm8 },
+    /* 0x17 */ { Operation::RLA },
+    /* 0x18 */ { Operation::JR, Operand::None, Operand::SignedImm8 },
+    /* 0x19 */ { Operation::ADD, Operand::HL, Operand::DE },
+    /* 0x1A */ { Operation::LD, Operand::A, Operand::AddrDE },
+    /* 0x1B */ { Operation::DEC, Operand::DE },
+    /* 0x1C */ { Operation::INC, Operand::E },
+    /* 0x1D */ { Operation::DEC, Operand::E },
+    /* 0x1E */ { Operation::LD, Operand::E, Operand::Imm8 },
+    /* 0x1F */ { Operation::RRA },
+
+    /* 0x20 */ { Operation::JR, Operand::None, Operand::SignedImm8, Condition::NZ },
+    /* 0x21 */ { Operation::LD, Operand::HL, Operand::Imm16 },
+    /* 0x22 */ { Operation::LD, Operand::AddrHLI, Operand::A },
+    /* 0x23 */ { Operation::INC, Operand::HL },
+    /* 0x24 */ { Operation::INC, Operand::H },
+    /* 0x25 */ { Operation::DEC, Operand::H },
+    /* 0x26 */ { Operation::LD, Operand::H, Operand::Imm8 },
+    /* 0x27 */ { Operation::DAA },
+    /* 0x28 */ { Operation::JR, Operand::None, Operand::SignedImm8, Condition::Z },
+    /* 0x29 */ { Operation::ADD, Operand::HL, Operand::HL },
+    /* 0x2A */ { Operation::LD, Operand::A, Operand::AddrHLI },
+    /* 0x2B */ { Operation::DEC, Operand::HL },
+    /* 0x2C */ { Operation::INC, Operand::L },
+    /* 0x2D */ { Operation::DEC, Operand::L },
+    /* 0x2E */ { Operation::LD, Operand::L, Operand::Imm8 },
+    /* 0x2F */ { Operation::CPL },
+
+    /* 0x30 */ { Operation::JR, Operand::None, Operand::SignedImm8, Condition::NC },
+    /* 0x31 */ { Operation::LD, Operand::SP, Operand::Imm16 },
+    /* 0x32 */ { Operation::LD, Operand::AddrHLD, Operand::A },
+    /* 0x33 */ { Operation::INC, Operand::SP },
+    /* 0x34 */ { Operation::INC, Operand::AddrHL },
+    /* 0x35 */ { Operation::DEC, Operand::AddrHL },
+    /* 0x36 */ { Operation::LD, Operand::AddrHL, Operand::Imm8 },
+    /* 0x37 */ { Operation::SCF },
+    /* 0x38 */ { Operation::JR, Operand::None, Operand::SignedImm8, Condition::C },
+    /* 0x39 */ { Operation::ADD, Operand::HL, Operand::SP },
+    /* 0x3A */ { Operation::LD, Operand::A, Operand::AddrHLD },
+    /* 0x3B */ { Operation::DEC, Operand::SP },
+    /* 0x3C */ { Operation::INC, Operand::A },
+    /* 0x3D */ { Operation::DEC, Operand::A },
+    /* 0x3E */ { Operation::LD, Operand::A, Operand::Imm8 },
+    /* 0x3F */ { Operation::CCF },
+
+    /* 0x40 */ { Operation::LD, Operand::B, Operand::B },
+    /* 0x41 */ { Operation::LD, Operand::B, Operand::C },
+    /* 0x42 */ { Operation::LD, Operand::B, Operand::D },
+    /* 0x43 */ { Operation::LD, Operand::B, Operand::E },
+    /* 0x44 */ { Operation::LD, Operand::B, Operand::H },
+    /* 0x45 */ { Operation::LD, Operand::B, Operand::L },
+    /* 0x46 */ { Operation::LD, Operand::B, Operand::AddrHL },
+    /* 0x47 */ { Operation::LD, Operand::B, Operand::A },
+    /* 0x48 */ { Operation::LD, Operand::C, Operand::B },
+    /* 0x49 */ { Operation::LD, Operand::C, Operand::C },
+    /* 0x4A */ { Operation::LD, Operand::C, Operand::D },
+    /* 0x4B */ { Operation::LD, Operand::C, Operand::E },
+    /* 0x4C */ { Operation::LD, Operand::C, Operand::H },
+    /* 0x4D */ { Operation::LD, Operand::C, Operand::L },
+    /* 0x4E */ { Operation::LD, Operand::C, Operand::AddrHL },
+    /* 0x4F */ { Operation::LD, Operand::C, Operand::A },
+
+    /* 0x50 */ { Operation::LD, Operand::D, Operand::B },
+    /* 0x51 */ { Operation::LD, Operand::D, Operand::C },
+    /* 0x52 */ { Operation::LD, Operand::D, Operand::D },
+    /* 0x53 */ { Operation::LD, Operand::D, Operand::E },
+    /* 0x54 */ { Operation::LD, Operand::D, Operand::H },
+    /* 0x55 */ { Operation::LD, Operand::D, Operand::L },
+    /* 0x56 */ { Operation::LD, Operand::D, Operand::AddrHL },
+    /* 0x57 */ { Operation::LD, Operand::D, Operand::A },
+    /* 0x58 */ { Operation::LD, Operand::E, Operand::B },
+    /* 0x59 */ { Operation::LD, Operand::E, Operand::C },
+    /* 0x5A */ { Operation::LD, Operand::E, Operand::D },
+    /* 0x5B */ { Operation::LD, Operand::E, Operand::E },
+    /* 0x5C */ { Operation::LD, Operand::E, Operand::H },
+    /* 0x5D */ { Operation::LD, Operand::E, Operand::L },
+    /* 0x5E */ { Operation::LD, Operand::E, Operand::AddrHL },
+    /* 0x5F */ { Operation::LD, Operand::E, Operand::A },
+
+    /* 0x60 */ { Operation::LD, Operand::H, Operand::B },
+    /* 0x61 */ { Operation::LD, Operand::H, Operand::C },
+    /* 0x62 */ { Operation::LD, Operand::H, Operand::D },
+    /* 0x63 */ { Operation::LD, Operand::H, Operand::E },
+    /* 0x64 */ { Operation::LD, Operand::H, Operand::H },
+    /* 0x65 */ { Operation::LD, Operand::H, Operand::L },
+    /* 0x66 */ { Operation::LD, Operand::H, Operand::AddrHL },
+    /* 0x67 */ { Operation::LD, Operand::H, Operand::A },
+    /* 0x68 */ { Operation::LD, Operand::L, Operand::B },
+    /* 0x69 */ { Operation::LD, Operand::L, Operand::C },
+    /* 0x6A */ { Operation::LD, Operand::L, Operand::D },
+    /* 0x6B */ { Operation::LD, Operand::L, Operand::E },
+    /* 0x6C */ { Operation::LD, Operand::L, Operand::H },
+    /* 0x6D */ { Operation::LD, Operand::L, Operand::L },
+    /* 0x6E */ { Operation::LD, Operand::L, Operand::AddrHL },
+    /* 0x6F */ { Operation::LD, Operand::L, Operand::A },
+
+    /* 0x70 */ { Operation::LD, Operand::AddrHL, Operand::B },
+    /* 0x71 */ { Operation::LD, Operand::AddrHL, Operand::C },
+    /* 0x72 */ { Operation::LD, Operand::AddrHL, Operand::D },
+    /* 0x73 */ { Operation::LD, Operand::AddrHL, Operand::E },
+    /* 0x74 */ { Operation::LD, Operand::AddrHL, Operand::H },
+    /* 0x75 */ { Operation::LD, Operand::AddrHL, Operand::L },
+    /* 0x76 */ { Operation::HALT },
+    /* 0x77 */ { Operation::LD, Operand::AddrHL, Operand::A },
+    /* 0x78 */ { Operation::LD, Operand::A, Operand::B },
+    /* 0x79 */ { Operation::LD, Operand::A, Operand::C },
+    /* 0x7A */ { Operation::LD, Operand::A, Operand::D },
+    /* 0x7B */ { Operation::LD, Operand::A, Operand::E },
+    /* 0x7C */ { Operation::LD, Operand::A, Operand::H },
+    /* 0x7D */ { Operation::LD, Operand::A, Operand::L },
+    /* 0x7E */ { Operation::LD, Operand::A, Operand::AddrHL },
+    /* 0x7F */ { Operation::LD, Operand::A, Operand::A },
+
+    /* 0x80 */ { Operation::ADD, Operand::A, Operand::B },
+    /* 0x81 */ { Operation::ADD, Operand::A, Operand::C },
+    /* 0x82 */ { Operation::ADD, Operand::A, Operand::D },
+    /* 0x83 */ { Operation::ADD, Operand::A, Operand::E },
+    /* 0x84 */ { Operation::ADD, Operand::A, Operand::H },
+    /* 0x85 */ { Operation::ADD, Operand::A, Operand::L },
+    /* 0x86 */ { Operation::ADD, Operand::A, Operand::AddrHL },
+    /* 0x87 */ { Operation::ADD, Operand::A, Operand::A },
+    /* 0x88 */ { Operation::ADC, Operand::A, Operand::B },
+    /* 0x89 */ { Operation::ADC, Operand::A, Operand::C },
+    /* 0x8A */ { Operation::ADC, Operand::A, Operand::D },
+    /* 0x8B */ { Operation::ADC, Operand::A, Operand::E },
+    /* 0x8C */ { Operation::ADC, Operand::A, Operand::H },
+    /* 0x8D */ { Operation::ADC, Operand::A, Operand::L },
+    /* 0x8E */ { Operation::ADC, Operand::A, Operand::AddrHL },
+    /* 0x8F */ { Operation::ADC, Operand::A, Operand::A },
+
+    /* 0x90 */ { Operation::SUB, Operand::A, Operand::B },
+    /* 0x91 */ { Operation::SUB, Operand::A, Operand::C },
+    /* 0x92 */ { Operation::SUB, Operand::A, Operand::D },
+    /* 0x93 */ { Operation::SUB, Operand::A, Operand::E },
+    /* 0x94 */ { Operation::SUB, Operand::A, Operand::H },
+    /* 0x95 */ { Operation::SUB, Operand::A, Operand::L },
+    /* 0x96 */ { Operation::SUB, Operand::A, Operand::AddrHL },
+    /* 0x97 */ { Operation::SUB, Operand::A, Operand::A },
+    /* 0x98 */ { Operation::SBC, Operand::A, Operand::B },
+    /* 0x99 */ { Operation::SBC, Operand::A, Operand::C },
+    /* 0x9A */ { Operation::SBC, Operand::A, Operand::D },
+    /* 0x9B */ { Operation::SBC, Operand::A, Operand::E },
+    /* 0x9C */ { Operation::SBC, Operand::A, Operand::H },
+    /* 0x9D */ { Operation::SBC, Operand::A, Operand::L },
+    /* 0x9E */ { Operation::SBC, Operand::A, Operand::AddrHL },
+    /* 0x9F */ { Operation::SBC, Operand::A, Operand::A },
+
+    /* 0xA0 */ { Operation::AND, Operand::A, Operand::B },
+    /* 0xA1 */ { Operation::AND, Operand::A, Operand::C },
+    /* 0xA2 */ { Operation::AND, Operand::A, Operand::D },
+    /* 0xA3 */ { Operation::AND, Operand::A, Operand::E },
+    /* 0xA4 */ { Operation::AND, Operand::A, Operand::H },
+    /* 0xA5 */ { Operation::AND, Operand::A, Operand::L },
+    /* 0xA6 */ { Operation::AND, Operand::A, Operand::AddrHL },
+    /* 0xA7 */ { Operation::AND, Operand::A, Operand::A },
+    /* 0xA8 */ { Operation::XOR, Operand::A, Operand::B },
+    /* 0xA9 */ { Operation::XOR, Operand::A, Operand::C },
+    /* 0xAA */ { Operation::XOR, Operand::A, Operand::D },
+    /* 0xAB */ { Operation::XOR, Operand::A, Operand::E },
+    /* 0xAC */ { Operation::XOR, Operand::A, Operand::H },
+    /* 0xAD */ { Operation::XOR, Operand::A, Operand::L },
+    /* 0xAE */ { Operation::XOR, Operand::A, Operand::AddrHL },
+    /* 0xAF */ { Operation::XOR, Operand::A, Operand::A },
+
+    /* 0xB0 */ { Operation::OR, Operand::A, Operand::B },
+    /* 0xB1 */ { Operation::OR, Operand::A, Operand::C },
+    /* 0xB2 */ { Operation::OR, Operand::A, Operand::D },
+    /* 0xB3 */ { Operation::OR, Operand::A, Operand::E },
+    /* 0xB4 */ { Operation::OR, Operand::A, Operand::H },
+    /* 0xB5 */ { Operation::OR, Operand::A, Operand::L },
+    /* 0xB6 */ { Operation::OR, Operand::A, Operand::AddrHL },
+    /* 0xB7 */ { Operation::OR, Operand::A, Operand::A },
+    /* 0xB8 */ { Operation::CP, Operand::A, Operand::B },
+    /* 0xB9 */ { Operation::CP, Operand::A, Operand::C },
+    /* 0xBA */ { Operation::CP, Operand::A, Operand::D },
+    /* 0xBB */ { Operation::CP, Operand::A, Operand::E },
+    /* 0xBC */ { Operation::CP, Operand::A, Operand::H },
+    /* 0xBD */ { Operation::CP, Operand::A, Operand::L },
+    /* 0xBE */ { Operation::CP, Operand::A, Operand::AddrHL },
+    /* 0xBF */ { Operation::CP, Operand::A, Operand::A },
+
+    /* 0xC0 */ { Operation::RET, Operand::None, Operand::None, Condition::NZ },
+    /* 0xC1 */ { Operation::POP, Operand::BC },
+    /* 0xC2 */ { Operation::JP, Operand::None, Operand::Imm16, Condition::NZ },
+    /* 0xC3 */ { Operation::JP, Operand::None, Operand::Imm16 },
+    /* 0xC4 */ { Operation::CALL, Operand::None, Operand::Imm16, Condition::NZ },
+    /* 0xC5 */ { Operation::PUSH, Operand::None, Operand::BC },
+    /* 0xC6 */ { Operation::ADD, Operand::A, Operand::Imm8 },
+    /* 0xC7 */ { Operation::RST, Operand::None, Operand::None, Condition::Always, rst::rst1 },
+    /* 0xC8 */ { Operation::RET, Operand::None, Operand::None, Condition::Z },
+    /* 0xC9 */ { Operation::RET },
+    /* 0xCA */ { Operation::JP, Operand::None, Operand::Imm16, Condition::Z },
+    /* 0xCB */ { Operation::PREFIX_CB },
+    /* 0xCC */ { Operation::CALL, Operand::None, Operand::Imm16, Condition::Z },
+    /* 0xCD */ { Operation::CALL, Operand::None, Operand::Imm16 },
+    /* 0xCE */ { Operation::ADC, Operand::A, Operand::Imm8 },
+    /* 0xCF */ { Operation::RST, Operand::None, Operand::None, Condition::Always, rst::rst2 },
+
+    /* 0xD0 */ { Operation::RET, Operand::None, Operand::None, Condition::NC },
+    /* 0xD1 */ { Operation::POP, Operand::DE },
+    /* 0xD2 */ { Operation::JP, Operand::None, Operand::Imm16, Condition::NC },
+    /* 0xD3 */ { Operation::UNDEFINED },
+    /* 0xD4 */ { Operation::CALL, Operand::None, Operand::Imm16, Condition::NC },
+    /* 0xD5 */ { Operation::PUSH, Operand::None, Operand::DE },
+    /* 0xD6 */ { Operation::SUB, Operand::A, Operand::Imm8 },
+    /* 0xD7 */ { Operation::RST, Operand::None, Operand::None, Condition::Always, rst::rst3 },
+    /* 0xD8 */ { Operation::RET, Operand::None, Operand::None, Condition::C },
+    /* 0xD9 */ { Operation::RETI },
+    /* 0xDA */ { Operation::JP, Operand::None, Operand::Imm16, Condition::C },
+    /* 0xDB */ { Operation::UNDEFINED },
+    /* 0xDC */ { Operation::CALL, Operand::None, Operand::Imm16, Condition::C },
+    /* 0xDD */ { Operation::UNDEFINED },
+    /* 0xDE */ { Operation::SBC, Operand::A, Operand::Imm8 },
+    /* 0xDF */ { Operation::RST, Operand::None, Operand::None, Condition::Always, rst::rst4 },
+
+    /* 0xE0 */ { Operation::LD, Operand::HighImm8, Operand::A },
+    /* 0xE1 */ { Operation::POP, Operand::HL },
+    /* 0xE2 */ { Operation::LD, Operand::HighC, Operand::A },
+    /* 0xE3 */ { Operation::UNDEFINED },
+    /* 0xE4 */ { Operation::UNDEFINED },
+    /* 0xE5 */ { Operation::PUSH, Operand::None, Operand::HL },
+    /* 0xE6 */ { Operation::AND, Operand::A, Operand::Imm8 },
+    /* 0xE7 */ { Operation::RST, Operand::None, Operand::None, Condition::Always, rst::rst5 },
+    /* 0xE8 */ { Operation::ADD, Operand::SP, Operand::SignedImm8 },
+    /* 0xE9 */ { Operation::JP, Operand::None, Operand::HL },
+    /* 0xEA */ { Operation::LD, Operand::AddrImm16, Operand::A },
+    /* 0xEB */ { Operation::UNDEFINED },
+    /* 0xEC */ { Operation::UNDEFINED },
+    /* 0xED */ { Operation::UNDEFINED },
+    /* 0xEE */ { Operation::XOR, Operand::A, Operand::Imm8 },
+    /* 0xEF */ { Operation::RST, Operand::None, Operand::None, Condition::Always, rst::rst6 },
+
+    /* 0xF0 */ { Operation::LD, Operand::A, Operand::HighImm8 },
+    /* 0xF1 */ { Operation::POP, Operand::AF },
+    /* 0xF2 */ { Operation::LD, Operand::A, Operand::HighC },
+    /* 0xF3 */ { Operation::DI },
+    /* 0xF4 */ { Operation::UNDEFINED },
+    /* 0xF5 */ { Operation::PUSH, Operand::None, Operand::AF },
+    /* 0xF6 */ { Operation::OR, Operand::A, Operand::Imm8 },
+    /* 0xF7 */ { Operation::RST, Operand::None, Operand::None, Condition::Always, rst::rst7 },
+    /* 0xF8 */ { Operation::LDHL, Operand::HL, Operand::SignedImm8 },
+    /* 0xF9 */ { Operation::LD, Operand::SP, Operand::HL },
+    /* 0xFA */ { Operation::LD, Operand::A, Operand::AddrImm16 },
+    /* 0xFB */ { Operation::EI },
+    /* 0xFC */ { Operation::UNDEFINED },
+    /* 0xFD */ { Operation::UNDEFINED },
+    /* 0xFE */ { Operation::CP, Operand::A, Operand::Imm8 },
+    /* 0xFF */ { Operation::RST, Operand::None, Operand::None, Condition::Always, rst::rst8 },
+};
+/* clang-format on */
+
+/* The length and cycle counts of each opcode are derived from its operands and
+ * from the tables in opcode_cycles.h */
+constexpr std::array<OpcodeSpec, 256> make_opcode_specs() {
+    std::array<OpcodeSpec, 256> specs = {};
+
+    for (uint opcode = 0; opcode < 256; opcode++) {
+        OpcodeSpec& spec = specs[opcode];
+
+        spec = base_opcode_specs[opcode];
+        spec.length = static_cast<u8>(1 + immediate_length(spec.dst) + immediate_length(spec.src));
+        spec.cycles = opcode_cycles[opcode];
+        spec.cycles_branched = opcode_cycles_branched[opcode];
+    }
+
+    return specs;
+}
+
+/* CB-prefixed opcodes are laid out regularly: the low three bits select the
+ * operand, the next three the bit for BIT/RES/SET (or the kind of rotate or
+ * shift), and the top two bits the kind of operation. */
+constexpr std::array<OpcodeSpec, 256> make_cb_opcode_specs() {
+    const Operand operands[8] = {
+        Operand::B, Operand::C, Operand::D, Operand::E,
+        Operand::H, Operand::L, Operand::AddrHL, Operand::A,
+    };
+
+    const Operation shifts[8] = {
+        Operation::RLC, Operation::RRC, Operation::RL, Operation::RR,
+        Operation::SLA, Operation::SRA, Operation::SWAP, Operation::SRL,
+    };
+
+    const Operation bit_operations[4] = {
+        Operation::UNDEFINED, Operation::BIT, Operation::RES, Operation::SET,
+    };
+
+    std::array<OpcodeSpec, 256> specs = {};
+
+    for (uint opcode = 0; opcode < 256; opcode++) {
+        OpcodeSpec& spec = specs[opcode];
+
+        Operand operand = operands[opcode & 0x7];
+        u8 selector = static_cast<u8>((opcode >> 3) & 0x7);
+        uint kind = opcode >> 6;
+
+        if (kind == 0) {
+            spec.operation = shifts[selector];
+            spec.dst = operand;
+        } else if (kind == 1) {
+            spec.operation = Operation::BIT;
+            spec.src = operand;
+            spec.param = selector;
+        } else {
+            spec.operation = bit_operations[kind];
+            spec.dst = operand;
+            spec.param = selector;
+        }
+
+        spec.length = 2;
+        spec.cycles = opcode_cycles_cb[opcode];
+        spec.cycles_branched = opcode_cycles_cb[opcode];
+    }
+
+    return specs;
+}
+
+constexpr std::array<OpcodeSpec, 256> opcode_specs = make_opcode_specs();
+constexpr std::array<OpcodeSpec, 256> cb_opcode_specs = make_cb_opcode_specs();
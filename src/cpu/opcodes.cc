@@ -6,35 +6,17 @@
 #include <cstdlib>
 
 using bitwise::check_bit;
-using bitwise::clear_bit;
-using bitwise::set_bit;
 
 /* ADC */
 void CPU::_opcode_adc(u8 value) {
-    u8 reg = a.value();
-    u8 carry = f.flag_carry_value();
+    u8 reg = registers.a;
+    u8 carry = static_cast<u8>(registers.flag_carry());
 
-    uint result_full = reg + value + carry;
-    u8 result = static_cast<u8>(result_full);
+    u8 result = static_cast<u8>(reg + value + carry);
 
-    set_flag_zero(result == 0);
-    set_flag_subtract(false);
-    set_flag_half_carry(((reg & 0xf) + (value & 0xf) + carry) > 0xf);
-    set_flag_carry(result_full > 0xff);
-
-    a.set(result);
-}
-
-void CPU::opcode_adc() {
-    _opcode_adc(get_byte_from_pc());
-}
-
-void CPU::opcode_adc(const ByteRegister& reg) {
-    _opcode_adc(reg.value());
-}
+    registers.set_flags(FlagOperation::Add, reg, value, carry);
 
-void CPU::opcode_adc(const Address&& addr) {
-    _opcode_adc(mmu.read(addr));
+    registers.a = result;
 }
 
 
@@ -42,29 +24,14 @@ void CPU::opcode_adc(const Address&& addr) {
 void CPU::_opcode_add(u8 reg, u8 value) {
     uint result = reg + value;
 
-    a.set(static_cast<u8>(result));
-
-    set_flag_zero(a.value() == 0);
-    set_flag_subtract(false);
-    set_flag_half_carry((reg & 0xf) + (value & 0xf) > 0xf);
-    set_flag_carry((result & 0x100) != 0);
-}
-
-void CPU::opcode_add_a() {
-    _opcode_add(a.value(), get_byte_from_pc());
-}
-
-void CPU::opcode_add_a(const ByteRegister& reg) {
-    _opcode_add(a.value(), reg.value());
-}
+    registers.a = static_cast<u8>(result);
 
-void CPU::opcode_add_a(const Address& addr) {
-    _opcode_add(a.value(), mmu.read(addr));
+    registers.set_flags(FlagOperation::Add, reg, value, 0);
 }
 
 
 void CPU::_opcode_add_hl(u16 value) {
-    u16 reg = hl.value();
+    u16 reg = registers.hl;
 
     uint result = reg + value;
 
@@ -72,20 +39,12 @@ void CPU::_opcode_add_hl(u16 value) {
     set_flag_half_carry((reg & 0xfff) + (value & 0xfff) > 0xfff);
     set_flag_carry((result & 0x10000) != 0);
 
-    hl.set(static_cast<u16>(result));
+    registers.hl = static_cast<u16>(result);
 }
 
-void CPU::opcode_add_hl(const RegisterPair& reg_pair) {
-    _opcode_add_hl(reg_pair.value());
-}
-
-void CPU::opcode_add_hl(const WordRegister& word_reg) {
-    _opcode_add_hl(word_reg.value());
-}
 
-void CPU::opcode_add_sp() {
-    u16 reg = sp.value();
-    s8 value = get_signed_byte_from_pc();
+void CPU::opcode_add_sp(const s8 value) {
+    u16 reg = registers.sp;
 
     int result = static_cast<int>(reg + value);
 
@@ -94,33 +53,18 @@ void CPU::opcode_add_sp() {
     set_flag_half_carry(((reg ^ value ^ (result & 0xFFFF)) & 0x10) == 0x10);
     set_flag_carry(((reg ^ value ^ (result & 0xFFFF)) & 0x100) == 0x100);
 
-    sp.set(static_cast<u16>(result));
+    registers.sp = static_cast<u16>(result);
 }
 
 
 /* AND */
 void CPU::_opcode_and(u8 value) {
-    u8 reg = a.value();
+    u8 reg = registers.a;
     u8 result = reg & value;
 
-    a.set(result);
-
-    set_flag_zero(a.value() == 0);
-    set_flag_half_carry(true);
-    set_flag_carry(false);
-    set_flag_subtract(false);
-}
-
-void CPU::opcode_and() {
-    _opcode_and(get_byte_from_pc());
-}
-
-void CPU::opcode_and(ByteRegister& reg) {
-    _opcode_and(reg.value());
-}
+    registers.a = result;
 
-void CPU::opcode_and(Address&& addr) {
-    _opcode_and(mmu.read(addr));
+    registers.set_flags(FlagOperation::And, result, 0, 0);
 }
 
 
@@ -131,29 +75,11 @@ void CPU::_opcode_bit(const u8 bit, const u8 value) {
     set_flag_half_carry(true);
 }
 
-void CPU::opcode_bit(const u8 bit, ByteRegister& reg) {
-    _opcode_bit(bit, reg.value());
-}
-
-void CPU::opcode_bit(const u8 bit, Address&& addr) {
-    _opcode_bit(bit, mmu.read(addr));
-}
-
 
 /* CALL */
-void CPU::opcode_call() {
-    u16 address = get_word_from_pc();
-    stack_push(pc);
-    pc.set(address);
-}
-
-void CPU::opcode_call(Condition condition) {
-    if (is_condition(condition)) {
-        opcode_call();
-    } else {
-        /* Consume unused word argument */
-        get_word_from_pc();
-    }
+void CPU::opcode_call(const u16 address) {
+    stack_push(registers.pc);
+    registers.pc = address;
 }
 
 
@@ -161,39 +87,23 @@ void CPU::opcode_call(Condition condition) {
 void CPU::opcode_ccf() {
     set_flag_subtract(false);
     set_flag_half_carry(false);
-    set_flag_carry(!f.flag_carry());
+    set_flag_carry(!registers.flag_carry());
 }
 
 
 /* CP */
 void CPU::_opcode_cp(const u8 value) {
-    u8 reg = a.value();
-    u8 result = static_cast<u8>(reg - value);
-
-    set_flag_zero(result == 0);
-    set_flag_subtract(true);
-    set_flag_half_carry(((reg & 0xf) - (value & 0xf)) < 0);
-    set_flag_carry(reg < value);
-}
+    u8 reg = registers.a;
 
-void CPU::opcode_cp() {
-    _opcode_cp(get_byte_from_pc());
-}
-
-void CPU::opcode_cp(const ByteRegister& reg) {
-    _opcode_cp(reg.value());
-}
-
-void CPU::opcode_cp(const Address& addr) {
-    _opcode_cp(mmu.read(addr));
+    registers.set_flags(FlagOperation::Sub, reg, value, 0);
 }
 
 
 /* CPL */
 void CPU::opcode_cpl() {
-    u8 reg = a.value();
+    u8 reg = registers.a;
     u8 result = ~reg;
-    a.set(result);
+    registers.a = result;
 
     set_flag_subtract(true);
     set_flag_half_carry(true);
@@ -202,21 +112,21 @@ void CPU::opcode_cpl() {
 
 /* DAA */
 void CPU::opcode_daa() {
-    u8 reg = a.value();
+    u8 reg = registers.a;
 
-    u16 correction = f.flag_carry()
+    u16 correction = registers.flag_carry()
         ? 0x60
         : 0x00;
 
-    if (f.flag_half_carry() || (!f.flag_subtract() && ((reg & 0x0F) > 9))) {
+    if (registers.flag_half_carry() || (!registers.flag_subtract() && ((reg & 0x0F) > 9))) {
         correction |= 0x06;
     }
 
-    if (f.flag_carry() || (!f.flag_subtract() && (reg > 0x99))) {
+    if (registers.flag_carry() || (!registers.flag_subtract() && (reg > 0x99))) {
         correction |= 0x60;
     }
 
-    if (f.flag_subtract()) {
+    if (registers.flag_subtract()) {
         reg = static_cast<u8>(reg - correction);
     } else {
         reg = static_cast<u8>(reg + correction);
@@ -229,229 +139,68 @@ void CPU::opcode_daa() {
     set_flag_half_carry(false);
     set_flag_zero(reg == 0);
 
-    a.set(static_cast<u8>(reg));
+    registers.a = static_cast<u8>(reg);
 }
 
 
 /* DEC */
-void CPU::opcode_dec(ByteRegister& reg) {
-    reg.decrement();
-
-    set_flag_zero(reg.value() == 0);
-    set_flag_subtract(true);
-    set_flag_half_carry((reg.value() & 0x0F) == 0x0F);
-}
-
-void CPU::opcode_dec(RegisterPair& reg) {
-    reg.decrement();
-}
-
-void CPU::opcode_dec(WordRegister& reg) {
-    reg.decrement();
-}
-
-void CPU::opcode_dec(Address&& addr) {
-    u8 value = mmu.read(addr);
+u8 CPU::_opcode_dec(const u8 value) {
     u8 result = static_cast<u8>(value - 1);
-    mmu.write(addr, result);
 
-    set_flag_zero(result == 0);
-    set_flag_subtract(true);
-    set_flag_half_carry((result & 0x0F) == 0x0F);
+    registers.set_flags(FlagOperation::Dec, result, 0, registers.flag_carry());
+
+    return result;
 }
 
 
 /* DI */
 void CPU::opcode_di() {
-    interrupts_enabled = false;
+    interrupts.set_master_enabled(false);
 }
 
 
 /* EI */
 void CPU::opcode_ei() {
-    interrupts_enabled = true;
+    interrupts.set_master_enabled(true);
 }
 
 
 /* INC */
-void CPU::opcode_inc(ByteRegister& reg) {
-    reg.increment();
-
-    set_flag_zero(reg.value() == 0);
-    set_flag_subtract(false);
-    set_flag_half_carry((reg.value() & 0x0F) == 0x00);
-}
-
-void CPU::opcode_inc(RegisterPair& reg) {
-    reg.increment();
-}
-
-void CPU::opcode_inc(WordRegister& reg) {
-    reg.increment();
-}
-
-void CPU::opcode_inc(Address&& addr) {
-    u8 value = mmu.read(addr);
+u8 CPU::_opcode_inc(const u8 value) {
     u8 result = static_cast<u8>(value + 1);
-    mmu.write(addr, result);
-
-    set_flag_zero(result == 0);
-    set_flag_subtract(false);
-    set_flag_half_carry((result & 0x0F) == 0x00);
-}
 
+    registers.set_flags(FlagOperation::Inc, result, 0, registers.flag_carry());
 
-/* JP */
-void CPU::opcode_jp() {
-    u16 address = get_word_from_pc();
-    pc.set(address);
+    return result;
 }
 
-void CPU::opcode_jp(Condition condition) {
-    if (is_condition(condition)) {
-        opcode_jp();
-    } else {
-        /* Consume unused word argument */
-        get_word_from_pc();
-    }
-}
 
-void CPU::opcode_jp(const Address& addr) {
-    unused(addr);
-    pc.set(hl.value());
+/* JP */
+void CPU::opcode_jp(const u16 address) {
+    registers.pc = address;
 }
 
 
 /* JR */
-void CPU::opcode_jr() {
-    s8 offset = get_signed_byte_from_pc();
-
+void CPU::opcode_jr(const s8 offset) {
     if (options.exit_on_infinite_jr && offset == -2) { exit(0); }
 
-    u16 old_pc = pc.value();
+    u16 old_pc = registers.pc;
 
     u16 new_pc = static_cast<u16>(old_pc + offset);
-    pc.set(new_pc);
-}
-
-void CPU::opcode_jr(Condition condition) {
-    if (is_condition(condition)) {
-        opcode_jr();
-    } else {
-        /* Consume unused argument */
-        get_signed_byte_from_pc();
-    }
+    registers.pc = new_pc;
 }
 
 
 /* HALT */
 void CPU::opcode_halt() {
-    halted = true;
-}
-
-
-/* LD */
-void CPU::opcode_ld(ByteRegister& reg) {
-    u8 n = get_byte_from_pc();
-    reg.set(n);
-}
-
-void CPU::opcode_ld(ByteRegister& reg, const ByteRegister& byte_reg) {
-    reg.set(byte_reg.value());
-}
-
-void CPU::opcode_ld(ByteRegister& reg, const Address& address) {
-    reg.set(mmu.read(address));
-}
-
-void CPU::opcode_ld_from_addr(ByteRegister& reg) {
-    u16 nn = get_word_from_pc();
-    reg.set(mmu.read(nn));
-}
-
-void CPU::opcode_ld(RegisterPair& reg) {
-    u16 nn = get_word_from_pc();
-    reg.set(nn);
-}
-
-
-void CPU::opcode_ld(WordRegister& reg) {
-    u16 nn = get_word_from_pc();
-    reg.set(nn);
-}
-
-void CPU::opcode_ld(WordRegister& reg, const RegisterPair& reg_pair) {
-    reg.set(reg_pair.value());
-}
-
-
-void CPU::opcode_ld(const Address& address) {
-    u8 n = get_byte_from_pc();
-    mmu.write(address, n);
-}
-
-void CPU::opcode_ld(const Address& address, const ByteRegister& byte_reg) {
-    mmu.write(address, byte_reg.value());
-}
-
-void CPU::opcode_ld(const Address& address, const WordRegister& word_reg) {
-    mmu.write(address, word_reg.low());
-    mmu.write(address + 1, word_reg.high());
-}
-
-
-void CPU::opcode_ld_to_addr(const ByteRegister &reg) {
-    u16 address = get_word_from_pc();
-    mmu.write(Address(address), reg.value());
-}
-
-
-/* LDD */
-void CPU::opcode_ldd(ByteRegister& reg, const Address& address) {
-    reg.set(mmu.read(address));
-    hl.decrement();
-}
-
-void CPU::opcode_ldd(const Address& address, const ByteRegister& reg) {
-    mmu.write(address, reg.value());
-    hl.decrement();
-}
-
-
-/* LDH */
-void CPU::opcode_ldh_into_a() {
-    u8 offset = get_byte_from_pc();
-    auto address = Address(0xFF00 + offset);
-
-    u8 value = mmu.read(address);
-    a.set(value);
-}
-
-void CPU::opcode_ldh_into_data() {
-    u8 offset = get_byte_from_pc();
-    auto address = Address(0xFF00 + offset);
-
-    mmu.write(address, a.value());
-}
-
-void CPU::opcode_ldh_into_c() {
-    u8 offset = c.value();
-    auto address = Address(0xFF00 + offset);
-
-    mmu.write(address, a.value());
-}
-
-void CPU::opcode_ldh_c_into_a() {
-    auto address = Address(0xFF00 + c.value());
-
-    a.set(mmu.read(address));
+    registers.halted = true;
 }
 
 
 /* LDHL */
-void CPU::opcode_ldhl() {
-    u16 reg = sp.value();
-    s8 value = get_signed_byte_from_pc();
+void CPU::opcode_ldhl(const s8 value) {
+    u16 reg = registers.sp;
 
     int result = static_cast<int>(reg + value);
 
@@ -460,19 +209,7 @@ void CPU::opcode_ldhl() {
     set_flag_half_carry(((reg ^ value ^ (result & 0xFFFF)) & 0x10) == 0x10);
     set_flag_carry(((reg ^ value ^ (result & 0xFFFF)) & 0x100) == 0x100);
 
-    hl.set(static_cast<u16>(result));
-}
-
-
-/* LDI */
-void CPU::opcode_ldi(ByteRegister& reg, const Address& address) {
-    reg.set(mmu.read(address));
-    hl.increment();
-}
-
-void CPU::opcode_ldi(const Address& address, const ByteRegister& reg) {
-    mmu.write(address, reg.value());
-    hl.increment();
+    registers.hl = static_cast<u16>(result);
 }
 
 
@@ -484,65 +221,18 @@ void CPU::opcode_nop() {
 
 /* OR */
 void CPU::_opcode_or(u8 value) {
-    u8 reg = a.value();
+    u8 reg = registers.a;
     u8 result = reg | value;
 
-    a.set(result);
-
-    set_flag_zero(a.value() == 0);
-    set_flag_half_carry(false);
-    set_flag_carry(false);
-    set_flag_subtract(false);
-
-}
-
-void CPU::opcode_or() {
-    _opcode_or(get_byte_from_pc());
-}
-
-void CPU::opcode_or(const ByteRegister& reg) {
-    _opcode_or(reg.value());
-}
-
-void CPU::opcode_or(const Address& addr) {
-    _opcode_or(mmu.read(addr));
-}
-
-
-/* POP */
-void CPU::opcode_pop(RegisterPair& reg) {
-    stack_pop(reg);
-}
-
-
-/* PUSH */
-void CPU::opcode_push(const RegisterPair& reg) {
-    stack_push(reg);
-}
-
-
-/* RES */
-void CPU::opcode_res(const u8 bit, ByteRegister& reg) {
-    u8 result = clear_bit(reg.value(), bit);
-    reg.set(result);
-}
+    registers.a = result;
 
-void CPU::opcode_res(const u8 bit, Address&& addr) {
-    u8 value = mmu.read(addr);
-    u8 result = clear_bit(value, bit);
-    mmu.write(addr, result);
+    registers.set_flags(FlagOperation::Or, result, 0, 0);
 }
 
 
 /* RET */
 void CPU::opcode_ret() {
-    stack_pop(pc);
-}
-
-void CPU::opcode_ret(Condition condition) {
-    if (is_condition(condition)) {
-        opcode_ret();
-    }
+    registers.pc = stack_pop();
 }
 
 
@@ -555,37 +245,23 @@ void CPU::opcode_reti() {
 
 /* RL */
 u8 CPU::_opcode_rl(u8 value) {
-    u8 carry = f.flag_carry_value();
+    u8 carry = static_cast<u8>(registers.flag_carry());
 
     bool will_carry = check_bit(value, 7);
-    set_flag_carry(will_carry);
 
     u8 result = static_cast<u8>(value << 1);
     result |= carry;
 
-    set_flag_zero(result == 0);
-
-    set_flag_subtract(false);
-    set_flag_half_carry(false);
+    registers.set_flags(FlagOperation::Shift, result, 0, will_carry);
 
     return result;
 }
 
 void CPU::opcode_rla() {
-    opcode_rl(a);
+    registers.a = _opcode_rl(registers.a);
     set_flag_zero(false);
 }
 
-void CPU::opcode_rl(ByteRegister& reg) {
-    u8 result = _opcode_rl(reg.value());
-    reg.set(result);
-}
-
-void CPU::opcode_rl(Address&& addr) {
-    u8 result = _opcode_rl(mmu.read(addr));
-    mmu.write(addr, result);
-}
-
 
 /* RLC */
 u8 CPU::_opcode_rlc(u8 value) {
@@ -593,62 +269,36 @@ u8 CPU::_opcode_rlc(u8 value) {
     u8 truncated_bit = check_bit(value, 7);
     u8 result = static_cast<u8>((value << 1) | truncated_bit);
 
-    set_flag_carry(carry_flag);
-    set_flag_zero(result == 0);
-    set_flag_half_carry(false);
-    set_flag_subtract(false);
+    registers.set_flags(FlagOperation::Shift, result, 0, carry_flag);
 
     return result;
 }
 
 void CPU::opcode_rlca() {
-    opcode_rlc(a);
+    registers.a = _opcode_rlc(registers.a);
     set_flag_zero(false);
 }
 
-void CPU::opcode_rlc(ByteRegister& reg) {
-    u8 result = _opcode_rlc(reg.value());
-    reg.set(result);
-}
-
-void CPU::opcode_rlc(Address&& addr) {
-    u8 result = _opcode_rlc(mmu.read(addr));
-    mmu.write(addr, result);
-}
-
 
 /* RR */
 u8 CPU::_opcode_rr(u8 value) {
-    u8 carry = f.flag_carry_value();
+    u8 carry = static_cast<u8>(registers.flag_carry());
 
     bool will_carry = check_bit(value, 0);
-    set_flag_carry(will_carry);
 
     u8 result = static_cast<u8>(value >> 1);
     result |= (carry << 7);
 
-    set_flag_zero(result == 0);
-    set_flag_subtract(false);
-    set_flag_half_carry(false);
+    registers.set_flags(FlagOperation::Shift, result, 0, will_carry);
 
     return result;
 }
 
 void CPU::opcode_rra() {
-    opcode_rr(a);
+    registers.a = _opcode_rr(registers.a);
     set_flag_zero(false);
 }
 
-void CPU::opcode_rr(ByteRegister& reg) {
-    u8 result = _opcode_rr(reg.value());
-    reg.set(result);
-}
-
-void CPU::opcode_rr(Address&& addr) {
-    u8 result = _opcode_rr(mmu.read(addr));
-    mmu.write(addr, result);
-}
-
 
 /* RRC */
 u8 CPU::_opcode_rrc(u8 value) {
@@ -656,63 +306,34 @@ u8 CPU::_opcode_rrc(u8 value) {
     u8 truncated_bit = check_bit(value, 0);
     u8 result = static_cast<u8>((value >> 1) | (truncated_bit << 7));
 
-    set_flag_carry(carry_flag);
-    set_flag_zero(result == 0);
-    set_flag_half_carry(false);
-    set_flag_subtract(false);
+    registers.set_flags(FlagOperation::Shift, result, 0, carry_flag);
 
     return result;
 }
 
 void CPU::opcode_rrca() {
-    opcode_rrc(a);
+    registers.a = _opcode_rrc(registers.a);
     set_flag_zero(false);
 }
 
-void CPU::opcode_rrc(ByteRegister& reg) {
-    u8 result = _opcode_rrc(reg.value());
-    reg.set(result);
-}
-
-void CPU::opcode_rrc(Address&& addr) {
-    u8 result = _opcode_rrc(mmu.read(addr));
-    mmu.write(addr, result);
-}
-
 
 /* RST */
 void CPU::opcode_rst(const u8 offset) {
-    stack_push(pc);
-    pc.set(offset);
+    stack_push(registers.pc);
+    registers.pc = offset;
 }
 
 
 /* SBC */
 void CPU::_opcode_sbc(const u8 value) {
-    u8 carry = f.flag_carry_value();
-    u8 reg = a.value();
-
-    int result_full = reg - value - carry;
-    u8 result = static_cast<u8>(result_full);
-
-    set_flag_zero(result == 0);
-    set_flag_subtract(true);
-    set_flag_carry(result_full < 0);
-    set_flag_half_carry(((reg & 0xf) - (value & 0xf) - carry) < 0);
+    u8 carry = static_cast<u8>(registers.flag_carry());
+    u8 reg = registers.a;
 
-    a.set(result);
-}
-
-void CPU::opcode_sbc() {
-    _opcode_sbc(get_byte_from_pc());
-}
+    u8 result = static_cast<u8>(reg - value - carry);
 
-void CPU::opcode_sbc(ByteRegister& reg) {
-    _opcode_sbc(reg.value());
-}
+    registers.set_flags(FlagOperation::Sub, reg, value, carry);
 
-void CPU::opcode_sbc(Address&& addr) {
-    _opcode_sbc(mmu.read(addr));
+    registers.a = result;
 }
 
 
@@ -724,43 +345,17 @@ void CPU::opcode_scf() {
 }
 
 
-/* SET */
-void CPU::opcode_set(const u8 bit, ByteRegister& reg) {
-    u8 result = set_bit(reg.value(), bit);
-    reg.set(result);
-}
-
-void CPU::opcode_set(const u8 bit, Address&& addr) {
-    u8 value = mmu.read(addr);
-    u8 result = set_bit(value, bit);
-    mmu.write(addr, result);
-}
-
-
 /* SLA */
 u8 CPU::_opcode_sla(u8 value) {
     u8 carry_bit = check_bit(value, 7);
 
     u8 result = static_cast<u8>(value << 1);
 
-    set_flag_zero(result == 0);
-    set_flag_carry(carry_bit);
-    set_flag_half_carry(false);
-    set_flag_subtract(false);
+    registers.set_flags(FlagOperation::Shift, result, 0, carry_bit);
 
     return result;
 }
 
-void CPU::opcode_sla(ByteRegister& reg) {
-    u8 result = _opcode_sla(reg.value());
-    reg.set(result);
-}
-
-void CPU::opcode_sla(Address&& addr) {
-    u8 result = _opcode_sla(mmu.read(addr));
-    mmu.write(addr, result);
-}
-
 
 /* SRA */
 u8 CPU::_opcode_sra(u8 value) {
@@ -770,78 +365,37 @@ u8 CPU::_opcode_sra(u8 value) {
     u8 result = static_cast<u8>(value >> 1);
     result = bitwise::set_bit_to(result, 7, top_bit);
 
-    set_flag_zero(result == 0);
-    set_flag_carry(carry_bit);
-    set_flag_half_carry(false);
-    set_flag_subtract(false);
+    registers.set_flags(FlagOperation::Shift, result, 0, carry_bit);
 
     return result;
 }
 
-void CPU::opcode_sra(ByteRegister& reg) {
-    u8 result = _opcode_sra(reg.value());
-    reg.set(result);
-}
-
-void CPU::opcode_sra(Address&& addr) {
-    u8 result = _opcode_sra(mmu.read(addr));
-    mmu.write(addr, result);
-}
-
 
 /* SRL */
 u8 CPU::_opcode_srl(u8 value) {
     bool least_bit_set = check_bit(value, 0);
 
     u8 result = (value >> 1);
-    set_flag_carry(least_bit_set);
-    set_flag_zero(result == 0);
-    set_flag_half_carry(false);
-    set_flag_subtract(false);
+    registers.set_flags(FlagOperation::Shift, result, 0, least_bit_set);
 
     return result;
 }
 
-void CPU::opcode_srl(ByteRegister& reg) {
-    u8 result = _opcode_srl(reg.value());
-    reg.set(result);
-}
-
-void CPU::opcode_srl(Address&& addr) {
-    u8 result = _opcode_srl(mmu.read(addr));
-    mmu.write(addr, result);
-}
-
 
 /* STOP */
 void CPU::opcode_stop() {
-    /* halted = true; */
+    /* registers.halted = true; */
 }
 
 
 /* SUB */
 void CPU::_opcode_sub(u8 value) {
-    u8 reg = a.value();
+    u8 reg = registers.a;
     u8 result = static_cast<u8>(reg - value);
 
-    a.set(result);
-
-    set_flag_zero(a.value() == 0);
-    set_flag_subtract(true);
-    set_flag_half_carry(((reg & 0xf) - (value & 0xf)) < 0);
-    set_flag_carry(reg < value);
-}
+    registers.a = result;
 
-void CPU::opcode_sub() {
-    _opcode_sub(get_byte_from_pc());
-}
-
-void CPU::opcode_sub(ByteRegister& reg) {
-    _opcode_sub(reg.value());
-}
-
-void CPU::opcode_sub(Address&& addr) {
-    _opcode_sub(mmu.read(addr));
+    registers.set_flags(FlagOperation::Sub, reg, value, 0);
 }
 
 
@@ -854,47 +408,19 @@ u8 CPU::_opcode_swap(u8 value) {
 
     u8 result = compose_nibbles(lower_nibble, upper_nibble);
 
-    set_flag_zero(result == 0);
-    set_flag_subtract(false);
-    set_flag_half_carry(false);
-    set_flag_carry(false);
+    registers.set_flags(FlagOperation::Shift, result, 0, 0);
 
     return result;
 }
 
-void CPU::opcode_swap(ByteRegister& reg) {
-    u8 result = _opcode_swap(reg.value());
-    reg.set(result);
-}
-
-void CPU::opcode_swap(Address&& addr) {
-    u8 result = _opcode_swap(mmu.read(addr));
-    mmu.write(addr, result);
-}
-
 
 /* XOR */
 void CPU::_opcode_xor(u8 value) {
-    u8 reg = a.value();
+    u8 reg = registers.a;
 
     u8 result = reg ^ value;
 
-    set_flag_zero(result == 0);
-    set_flag_subtract(false);
-    set_flag_half_carry(false);
-    set_flag_carry(false);
-
-    a.set(result);
-}
-
-void CPU::opcode_xor() {
-    _opcode_xor(get_byte_from_pc());
-}
-
-void CPU::opcode_xor(const ByteRegister& reg) {
-    _opcode_xor(reg.value());
-}
+    registers.set_flags(FlagOperation::Or, result, 0, 0);
 
-void CPU::opcode_xor(const Address& addr) {
-    _opcode_xor(mmu.read(addr));
+    registers.a = result;
 }
@@ -0,0 +1,382 @@
+#include "profiler.h"
+
+#include "block_cache.h"
+#include "interrupt_controller.h"
+#include "opcode_names.h"
+#include "opcode_table.h"
+#include "../mmu.h"
+#include "../util/log.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <fstream>
+#include <sstream>
+
+using std::chrono::duration_cast;
+using std::chrono::steady_clock;
+
+/* Deeper than any sensible Gameboy code goes, but small enough that code which
+ * jumps out of routines rather than returning doesn't grow the stack forever */
+const std::size_t MAX_CALL_DEPTH = 128;
+
+/* The bottom of the call stack, which everything outside a called routine is
+ * charged to */
+const uint ROOT_ROUTINE = 0xFFFFFFFF;
+
+const uint BOOT_ROM_INDEX = 0x10000;
+const uint ROM_BANKS_INDEX = BOOT_ROM_INDEX + 0x100;
+
+/* The addresses listed in the report */
+const std::size_t REPORTED_ADDRESSES = 100;
+
+static const char* interrupt_names[] = { "VBlank", "LCDStat", "Timer", "Serial", "Joypad" };
+
+static uint key_bank(const uint key) { return key >> 16; }
+static u16 key_address(const uint key) { return static_cast<u16>(key); }
+
+static std::string location_of(const uint key) {
+    char location[16];
+
+    if (key_bank(key) == BOOT_ROM_BANK) {
+        snprintf(location, sizeof(location), "boot:%04X", key_address(key));
+    } else {
+        snprintf(location, sizeof(location), "%02X:%04X", key_bank(key), key_address(key));
+    }
+
+    return location;
+}
+
+static double percentage(const u64 part, const u64 whole) {
+    return whole == 0 ? 0.0 : 100.0 * static_cast<double>(part) / static_cast<double>(whole);
+}
+
+static double milliseconds(const std::chrono::nanoseconds time) {
+    return static_cast<double>(time.count()) / 1e6;
+}
+
+Profiler::Profiler(const MMU& inMMU, const std::string& inPath) :
+    mmu(inMMU),
+    path(inPath),
+    addresses(ROM_BANKS_INDEX),
+    started(steady_clock::now()),
+    last_charged(started)
+{
+    read_symbols(path + ".sym");
+}
+
+uint Profiler::key_of(const u16 address) const {
+    return block_key(code_bank(mmu, address), address);
+}
+
+ExecutionCounts& Profiler::address_counts(const uint key) {
+    uint bank = key_bank(key);
+    u16 address = key_address(key);
+
+    if (bank == 0) { return addresses[address]; }
+    if (bank == BOOT_ROM_BANK) { return addresses[BOOT_ROM_INDEX + address]; }
+    if (address < 0x4000) { return remapped_bank_0_addresses[key]; }
+
+    std::size_t index = ROM_BANKS_INDEX + bank * 0x4000 + (address - 0x4000);
+    if (index >= addresses.size()) { addresses.resize(index + 0x4000); }
+
+    return addresses[index];
+}
+
+void Profiler::instruction(const u16 address, const u8 opcode, const bool cb, const bool taken, const uint cycles, const u16 next_pc) {
+    if (frames.empty()) { enter(ROOT_ROUTINE); }
+
+    ExecutionCounts& opcode_counts = opcodes[cb ? 0x100u + opcode : opcode];
+    opcode_counts.count++;
+    opcode_counts.cycles += cycles;
+
+    ExecutionCounts& counts = address_counts(key_of(address));
+    counts.count++;
+    counts.cycles += cycles;
+
+    instructions++;
+    total_cycles += cycles;
+    *stack_cycles += cycles;
+    current_routine->self_cycles += cycles;
+
+    if (cb) { return; }
+
+    const OpcodeSpec& spec = opcode_specs[opcode];
+    bool always = spec.condition == Condition::Always;
+
+    switch (spec.operation) {
+        case Operation::CALL:
+            if (always || taken) { enter(key_of(next_pc)); }
+            return;
+        case Operation::RST:
+            enter(key_of(next_pc));
+            return;
+        case Operation::RET:
+        case Operation::RETI:
+            if (always || taken) { leave(); }
+            return;
+        default:
+            return;
+    }
+}
+
+void Profiler::interrupt(const u16 vector) {
+    if (frames.empty()) { enter(ROOT_ROUTINE); }
+
+    enter(key_of(vector));
+}
+
+void Profiler::enter(const uint routine) {
+    if (frames.size() >= MAX_CALL_DEPTH) {
+        untracked_calls++;
+        return;
+    }
+
+    charge_host_time();
+
+    routines[routine].calls++;
+    frames.push_back({routine, total_cycles});
+    stack_changed();
+}
+
+void Profiler::leave() {
+    if (untracked_calls > 0) {
+        untracked_calls--;
+        return;
+    }
+
+    /* Code which returns from the root (e.g. after dropping the return
+     * address) stays where it is */
+    if (frames.size() <= 1) { return; }
+
+    charge_host_time();
+
+    const Frame& frame = frames.back();
+    routines[frame.routine].total_cycles += total_cycles - frame.entry_cycles;
+    frames.pop_back();
+    stack_changed();
+}
+
+void Profiler::charge_host_time() {
+    auto now = steady_clock::now();
+
+    if (!frames.empty()) {
+        routines[frames.back().routine].host_time += duration_cast<std::chrono::nanoseconds>(now - last_charged);
+    }
+
+    last_charged = now;
+}
+
+void Profiler::stack_changed() {
+    std::vector<uint> stack;
+    stack.reserve(frames.size());
+
+    for (const Frame& frame : frames) {
+        stack.push_back(frame.routine);
+    }
+
+    stack_cycles = &stacks[stack];
+    current_routine = &routines[frames.back().routine];
+}
+
+void Profiler::read_symbols(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file) { return; }
+
+    /* Lines look like "01:4A3F Label", with comments starting with ';' */
+    std::string line;
+    while (std::getline(file, line)) {
+        line = line.substr(0, line.find(';'));
+
+        unsigned int bank;
+        unsigned int address;
+        char name[256];
+
+        if (sscanf(line.c_str(), "%x:%x %255s", &bank, &address, name) != 3) { continue; }
+        if (address > 0xFFFF) { continue; }
+
+        /* Only code in ROM is keyed by its bank */
+        if (address >= 0x8000) { bank = 0; }
+
+        symbols.emplace(block_key(bank, static_cast<u16>(address)), name);
+    }
+
+    log_info("Read %zu symbols from %s", symbols.size(), filename.c_str());
+}
+
+std::string Profiler::name_of(const uint key) const {
+    uint bank = key_bank(key);
+    u16 address = key_address(key);
+
+    /* The closest symbol before the address, as long as it's in the same
+     * bank and the same region of memory */
+    auto symbol = symbols.upper_bound(key);
+
+    if (symbol != symbols.begin()) {
+        --symbol;
+
+        if (key_bank(symbol->first) == bank && key_address(symbol->first) >> 14 == address >> 14) {
+            uint offset = key - symbol->first;
+
+            std::ostringstream name;
+            name << symbol->second;
+            if (offset != 0) { name << "+0x" << std::hex << std::uppercase << offset; }
+            return name.str();
+        }
+    }
+
+    return location_of(key);
+}
+
+std::string Profiler::routine_name(const uint routine) const {
+    if (routine == ROOT_ROUTINE) { return "(root)"; }
+    if (symbols.count(routine) != 0) { return symbols.at(routine); }
+
+    u16 address = key_address(routine);
+    uint vector = address - INTERRUPT_VECTOR_BASE;
+
+    if (key_bank(routine) == 0 && address >= INTERRUPT_VECTOR_BASE && vector % 8 == 0 && vector / 8 < 5) {
+        return std::string("interrupt:") + interrupt_names[vector / 8];
+    }
+
+    return name_of(routine);
+}
+
+void Profiler::write() {
+    charge_host_time();
+
+    /* Routines which are still running have been running up to now */
+    for (const Frame& frame : frames) {
+        routines[frame.routine].total_cycles += total_cycles - frame.entry_cycles;
+    }
+    frames.clear();
+
+    std::string report_filename = path + ".profile";
+    std::string folded_filename = path + ".folded";
+
+    FILE* report = fopen(report_filename.c_str(), "w");
+    FILE* folded = fopen(folded_filename.c_str(), "w");
+
+    if (report == nullptr || folded == nullptr) {
+        log_error("Unable to write the profile to %s and %s", report_filename.c_str(), folded_filename.c_str());
+        if (report != nullptr) { fclose(report); }
+        if (folded != nullptr) { fclose(folded); }
+        return;
+    }
+
+    write_report(report);
+    write_folded_stacks(folded);
+
+    fclose(report);
+    fclose(folded);
+
+    log_info("Wrote the profile to %s and %s", report_filename.c_str(), folded_filename.c_str());
+}
+
+void Profiler::write_report(FILE* file) {
+    auto host_time = duration_cast<std::chrono::nanoseconds>(steady_clock::now() - started);
+
+    fprintf(file, "%" PRIu64 " instructions, %" PRIu64 " cycles, %.1f ms of host time\n",
+        instructions, total_cycles, milliseconds(host_time));
+
+    /* Routines, by the host time spent in them (not including their callees) */
+    std::vector<std::pair<uint, RoutineCounts>> sorted_routines(routines.begin(), routines.end());
+    std::sort(sorted_routines.begin(), sorted_routines.end(),
+        [](const auto& a, const auto& b) { return a.second.host_time > b.second.host_time; });
+
+    fprintf(file, "\nRoutines, by host time\n");
+    fprintf(file, "%10s %7s %14s %7s %14s %10s  %s\n", "host ms", "%", "self cycles", "%", "total cycles", "calls", "routine");
+
+    for (const auto& routine : sorted_routines) {
+        const RoutineCounts& counts = routine.second;
+
+        fprintf(file, "%10.2f %6.2f%% %14" PRIu64 " %6.2f%% %14" PRIu64 " %10" PRIu64 "  %s\n",
+            milliseconds(counts.host_time), percentage(counts.host_time.count(), host_time.count()),
+            counts.self_cycles, percentage(counts.self_cycles, total_cycles),
+            counts.total_cycles, counts.calls, routine_name(routine.first).c_str());
+    }
+
+    fprintf(file, "\nInterrupts\n");
+    fprintf(file, "%10s %14s %7s  %s\n", "calls", "total cycles", "%", "interrupt");
+
+    for (uint interrupt = 0; interrupt < 5; interrupt++) {
+        auto routine = routines.find(INTERRUPT_VECTOR_BASE + interrupt * 8);
+        if (routine == routines.end()) { continue; }
+
+        fprintf(file, "%10" PRIu64 " %14" PRIu64 " %6.2f%%  %s\n",
+            routine->second.calls, routine->second.total_cycles,
+            percentage(routine->second.total_cycles, total_cycles), interrupt_names[interrupt]);
+    }
+
+    std::vector<std::pair<uint, ExecutionCounts>> sorted_opcodes;
+    for (uint opcode = 0; opcode < opcodes.size(); opcode++) {
+        if (opcodes[opcode].count != 0) { sorted_opcodes.emplace_back(opcode, opcodes[opcode]); }
+    }
+
+    std::sort(sorted_opcodes.begin(), sorted_opcodes.end(),
+        [](const auto& a, const auto& b) { return a.second.cycles > b.second.cycles; });
+
+    fprintf(file, "\nOpcodes, by cycles\n");
+    fprintf(file, "%14s %14s %7s  %s\n", "count", "cycles", "%", "opcode");
+
+    for (const auto& opcode : sorted_opcodes) {
+        bool cb = opcode.first >= 0x100;
+        u8 value = static_cast<u8>(opcode.first);
+
+        fprintf(file, "%14" PRIu64 " %14" PRIu64 " %6.2f%%  %s%02X %s\n",
+            opcode.second.count, opcode.second.cycles, percentage(opcode.second.cycles, total_cycles),
+            cb ? "CB " : "", value, cb ? opcode_cb_names[value].c_str() : opcode_names[value].c_str());
+    }
+
+    std::vector<std::pair<uint, ExecutionCounts>> sorted_addresses;
+
+    for (std::size_t index = 0; index < addresses.size(); index++) {
+        if (addresses[index].count == 0) { continue; }
+
+        uint key = index < BOOT_ROM_INDEX
+            ? static_cast<uint>(index)
+            : index < ROM_BANKS_INDEX
+                ? block_key(BOOT_ROM_BANK, static_cast<u16>(index - BOOT_ROM_INDEX))
+                : block_key(static_cast<uint>((index - ROM_BANKS_INDEX) / 0x4000), static_cast<u16>(0x4000 + (index - ROM_BANKS_INDEX) % 0x4000));
+
+        sorted_addresses.emplace_back(key, addresses[index]);
+    }
+
+    sorted_addresses.insert(sorted_addresses.end(), remapped_bank_0_addresses.begin(), remapped_bank_0_addresses.end());
+
+    std::sort(sorted_addresses.begin(), sorted_addresses.end(),
+        [](const auto& a, const auto& b) { return a.second.cycles > b.second.cycles; });
+
+    if (sorted_addresses.size() > REPORTED_ADDRESSES) {
+        sorted_addresses.resize(REPORTED_ADDRESSES);
+    }
+
+    fprintf(file, "\nAddresses, by cycles (the top %zu)\n", REPORTED_ADDRESSES);
+    fprintf(file, "%14s %14s %7s  %s\n", "count", "cycles", "%", "address");
+
+    for (const auto& address : sorted_addresses) {
+        std::string location = location_of(address.first);
+        std::string name = name_of(address.first);
+
+        fprintf(file, "%14" PRIu64 " %14" PRIu64 " %6.2f%%  %s",
+            address.second.count, address.second.cycles, percentage(address.second.cycles, total_cycles),
+            location.c_str());
+
+        if (name != location) { fprintf(file, "  %s", name.c_str()); }
+        fprintf(file, "\n");
+    }
+}
+
+void Profiler::write_folded_stacks(FILE* file) const {
+    for (const auto& stack : stacks) {
+        if (stack.second == 0) { continue; }
+
+        std::string line;
+
+        for (uint routine : stack.first) {
+            if (!line.empty()) { line += ';'; }
+            line += routine_name(routine);
+        }
+
+        fprintf(file, "%s %" PRIu64 "\n", line.c_str(), stack.second);
+    }
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "../definitions.h"
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+class MMU;
+
+/* Executions of an opcode or an address, and the cycles they took */
+struct ExecutionCounts {
+    u64 count = 0;
+    u64 cycles = 0;
+};
+
+/* A routine: the target of a CALL or RST, an interrupt vector, or the root
+ * of the call stack */
+struct RoutineCounts {
+    u64 calls = 0;
+    u64 self_cycles = 0;
+    u64 total_cycles = 0;
+    std::chrono::nanoseconds host_time = {};
+};
+
+/**
+ * Counts the instructions executed with --profile, in builds with
+ * GBEMU_PROFILE: per opcode, per address (and ROM bank) and per routine, with
+ * a call stack shadowed from CALL, RST, RET and interrupts. Routines are
+ * also charged with the host time spent in them, read whenever the stack
+ * changes, which shows where the interpreter itself spends its time.
+ *
+ * When the profile is written, <path>.profile gets a report sorted by cycles
+ * and host time, and <path>.folded the cycles spent in each call stack, as
+ * taken by flamegraph.pl and speedscope. Addresses are named from <path>.sym
+ * (as written by RGBDS) if there is one.
+ */
+class Profiler {
+public:
+    Profiler(const MMU& inMMU, const std::string& inPath);
+
+    /* Called after each instruction with the cycles it took, whether its
+     * condition held, and pc afterwards */
+    void instruction(u16 address, u8 opcode, bool cb, bool taken, uint cycles, u16 next_pc);
+
+    /* Called once pc has been set to an interrupt vector */
+    void interrupt(u16 vector);
+
+    void write();
+
+private:
+    struct Frame {
+        uint routine;
+        u64 entry_cycles;
+    };
+
+    uint key_of(u16 address) const;
+    ExecutionCounts& address_counts(uint key);
+
+    void enter(uint routine);
+    void leave();
+    void charge_host_time();
+    void stack_changed();
+
+    void read_symbols(const std::string& filename);
+    std::string name_of(uint key) const;
+    std::string routine_name(uint routine) const;
+
+    void write_report(FILE* file);
+    void write_folded_stacks(FILE* file) const;
+
+    const MMU& mmu;
+    const std::string path;
+
+    u64 instructions = 0;
+    u64 total_cycles = 0;
+
+    /* Normal opcodes, then CB-prefixed opcodes */
+    std::array<ExecutionCounts, 0x200> opcodes = {};
+
+    /* Unbanked addresses (including RAM) by address, then the boot ROM, then
+     * a block of 0x4000 for each ROM bank which is mapped at 0x4000-0x7FFF */
+    std::vector<ExecutionCounts> addresses;
+
+    /* Banks other than 0 which MBC1's mode 1 maps at 0x0000-0x3FFF. Rare
+     * enough not to need a block of their own. */
+    std::map<uint, ExecutionCounts> remapped_bank_0_addresses;
+
+    std::map<uint, RoutineCounts> routines;
+    std::map<std::vector<uint>, u64> stacks;
+
+    /* The shadowed call stack. Calls past MAX_CALL_DEPTH, e.g. from code
+     * which never returns normally, are only counted so that their returns
+     * can be skipped. */
+    std::vector<Frame> frames;
+    uint untracked_calls = 0;
+
+    /* Where the current stack's and routine's cycles are counted */
+    u64* stack_cycles = nullptr;
+    RoutineCounts* current_routine = nullptr;
+
+    std::chrono::steady_clock::time_point started;
+    std::chrono::steady_clock::time_point last_charged;
+
+    std::map<uint, std::string> symbols;
+};
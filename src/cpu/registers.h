@@ -0,0 +1,145 @@
+#pragma once
+
+#include "../definitions.h"
+
+#include <type_traits>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "The register file relies on a little-endian host to overlay register pairs"
+#endif
+
+/* The kinds of operation whose flags can be evaluated lazily, from the operands
+ * they were given:
+ *  Add, Sub     - lhs +/- rhs +/- carry (ADD, ADC, SUB, SBC, CP)
+ *  And, Or      - lhs is the result (AND; OR and XOR)
+ *  Inc, Dec     - lhs is the result, carry is the preserved carry flag
+ *  Shift        - lhs is the result, carry is the bit shifted out
+ * None means that 'f' holds the flags. */
+enum class FlagOperation : u8 {
+    None,
+    Add,
+    Sub,
+    And,
+    Or,
+    Inc,
+    Dec,
+    Shift,
+};
+
+/* Builds the value of 'f' produced by an operation. Shared by the eager and
+ * lazy paths so that they can't disagree. */
+inline u8 evaluate_flags(FlagOperation operation, u8 lhs, u8 rhs, u8 carry, u8 f) {
+    auto zero = [](uint result) { return static_cast<u8>((result & 0xFF) == 0 ? 0x80 : 0x00); };
+
+    switch (operation) {
+        case FlagOperation::None:
+            return f;
+
+        case FlagOperation::Add: {
+            uint result = lhs + rhs + carry;
+            bool half_carry = (lhs & 0xF) + (rhs & 0xF) + carry > 0xF;
+            return static_cast<u8>(zero(result) | (half_carry ? 0x20 : 0) | (result > 0xFF ? 0x10 : 0));
+        }
+
+        case FlagOperation::Sub: {
+            int result = lhs - rhs - carry;
+            bool half_carry = (lhs & 0xF) - (rhs & 0xF) - carry < 0;
+            return static_cast<u8>(zero(static_cast<uint>(result)) | 0x40 | (half_carry ? 0x20 : 0) | (result < 0 ? 0x10 : 0));
+        }
+
+        case FlagOperation::And:
+            return static_cast<u8>(zero(lhs) | 0x20);
+
+        case FlagOperation::Or:
+            return zero(lhs);
+
+        case FlagOperation::Inc:
+            return static_cast<u8>(zero(lhs) | ((lhs & 0x0F) == 0x00 ? 0x20 : 0) | (carry ? 0x10 : 0));
+
+        case FlagOperation::Dec:
+            return static_cast<u8>(zero(lhs) | 0x40 | ((lhs & 0x0F) == 0x0F ? 0x20 : 0) | (carry ? 0x10 : 0));
+
+        case FlagOperation::Shift:
+            return static_cast<u8>(zero(lhs) | (carry ? 0x10 : 0));
+    }
+
+    return f;
+}
+
+/**
+ * The CPU's registers and execution state as plain data.
+ *
+ * Each pair of 8-bit registers shares storage with the 16-bit register they
+ * form (the low byte comes first on a little-endian host), so e.g. 'hl' and
+ * 'h'/'l' are always in sync without any copying. The whole state fits in a
+ * cache line and can be copied with memcpy for snapshots and comparisons.
+ */
+struct Registers {
+    /* clang-format off */
+    union { u16 af; __extension__ struct { u8 f; u8 a; }; };
+    union { u16 bc; __extension__ struct { u8 c; u8 b; }; };
+    union { u16 de; __extension__ struct { u8 e; u8 d; }; };
+    union { u16 hl; __extension__ struct { u8 l; u8 h; }; };
+    /* clang-format on */
+
+    /* Stack pointer */
+    u16 sp;
+
+    /* Program counter */
+    u16 pc;
+
+    /* Interrupt master enable */
+    bool interrupts_enabled;
+
+    bool halted;
+
+    /* With GBEMU_LAZY_FLAGS, the last flag-setting operation and its operands.
+     * 'f' is only brought up to date when the flags are read. */
+    FlagOperation flag_operation;
+    u8 flag_lhs;
+    u8 flag_rhs;
+    u8 flag_carry_in;
+
+    /*
+     * Flags set dependant on the result of the last operation
+     *  0x80 - produced 0
+     *  0x40 - was a subtraction
+     *  0x20 - lower half of the byte overflowed 15
+     *  0x10 - overflowed 255 or underflowed 0 for additions/subtractions
+     *
+     * The lower nibble of 'f' is always 0s.
+     */
+    u8 flags() const { return evaluate_flags(flag_operation, flag_lhs, flag_rhs, flag_carry_in, f); }
+
+    bool flag_zero() const { return (flags() & 0x80) != 0; }
+    bool flag_subtract() const { return (flags() & 0x40) != 0; }
+    bool flag_half_carry() const { return (flags() & 0x20) != 0; }
+    bool flag_carry() const { return (flags() & 0x10) != 0; }
+
+    void set_flags(FlagOperation operation, u8 lhs, u8 rhs, u8 carry) {
+#ifdef GBEMU_LAZY_FLAGS
+        flag_operation = operation;
+        flag_lhs = lhs;
+        flag_rhs = rhs;
+        flag_carry_in = carry;
+#else
+        f = evaluate_flags(operation, lhs, rhs, carry, f);
+#endif
+    }
+
+    void set_flag(u8 flag, bool set) {
+        u8 current = flags();
+        flag_operation = FlagOperation::None;
+        f = static_cast<u8>(set ? (current | flag) : (current & ~flag));
+    }
+
+    u16 af_value() const { return static_cast<u16>((a << 8) | flags()); }
+
+    void set_af(u16 value) {
+        flag_operation = FlagOperation::None;
+        af = value & 0xFFF0;
+    }
+};
+
+static_assert(std::is_trivially_copyable<Registers>::value, "Registers must be trivially copyable");
+static_assert(sizeof(Registers) <= 64, "Registers should fit in a single cache line");
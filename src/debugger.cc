@@ -26,7 +26,7 @@ void Debugger::cycle() {
     steps++;
 
     if (breakpoint_addr != 0 && !debugger_enabled) {
-        if (gameboy.cpu.pc.value() != breakpoint_addr) { return; }
+        if (gameboy.cpu.registers.pc != breakpoint_addr) { return; }
         debugger_enabled = true;
     }
 
@@ -71,6 +71,7 @@ bool Debugger::execute(Command command) {
         case CommandType::Flags: command_flags(command.args); break;
         case CommandType::Memory: command_memory(command.args); break;
         case CommandType::MemoryCell: command_memory_cell(command.args); break;
+        case CommandType::Accesses: command_accesses(command.args); break;
         case CommandType::Steps: command_steps(command.args); break;
         case CommandType::Log: command_log(command.args); break;
         case CommandType::Exit: command_exit(command.args); break;
@@ -119,21 +120,21 @@ bool Debugger::command_step(Args args) {
 void Debugger::command_registers(Args args) {
     unused(args);
 
-    printf("AF: %04X\n", gameboy.cpu.af.value());
-    printf("BC: %04X\n", gameboy.cpu.bc.value());
-    printf("DE: %04X\n", gameboy.cpu.de.value());
-    printf("HL: %04X\n", gameboy.cpu.hl.value());
-    printf("SP: %04X\n", gameboy.cpu.sp.value());
-    printf("PC: %04X\n", gameboy.cpu.pc.value());
+    printf("AF: %04X\n", gameboy.cpu.registers.af_value());
+    printf("BC: %04X\n", gameboy.cpu.registers.bc);
+    printf("DE: %04X\n", gameboy.cpu.registers.de);
+    printf("HL: %04X\n", gameboy.cpu.registers.hl);
+    printf("SP: %04X\n", gameboy.cpu.registers.sp);
+    printf("PC: %04X\n", gameboy.cpu.registers.pc);
 }
 
 void Debugger::command_flags(Args args) {
     unused(args);
 
-    printf("Zero: %d\n", gameboy.cpu.f.flag_zero_value());
-    printf("Subtract: %d\n", gameboy.cpu.f.flag_subtract_value());
-    printf("Half Carry: %d\n", gameboy.cpu.f.flag_half_carry_value());
-    printf("Carry: %d\n", gameboy.cpu.f.flag_carry_value());
+    printf("Zero: %d\n", gameboy.cpu.registers.flag_zero());
+    printf("Subtract: %d\n", gameboy.cpu.registers.flag_subtract());
+    printf("Half Carry: %d\n", gameboy.cpu.registers.flag_half_carry());
+    printf("Carry: %d\n", gameboy.cpu.registers.flag_carry());
 }
 
 void Debugger::command_memory(Args args) {
@@ -180,6 +181,20 @@ void Debugger::command_memory_cell(Args args) {
     return;
 }
 
+void Debugger::command_accesses(Args args) {
+    if (args.size() > 1 || (args.size() == 1 && args[0] != "reset")) {
+        log_error("Invalid arguments to command");
+        return;
+    }
+
+    if (args.size() == 1) {
+        gameboy.mmu.reset_access_counters();
+        return;
+    }
+
+    gameboy.mmu.access_counters().write(stdout);
+}
+
 void Debugger::command_breakaddr(Args args) {
     if (args.size() != 1) {
         log_error("Invalid arguments to command");
@@ -258,6 +273,7 @@ void Debugger::command_help(Args args) {
     printf("flags                  Print a dump of the CPU flags\n");
     printf("[mem]ory $start $lines Print a dump of memory from $start to $end\n");
     printf("[addr]ess $addr        Print the value of the memory at $addr\n");
+    printf("accesses [reset]       Print (or reset) the counts of IO and unusual accesses\n");
     printf("\n");
     printf("= Other\n");
     printf("steps                  Print the number of steps so far\n");
@@ -267,6 +283,7 @@ void Debugger::command_help(Args args) {
 }
 
 Command Debugger::get_command() {
+    log_flush();
     printf("%s", PROMPT);
     std::string input_line;
     std::getline(std::cin, input_line);
@@ -305,6 +322,7 @@ CommandType Debugger::parse_command(std::string cmd) {
     if (cmd == "flags") return CommandType::Flags;
     if (cmd == "memory" || cmd == "mem") return CommandType::Memory;
     if (cmd == "address" || cmd == "addr") return CommandType::MemoryCell;
+    if (cmd == "accesses") return CommandType::Accesses;
     if (cmd == "steps") return CommandType::Steps;
 
     if (cmd == "log") return CommandType::Log;
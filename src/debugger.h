@@ -22,6 +22,7 @@ enum class CommandType {
     Flags,
     Memory,
     MemoryCell,
+    Accesses,
     Steps,
 
     Log,
@@ -44,6 +45,7 @@ public:
     Debugger(Gameboy& inGameboy, Options& inOptions);
 
     void set_enabled(bool enabled);
+    bool is_enabled() const { return enabled; }
     void cycle();
 
 private:
@@ -63,6 +65,7 @@ private:
     void command_flags(Args args);
     void command_memory(Args args);
     void command_memory_cell(Args args);
+    void command_accesses(Args args);
 
     void command_breakaddr(Args args);
     void command_breakvalue(Args args);
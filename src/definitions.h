@@ -7,6 +7,7 @@ using uint = unsigned int;
 
 using u8 = uint8_t;
 using u16 = uint16_t;
+using u64 = uint64_t;
 using s8 = int8_t;
 using s16 = uint16_t;
 
@@ -0,0 +1,161 @@
+#include "frame_timing.h"
+
+#include "util/log.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+
+using std::chrono::duration_cast;
+using std::chrono::nanoseconds;
+
+const char* subsystem_name(const Subsystem subsystem) {
+    switch (subsystem) {
+        case Subsystem::Cpu: return "CPU";
+        case Subsystem::Video: return "Video";
+        case Subsystem::Timer: return "Timer";
+        case Subsystem::Serial: return "Serial";
+        case Subsystem::Debugger: return "Debugger";
+        case Subsystem::VblankCallback: return "Vblank callback";
+        case Subsystem::Present: return "Present";
+    }
+
+    return "Unknown";
+}
+
+FrameTiming::FrameTiming(const std::string& inTraceFilename) :
+    trace_filename(inTraceFilename)
+{
+    set_enabled(!trace_filename.empty());
+}
+
+FrameTiming::~FrameTiming() {
+    if (!trace_filename.empty()) {
+        write_chrome_trace(trace_filename);
+    }
+}
+
+void FrameTiming::set_enabled(const bool enable) {
+    if (enable && !enabled) {
+        auto now = clock::now();
+
+        if (recorded.load(std::memory_order_relaxed) == 0) { started = now; }
+
+        last_switch = now;
+        frame_started = now;
+        frame_time = {};
+    }
+
+    enabled = enable;
+}
+
+void FrameTiming::charge() {
+    auto now = clock::now();
+    frame_time[static_cast<uint>(current)] += static_cast<u64>(duration_cast<nanoseconds>(now - last_switch).count());
+    last_switch = now;
+}
+
+void FrameTiming::end_frame() {
+    if (!enabled) { return; }
+
+    charge();
+
+    u64 frame = recorded.load(std::memory_order_relaxed);
+
+    FrameRecord record;
+    record.frame = frame;
+    record.start = static_cast<u64>(duration_cast<nanoseconds>(frame_started - started).count());
+    record.duration = static_cast<u64>(duration_cast<nanoseconds>(last_switch - frame_started).count());
+    record.time = frame_time;
+
+    Slot& slot = ring[frame % RING_SIZE];
+    slot.sequence.store(2 * frame + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.fields[0].store(record.frame, std::memory_order_relaxed);
+    slot.fields[1].store(record.start, std::memory_order_relaxed);
+    slot.fields[2].store(record.duration, std::memory_order_relaxed);
+    for (uint i = 0; i < SUBSYSTEM_COUNT; i++) {
+        slot.fields[3 + i].store(record.time[i], std::memory_order_relaxed);
+    }
+
+    slot.sequence.store(2 * frame + 2, std::memory_order_release);
+    recorded.store(frame + 1, std::memory_order_release);
+
+    if (!trace_filename.empty()) { history.push_back(record); }
+
+    frame_started = last_switch;
+    frame_time = {};
+}
+
+u64 FrameTiming::frames() const {
+    return recorded.load(std::memory_order_acquire);
+}
+
+bool FrameTiming::read_frame(const u64 frame, FrameRecord& record) const {
+    const Slot& slot = ring[frame % RING_SIZE];
+
+    u64 sequence = slot.sequence.load(std::memory_order_acquire);
+    if (sequence != 2 * frame + 2) { return false; }
+
+    record.frame = slot.fields[0].load(std::memory_order_relaxed);
+    record.start = slot.fields[1].load(std::memory_order_relaxed);
+    record.duration = slot.fields[2].load(std::memory_order_relaxed);
+    for (uint i = 0; i < SUBSYSTEM_COUNT; i++) {
+        record.time[i] = slot.fields[3 + i].load(std::memory_order_relaxed);
+    }
+
+    /* The writer may have started on the slot again while it was copied */
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.sequence.load(std::memory_order_relaxed) == sequence;
+}
+
+std::vector<FrameRecord> FrameTiming::recent_frames(const uint count) const {
+    u64 end = frames();
+    u64 available = std::min<u64>({end, count, RING_SIZE});
+
+    std::vector<FrameRecord> records;
+    records.reserve(available);
+
+    for (u64 frame = end - available; frame < end; frame++) {
+        FrameRecord record;
+        if (read_frame(frame, record)) { records.push_back(record); }
+    }
+
+    return records;
+}
+
+void FrameTiming::write_chrome_trace(const std::string& filename) const {
+    FILE* file = fopen(filename.c_str(), "w");
+    if (file == nullptr) {
+        log_error("Unable to write the frame trace to %s", filename.c_str());
+        return;
+    }
+
+    /* Each frame is an event on the first track, and is broken down into its
+     * subsystems, laid end to end, on the second. Timestamps are in us. */
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"Frames\"}},\n");
+    fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"Subsystems\"}}");
+
+    for (const FrameRecord& record : history) {
+        fprintf(file, ",\n{\"name\":\"Frame %" PRIu64 "\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+            record.frame, record.start / 1000.0, record.duration / 1000.0);
+
+        u64 offset = record.start;
+
+        for (uint i = 0; i < SUBSYSTEM_COUNT; i++) {
+            if (record.time[i] == 0) { continue; }
+
+            fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":2,\"ts\":%.3f,\"dur\":%.3f}",
+                subsystem_name(static_cast<Subsystem>(i)), offset / 1000.0, record.time[i] / 1000.0);
+
+            offset += record.time[i];
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+    fclose(file);
+
+    log_info("Wrote %zu frames of timings to %s", history.size(), filename.c_str());
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "definitions.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+/* The parts of the emulator which host time is charged to */
+enum class Subsystem {
+    Cpu,
+    Video,
+    Timer,
+    Serial,
+    Debugger,
+    VblankCallback,
+    Present,
+};
+
+const uint SUBSYSTEM_COUNT = 7;
+
+const char* subsystem_name(Subsystem subsystem);
+
+/* The host time taken by one emulated frame, in nanoseconds. 'start' is
+ * measured from when timing was turned on. */
+struct FrameRecord {
+    u64 frame;
+    u64 start;
+    u64 duration;
+    std::array<u64, SUBSYSTEM_COUNT> time;
+};
+
+/**
+ * Measures where the host's time goes each frame. The Gameboy switches to
+ * a subsystem as it hands over to it, and the time since the last switch is
+ * charged to the subsystem which was running, so the clock is only read at
+ * those switches. Frames end after the vblank callback returns.
+ *
+ * The most recent frames are kept in a ring which can be read from another
+ * thread (e.g. by a frontend drawing an overlay) without locking. Each slot
+ * carries a sequence number which is odd while the slot is being written,
+ * and readers discard anything which changed while they copied it.
+ *
+ * Given a filename, every frame is also kept and written out as Chrome trace
+ * events (for chrome://tracing or Perfetto) when the emulator exits.
+ */
+class FrameTiming {
+public:
+    static const uint RING_SIZE = 256;
+
+    FrameTiming(const std::string& inTraceFilename);
+    ~FrameTiming();
+
+    void set_enabled(bool enable);
+    bool is_enabled() const { return enabled; }
+
+    void switch_to(Subsystem subsystem) {
+        if (!enabled) { return; }
+
+        charge();
+        current = subsystem;
+    }
+
+    void end_frame();
+
+    /* The number of frames recorded so far */
+    u64 frames() const;
+
+    /* Copies a recorded frame. Fails if it's no longer in the ring. */
+    bool read_frame(u64 frame, FrameRecord& record) const;
+
+    /* Up to 'count' of the most recent frames, oldest first */
+    std::vector<FrameRecord> recent_frames(uint count) const;
+
+    void write_chrome_trace(const std::string& filename) const;
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    void charge();
+
+    bool enabled = false;
+    Subsystem current = Subsystem::Cpu;
+
+    clock::time_point started;
+    clock::time_point last_switch;
+    clock::time_point frame_started;
+    std::array<u64, SUBSYSTEM_COUNT> frame_time = {};
+
+    /* A FrameRecord, field by field */
+    static const uint RECORD_FIELDS = 3 + SUBSYSTEM_COUNT;
+
+    struct Slot {
+        std::atomic<u64> sequence{0};
+        std::array<std::atomic<u64>, RECORD_FIELDS> fields;
+    };
+
+    /* Only written by the emulator's thread */
+    std::array<Slot, RING_SIZE> ring;
+    std::atomic<u64> recorded{0};
+
+    std::string trace_filename;
+    std::vector<FrameRecord> history;
+};
@@ -1,12 +1,15 @@
 #include "gameboy.h"
 
-Gameboy::Gameboy(std::vector<u8> cartridge_data, Options& options, std::vector<u8> save_data) :
-    cartridge(get_cartridge(std::move(cartridge_data), std::move(save_data))),
-    cpu(mmu, options),
-    video(cpu, mmu, options),
-    serial(options),
-    mmu(cartridge, cpu, video, input, serial, timer, options),
-    debugger(*this, options)
+Gameboy::Gameboy(std::shared_ptr<const RomImage> rom, Options& options, std::vector<u8> save_data) :
+    cartridge(get_cartridge(std::move(rom), std::move(save_data))),
+    input(io),
+    cpu(mmu, scheduler, options),
+    video(cpu, mmu, io, scheduler, options),
+    serial(cpu, io, scheduler, options),
+    mmu(cartridge, cpu, io, timer, scheduler, options),
+    timer(cpu, io, scheduler),
+    debugger(*this, options),
+    timing(options.frame_trace)
 {
     if (options.disable_logs) log_set_level(LogLevel::Error);
 
@@ -14,6 +17,42 @@ Gameboy::Gameboy(std::vector<u8> cartridge_data, Options& options, std::vector<u
         ? LogLevel::Trace
         : LogLevel::Info
     );
+
+    if (options.skip_boot) {
+        skip_boot_rom();
+    }
+
+    if (options.aot) {
+        cpu.use_translation(aot::find_program(cartridge->get_rom()));
+    }
+}
+
+void Gameboy::skip_boot_rom() {
+    /* The IO registers as the DMG boot ROM leaves them (per Pan Docs) */
+    static const std::pair<u16, u8> post_boot_io[] = {
+        {0xFF05, 0x00}, {0xFF06, 0x00}, {0xFF07, 0x00},
+        {0xFF10, 0x80}, {0xFF11, 0xBF}, {0xFF12, 0xF3}, {0xFF14, 0xBF},
+        {0xFF16, 0x3F}, {0xFF17, 0x00}, {0xFF19, 0xBF},
+        {0xFF1A, 0x7F}, {0xFF1B, 0xFF}, {0xFF1C, 0x9F}, {0xFF1E, 0xBF},
+        {0xFF20, 0xFF}, {0xFF21, 0x00}, {0xFF22, 0x00}, {0xFF23, 0xBF},
+        {0xFF24, 0x77}, {0xFF25, 0xF3}, {0xFF26, 0xF1},
+        {0xFF40, 0x91}, {0xFF42, 0x00}, {0xFF43, 0x00}, {0xFF45, 0x00},
+        {0xFF47, 0xFC}, {0xFF48, 0xFF}, {0xFF49, 0xFF},
+        {0xFF4A, 0x00}, {0xFF4B, 0x00},
+        {0xFF0F, 0xE1}, {0xFFFF, 0x00},
+    };
+
+    for (const auto& io_register : post_boot_io) {
+        mmu.write(io_register.first, io_register.second);
+    }
+
+    /* Unmaps the boot ROM */
+    mmu.write(0xFF50, 0x1);
+
+    cpu.set_post_boot_registers();
+
+    /* Setting up the registers shouldn't count towards what the game does */
+    mmu.reset_access_counters();
 }
 
 void Gameboy::button_pressed(GbButton button) {
@@ -42,7 +81,12 @@ void Gameboy::run(
 ) {
     should_close_callback = _should_close_callback;
 
-    video.register_vblank_callback(_vblank_callback);
+    video.register_vblank_callback([this, _vblank_callback](const FrameBuffer& buffer) {
+        timing.switch_to(Subsystem::VblankCallback);
+        _vblank_callback(buffer);
+        timing.end_frame();
+        timing.switch_to(Subsystem::Video);
+    });
 
     while (!should_close_callback()) {
         tick();
@@ -52,13 +96,87 @@ void Gameboy::run(
 }
 
 void Gameboy::tick() {
-    debugger.cycle();
+    /* Nothing outside the CPU changes until the next event is due, so the CPU
+     * runs until then without stopping */
+    timing.switch_to(Subsystem::Cpu);
+
+    while (scheduler.now() < scheduler.next_deadline()) {
+        execute();
+    }
+
+    handle_due_events();
+}
+
+void Gameboy::step() {
+    execute();
+
+    if (scheduler.now() >= scheduler.next_deadline()) {
+        handle_due_events();
+    }
+}
 
-    auto cycles = cpu.tick();
-    elapsed_cycles += cycles.cycles;
+void Gameboy::execute() {
+    if (debugger.is_enabled()) {
+        timing.switch_to(Subsystem::Debugger);
+        debugger.cycle();
+        timing.switch_to(Subsystem::Cpu);
+    }
+
+    auto cycles = cpu.tick().cycles;
+
+    /* A halted CPU does nothing until an interrupt, which can only be
+     * raised by an event, so rather than idling one cycle per tick skip
+     * straight to the next one. */
+    if (cpu.is_halted()) {
+        uint idle_cycles = scheduler.cycles_until_next_event();
+        if (idle_cycles > cycles) { cycles = idle_cycles; }
+    }
+
+    /* Likewise, a loop which will repeat unchanged until an event can
+     * skip as many whole iterations as fit before it */
+    uint loop_cycles = cpu.idle_loop_cycles();
+    if (loop_cycles > 0) {
+        uint remaining = scheduler.cycles_until_next_event();
+        if (remaining > cycles) {
+            cycles += (remaining - cycles) / loop_cycles * loop_cycles;
+        }
+    }
+
+    scheduler.advance(cycles);
+}
+
+void Gameboy::handle_due_events() {
+    Event event;
+    while (scheduler.pop_due(event)) {
+        timing.switch_to(event_subsystem(event));
+        handle_event(event);
+    }
+
+    cpu.events_handled();
+}
+
+void Gameboy::handle_event(const Event event) {
+    switch (event) {
+        case Event::VideoMode: video.advance_mode(); break;
+        case Event::TimerOverflow: timer.overflow(); break;
+        case Event::SerialTransfer: serial.transfer_complete(); break;
+        case Event::OamDma: mmu.oam_dma().finish(); break;
+    }
+}
+
+Subsystem Gameboy::event_subsystem(const Event event) {
+    switch (event) {
+        case Event::VideoMode: return Subsystem::Video;
+        case Event::TimerOverflow: return Subsystem::Timer;
+        case Event::SerialTransfer: return Subsystem::Serial;
+        case Event::OamDma: return Subsystem::Video;
+    }
+
+    return Subsystem::Cpu;
+}
 
-    video.tick(cycles);
-    timer.tick(cycles.cycles);
+FrameTiming& Gameboy::frame_timing() {
+    return timing;
 }
 
 const std::vector<u8>& Gameboy::get_cartridge_ram() const {
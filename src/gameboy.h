@@ -1,12 +1,15 @@
 #pragma once
 
 #include "debugger.h"
+#include "frame_timing.h"
 #include "input.h"
+#include "io_bus.h"
 #include "cpu/cpu.h"
 #include "video/video.h"
 #include "serial.h"
 #include "timer.h"
 #include "options.h"
+#include "scheduler.h"
 #include "util/log.h"
 
 #include <memory>
@@ -17,7 +20,7 @@ typedef std::function<bool(void)> should_close_callback_t;
 class Gameboy {
 public:
     Gameboy(
-        std::vector<u8> cartridge_data,
+        std::shared_ptr<const RomImage> rom,
         Options& options,
         std::vector<u8> save_data = {}
     );
@@ -27,6 +30,11 @@ public:
         const vblank_callback_t& _vblank_callback
     );
 
+    /* Runs a single CPU tick (one instruction, unless the CPU chains through
+     * a block) and any events which become due. Used by the lockstep harness
+     * to follow another instance's progress; run() goes through tick(). */
+    void step();
+
     void button_pressed(GbButton button);
     void button_released(GbButton button);
 
@@ -36,10 +44,25 @@ public:
 
     const std::vector<u8>& get_cartridge_ram() const;
 
+    /* Host time per frame, broken down by subsystem. Frontends switch to
+     * Subsystem::Present while they present a frame from the vblank
+     * callback. */
+    FrameTiming& frame_timing();
+
 private:
     void tick();
+    void execute();
+    void handle_due_events();
+    void handle_event(Event event);
+    static Subsystem event_subsystem(Event event);
+
+    /* Starts from the state the boot ROM leaves, rather than running it */
+    void skip_boot_rom();
+
+    Scheduler scheduler;
 
     std::shared_ptr<Cartridge> cartridge;
+    IoBus io;
     Input input;
     CPU cpu;
     Video video;
@@ -49,9 +72,11 @@ private:
 
     Debugger debugger;
 
-    friend class Debugger;
+    FrameTiming timing;
 
-    uint elapsed_cycles = 0;
+    friend class Debugger;
+    friend class FlagCheck;
+    friend class Lockstep;
 
     should_close_callback_t should_close_callback;
 };
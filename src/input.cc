@@ -2,6 +2,11 @@
 
 #include "util/bitwise.h"
 
+Input::Input(IoBus& io) {
+    /* Only the two select lines are writable */
+    io.map_handlers(0xFF00, [this]() { return get_input(); }, [this](u8 byte) { write(byte); }, 0x3F, 0x30);
+}
+
 void Input::button_pressed(GbButton button) {
     set_button(button, true);
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "definitions.h"
+#include "io_bus.h"
 
 enum class GbButton {
     Up,
@@ -15,6 +16,8 @@ enum class GbButton {
 
 class Input {
 public:
+    Input(IoBus& io);
+
     void button_pressed(GbButton button);
     void button_released(GbButton button);
     void write(u8 set);
@@ -0,0 +1,40 @@
+#include "io_bus.h"
+
+#include "util/log.h"
+
+IoRegister& IoBus::claim(const u16 address) {
+    if (address < BASE || address >= BASE + REGISTER_COUNT) {
+        fatal_error("0x%04X is not an IO register", address);
+    }
+
+    IoRegister& reg = registers[address - BASE];
+    if (reg.mapped) {
+        fatal_error("IO register 0x%04X was mapped twice", address);
+    }
+
+    reg.mapped = true;
+    return reg;
+}
+
+void IoBus::map_storage(const u16 address, const u8 initial_value, const u8 read_mask, const u8 write_mask) {
+    IoRegister& reg = claim(address);
+    reg.value = initial_value;
+    reg.read_mask = read_mask;
+    reg.write_mask = write_mask;
+}
+
+void IoBus::map_handlers(const u16 address, io_read_handler_t read, io_write_handler_t write, const u8 read_mask, const u8 write_mask) {
+    IoRegister& reg = claim(address);
+    reg.read = std::move(read);
+    reg.write = std::move(write);
+    reg.read_mask = read_mask;
+    reg.write_mask = write_mask;
+    reg.side_effects = true;
+}
+
+void IoBus::map_unimplemented(const u16 address, const u8 value) {
+    IoRegister& reg = claim(address);
+    reg.value = value;
+    reg.write_mask = 0x00;
+    reg.implemented = false;
+}
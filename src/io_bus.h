@@ -0,0 +1,85 @@
+#pragma once
+
+#include "definitions.h"
+
+#include <array>
+#include <functional>
+
+using io_read_handler_t = std::function<u8(void)>;
+using io_write_handler_t = std::function<void(u8)>;
+
+/* One of the registers at 0xFF00-0xFF7F */
+struct IoRegister {
+    io_read_handler_t read;
+    io_write_handler_t write;
+
+    /* The last value written, which is what reads return unless the register
+     * has a read handler */
+    u8 value = 0xFF;
+
+    /* Bits outside the read mask always read as 1; bits outside the write
+     * mask keep their value when written, and a write handler is passed the
+     * register's current value in those bits rather than what was written */
+    u8 read_mask = 0xFF;
+    u8 write_mask = 0xFF;
+
+    /* Whether reading or writing has to call a handler. Plain storage
+     * registers are read and written in place. */
+    bool side_effects = false;
+
+    bool mapped = false;
+    bool implemented = true;
+};
+
+/**
+ * The IO registers, as a table indexed by the low bits of the address. Each
+ * component maps the registers it owns when it's constructed, either as plain
+ * storage or with handlers for the registers which do something when they're
+ * accessed. Registers nobody maps are unknown, and accessing them is an error.
+ */
+class IoBus : Noncopyable {
+public:
+    static const u16 BASE = 0xFF00;
+    static const uint REGISTER_COUNT = 0x80;
+
+    void map_storage(u16 address, u8 initial_value = 0x0, u8 read_mask = 0xFF, u8 write_mask = 0xFF);
+
+    /* Either handler may be empty: reads then return the stored value, and
+     * writes only store it */
+    void map_handlers(u16 address, io_read_handler_t read, io_write_handler_t write, u8 read_mask = 0xFF, u8 write_mask = 0xFF);
+
+    /* Registers which the emulator doesn't implement (yet): writes are
+     * ignored and reads return 'value' */
+    void map_unimplemented(u16 address, u8 value = 0xFF);
+
+    const IoRegister& at(u16 address) const {
+        return registers[address & (REGISTER_COUNT - 1)];
+    }
+
+    u8 read(u16 address) const {
+        const IoRegister& reg = at(address);
+
+        u8 value = (reg.side_effects && reg.read) ? reg.read() : reg.value;
+        return static_cast<u8>(value | ~reg.read_mask);
+    }
+
+    void write(u16 address, u8 byte) {
+        IoRegister& reg = registers[address & (REGISTER_COUNT - 1)];
+
+        reg.value = static_cast<u8>((reg.value & ~reg.write_mask) | (byte & reg.write_mask));
+
+        if (!reg.side_effects || !reg.write) { return; }
+
+        if (reg.write_mask != 0xFF) {
+            u8 current = reg.read ? reg.read() : reg.value;
+            byte = static_cast<u8>((current & ~reg.write_mask) | (byte & reg.write_mask));
+        }
+
+        reg.write(byte);
+    }
+
+private:
+    IoRegister& claim(u16 address);
+
+    std::array<IoRegister, REGISTER_COUNT> registers;
+};
@@ -0,0 +1,342 @@
+#include "lockstep.h"
+
+#include "cartridge/cartridge.h"
+#include "cpu/opcode_names.h"
+
+#include <cinttypes>
+#include <cstring>
+
+/* The longest run of reference instructions kept for a report */
+const std::size_t MAX_TRACED_INSTRUCTIONS = 64;
+
+/* 64-bit FNV-1a, over each part of the state in turn */
+class StateHasher {
+public:
+    void add(const void* data, std::size_t size) {
+        auto bytes = static_cast<const u8*>(data);
+
+        for (std::size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= 0x100000001B3;
+        }
+    }
+
+    template <typename T> void add_value(const T value) { add(&value, sizeof(T)); }
+
+    u64 value() const { return hash; }
+
+private:
+    u64 hash = 0xCBF29CE484222325;
+};
+
+Lockstep::Lockstep(const std::shared_ptr<const RomImage>& rom, const Options& inReferenceOptions, const Options& inFastOptions) :
+    reference_options(inReferenceOptions),
+    fast_options(inFastOptions)
+{
+    /* Quieten the instances' descriptions of the cartridge as it's loaded */
+    log_set_level(LogLevel::Error);
+    reference = std::make_unique<Gameboy>(rom, reference_options);
+    log_set_level(LogLevel::Error);
+    fast = std::make_unique<Gameboy>(rom, fast_options);
+
+    /* Normally registered by Gameboy::run(), which isn't used here */
+    auto ignore_frame = [](const FrameBuffer& buffer) { unused(buffer); };
+    reference->video.register_vblank_callback(ignore_frame);
+    fast->video.register_vblank_callback(ignore_frame);
+}
+
+bool Lockstep::run(const u64 max_cycles, const uint compare_every) {
+    while (fast->scheduler.now() < max_cycles) {
+        fast->tick();
+
+        u64 target = fast->scheduler.now();
+        while (reference->scheduler.now() < target) {
+            step_reference();
+        }
+
+        /* The fast instance only ever stops on an instruction boundary, so
+         * the reference overshooting means they ran different instructions */
+        if (reference->scheduler.now() != target) {
+            diverged = true;
+            reference_hashes = hash(*reference);
+            fast_hashes = hash(*fast);
+            return false;
+        }
+
+        if (reference_instructions - compared_instructions >= compare_every) {
+            if (!states_match()) { return false; }
+        }
+
+        if (at_infinite_jr(*reference) && at_infinite_jr(*fast)) {
+            return states_match();
+        }
+    }
+
+    return states_match();
+}
+
+void Lockstep::step_reference() {
+    const CPU& cpu = reference->cpu;
+
+    if (!cpu.registers.halted) {
+        u16 pc = cpu.registers.pc;
+        const MMU& mmu = reference->mmu;
+
+        trace.push_back({pc, {
+            mmu.read(pc),
+            mmu.read(static_cast<u16>(pc + 1)),
+            mmu.read(static_cast<u16>(pc + 2)),
+        }});
+
+        if (trace.size() > MAX_TRACED_INSTRUCTIONS) {
+            trace.pop_front();
+            trace_truncated = true;
+        }
+
+        reference_instructions++;
+    }
+
+    reference->step();
+}
+
+bool Lockstep::states_match() {
+    reference_hashes = hash(*reference);
+    fast_hashes = hash(*fast);
+
+    if (std::memcmp(&reference_hashes, &fast_hashes, sizeof(StateHashes)) != 0) {
+        diverged = true;
+        return false;
+    }
+
+    compared_instructions = reference_instructions;
+    agreed_cycle = reference->scheduler.now();
+    trace.clear();
+    trace_truncated = false;
+    return true;
+}
+
+StateHashes Lockstep::hash(const Gameboy& gameboy) {
+    StateHashes hashes;
+
+    /* The flags are compared by value, as how they're held depends on the
+     * path which last set them */
+    const CPU& cpu = gameboy.cpu;
+    const Registers& registers = cpu.registers;
+
+    StateHasher cpu_hash;
+    cpu_hash.add_value(registers.af_value());
+    cpu_hash.add_value(registers.bc);
+    cpu_hash.add_value(registers.de);
+    cpu_hash.add_value(registers.hl);
+    cpu_hash.add_value(registers.sp);
+    cpu_hash.add_value(registers.pc);
+    cpu_hash.add_value(registers.halted);
+    cpu_hash.add_value(cpu.interrupts.flag());
+    cpu_hash.add_value(cpu.interrupts.enabled());
+    cpu_hash.add_value(cpu.interrupts.master_enabled());
+    hashes.cpu = cpu_hash.value();
+
+    const MMU& mmu = gameboy.mmu;
+    const std::vector<u8>& cartridge_ram = gameboy.cartridge->get_cartridge_ram();
+
+    StateHasher memory_hash;
+    memory_hash.add(&mmu.memory[0x8000], 0x8000);
+    memory_hash.add(cartridge_ram.data(), cartridge_ram.size());
+    memory_hash.add_value(mmu.rom_bank_0);
+    memory_hash.add_value(mmu.rom_bank);
+    memory_hash.add_value(mmu.boot_rom_overlaid);
+    memory_hash.add_value(mmu.blocked);
+    memory_hash.add_value(gameboy.scheduler.deadline(Event::OamDma));
+
+    /* Plain storage IO registers (e.g. wave RAM) are held by the IO bus */
+    for (uint i = 0; i < IoBus::REGISTER_COUNT; i++) {
+        memory_hash.add_value(gameboy.io.at(static_cast<u16>(IoBus::BASE + i)).value);
+    }
+    hashes.memory = memory_hash.value();
+
+    const Video& video = gameboy.video;
+
+    StateHasher video_hash;
+    video_hash.add_value(video.current_mode);
+    video_hash.add_value(video.lcd_control.value());
+    video_hash.add_value(video.lcd_status.value());
+    video_hash.add_value(video.line.value());
+    video_hash.add_value(video.ly_compare.value());
+    video_hash.add_value(video.scroll_x.value());
+    video_hash.add_value(video.scroll_y.value());
+    video_hash.add_value(video.window_x.value());
+    video_hash.add_value(video.window_y.value());
+    video_hash.add_value(video.bg_palette.value());
+    video_hash.add_value(video.sprite_palette_0.value());
+    video_hash.add_value(video.sprite_palette_1.value());
+    video_hash.add_value(gameboy.scheduler.deadline(Event::VideoMode));
+
+    for (uint y = 0; y < GAMEBOY_HEIGHT; y++) {
+        for (uint x = 0; x < GAMEBOY_WIDTH; x++) {
+            video_hash.add_value(video.buffer.get_pixel(x, y));
+        }
+    }
+
+    hashes.video = video_hash.value();
+
+    const Timer& timer = gameboy.timer;
+
+    StateHasher timer_hash;
+    timer_hash.add_value(timer.get_divider());
+    timer_hash.add_value(timer.get_timer());
+    timer_hash.add_value(timer.get_timer_modulo());
+    timer_hash.add_value(timer.get_timer_control());
+    timer_hash.add_value(gameboy.scheduler.deadline(Event::TimerOverflow));
+    timer_hash.add_value(gameboy.scheduler.deadline(Event::SerialTransfer));
+    hashes.timer = timer_hash.value();
+
+    return hashes;
+}
+
+bool Lockstep::at_infinite_jr(const Gameboy& gameboy) {
+    u16 pc = gameboy.cpu.registers.pc;
+
+    return gameboy.mmu.read(pc) == 0x18
+        && gameboy.mmu.read(static_cast<u16>(pc + 1)) == 0xFE;
+}
+
+u64 Lockstep::cycles() const {
+    return fast->scheduler.now();
+}
+
+u64 Lockstep::instructions() const {
+    return reference_instructions;
+}
+
+std::string Lockstep::disassemble(const TracedInstruction& instruction) {
+    u8 opcode = instruction.bytes[0];
+    bool cb = opcode == 0xCB;
+
+    uint length = cb ? 2 : CPU::opcodes[opcode].length;
+    const std::string& name = cb ? opcode_cb_names[instruction.bytes[1]] : opcode_names[opcode];
+
+    char line[64];
+    int written = snprintf(line, sizeof(line), "0x%04X:", instruction.address);
+
+    for (uint i = 0; i < 3; i++) {
+        written += i < length
+            ? snprintf(line + written, sizeof(line) - written, " %02X", instruction.bytes[i])
+            : snprintf(line + written, sizeof(line) - written, "   ");
+    }
+
+    return std::string(line) + "  " + name;
+}
+
+void Lockstep::report(FILE* file) const {
+    if (!diverged) {
+        fprintf(file, "No divergence after %" PRIu64 " instructions (%" PRIu64 " cycles)\n",
+            reference_instructions, cycles());
+        return;
+    }
+
+    fprintf(file, "Diverged by cycle %" PRIu64 ", after %" PRIu64 " instructions. The states last agreed at cycle %" PRIu64 ".\n",
+        cycles(), reference_instructions, agreed_cycle);
+
+    if (reference->scheduler.now() != fast->scheduler.now()) {
+        fprintf(file, "  clock: reference at cycle %" PRIu64 ", fast at cycle %" PRIu64 "\n",
+            reference->scheduler.now(), fast->scheduler.now());
+    }
+
+    if (reference_hashes.cpu != fast_hashes.cpu) { report_cpu(file); }
+    if (reference_hashes.memory != fast_hashes.memory) { report_memory(file); }
+    if (reference_hashes.video != fast_hashes.video) { report_video(file); }
+    if (reference_hashes.timer != fast_hashes.timer) { report_timer(file); }
+
+    if (trace.empty()) { return; }
+
+    if (!trace_truncated) {
+        fprintf(file, "\nThe first instruction run since then was:\n  %s\n", disassemble(trace.front()).c_str());
+    }
+
+    fprintf(file, "\nReference instructions up to the divergence%s:\n", trace_truncated ? " (the earliest are left out)" : "");
+    for (const TracedInstruction& instruction : trace) {
+        fprintf(file, "  %s\n", disassemble(instruction).c_str());
+    }
+}
+
+void Lockstep::report_cpu(FILE* file) const {
+    auto describe = [file](const char* name, const CPU& cpu) {
+        const Registers& r = cpu.registers;
+        fprintf(file, "  %-9s AF=%04X BC=%04X DE=%04X HL=%04X SP=%04X PC=%04X halted=%d IF=%02X IE=%02X IME=%d\n",
+            name, r.af_value(), r.bc, r.de, r.hl, r.sp, r.pc, r.halted,
+            cpu.interrupts.flag(), cpu.interrupts.enabled(), cpu.interrupts.master_enabled());
+    };
+
+    fprintf(file, "  CPU state differs:\n");
+    describe("reference", reference->cpu);
+    describe("fast", fast->cpu);
+}
+
+void Lockstep::report_memory(FILE* file) const {
+    const MMU& reference_mmu = reference->mmu;
+    const MMU& fast_mmu = fast->mmu;
+
+    if (reference_mmu.rom_bank_0 != fast_mmu.rom_bank_0) {
+        fprintf(file, "  ROM bank 0: reference %u, fast %u\n", reference_mmu.rom_bank_0, fast_mmu.rom_bank_0);
+    }
+
+    if (reference_mmu.rom_bank != fast_mmu.rom_bank) {
+        fprintf(file, "  ROM bank: reference %u, fast %u\n", reference_mmu.rom_bank, fast_mmu.rom_bank);
+    }
+
+    for (uint address = 0x8000; address < 0x10000; address++) {
+        if (reference_mmu.memory[address] != fast_mmu.memory[address]) {
+            fprintf(file, "  memory differs first at 0x%04X: reference 0x%02X, fast 0x%02X\n",
+                address, reference_mmu.memory[address], fast_mmu.memory[address]);
+            return;
+        }
+    }
+
+    for (uint i = 0; i < IoBus::REGISTER_COUNT; i++) {
+        auto address = static_cast<u16>(IoBus::BASE + i);
+        u8 reference_value = reference->io.at(address).value;
+        u8 fast_value = fast->io.at(address).value;
+
+        if (reference_value != fast_value) {
+            fprintf(file, "  IO register 0x%04X differs: reference 0x%02X, fast 0x%02X\n",
+                address, reference_value, fast_value);
+            return;
+        }
+    }
+
+    const std::vector<u8>& reference_ram = reference->cartridge->get_cartridge_ram();
+    const std::vector<u8>& fast_ram = fast->cartridge->get_cartridge_ram();
+
+    for (std::size_t offset = 0; offset < reference_ram.size(); offset++) {
+        if (reference_ram[offset] != fast_ram[offset]) {
+            fprintf(file, "  cartridge RAM differs first at offset 0x%zX: reference 0x%02X, fast 0x%02X\n",
+                offset, reference_ram[offset], fast_ram[offset]);
+            return;
+        }
+    }
+}
+
+void Lockstep::report_video(FILE* file) const {
+    auto describe = [file](const char* name, const Gameboy& gameboy) {
+        const Video& video = gameboy.video;
+        fprintf(file, "  %-9s mode=%d LCDC=%02X STAT=%02X LY=%02X next mode change at cycle %" PRIu64 "\n",
+            name, static_cast<int>(video.current_mode), video.lcd_control.value(),
+            video.lcd_status.value(), video.line.value(), gameboy.scheduler.deadline(Event::VideoMode));
+    };
+
+    fprintf(file, "  video state differs:\n");
+    describe("reference", *reference);
+    describe("fast", *fast);
+}
+
+void Lockstep::report_timer(FILE* file) const {
+    auto describe = [file](const char* name, const Gameboy& gameboy) {
+        const Timer& timer = gameboy.timer;
+        fprintf(file, "  %-9s DIV=%02X TIMA=%02X TMA=%02X TAC=%02X\n",
+            name, timer.get_divider(), timer.get_timer(), timer.get_timer_modulo(), timer.get_timer_control());
+    };
+
+    fprintf(file, "  timer or serial state differs:\n");
+    describe("reference", *reference);
+    describe("fast", *fast);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "gameboy.h"
+
+#include <array>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+/* Hashes of the parts of a Gameboy's state which are compared */
+struct StateHashes {
+    u64 cpu;
+    u64 memory;
+    u64 video;
+    u64 timer;
+};
+
+/* An instruction run by the reference instance, kept for reports */
+struct TracedInstruction {
+    u16 address;
+    std::array<u8, 3> bytes;
+};
+
+/**
+ * Runs a ROM on two Gameboys at once: one on the reference interpreter, which
+ * fetches and decodes every instruction, and one with the fast paths turned
+ * on. The fast instance runs as usual, a scheduled event at a time, and the
+ * reference instance is stepped an instruction at a time until it catches up.
+ * Both should then have reached the same cycle with the same state.
+ *
+ * When they don't, the report gives the instructions the reference ran since
+ * the two last agreed, and which parts of the state differ.
+ */
+class Lockstep {
+public:
+    Lockstep(const std::shared_ptr<const RomImage>& rom, const Options& inReferenceOptions, const Options& inFastOptions);
+
+    /* Runs until the instances diverge, the reference settles into an
+     * infinite JR loop (the end of a test ROM) or max_cycles have passed.
+     * The states are compared once at least compare_every instructions have
+     * run since the last comparison. Returns false on a divergence. */
+    bool run(u64 max_cycles, uint compare_every);
+
+    void report(FILE* file) const;
+
+    /* The cycle both instances have been run to */
+    u64 cycles() const;
+    u64 instructions() const;
+
+private:
+    void step_reference();
+    bool states_match();
+
+    static StateHashes hash(const Gameboy& gameboy);
+    static bool at_infinite_jr(const Gameboy& gameboy);
+    static std::string disassemble(const TracedInstruction& instruction);
+
+    void report_cpu(FILE* file) const;
+    void report_memory(FILE* file) const;
+    void report_video(FILE* file) const;
+    void report_timer(FILE* file) const;
+
+    /* The Gameboys keep references to their options */
+    Options reference_options;
+    Options fast_options;
+
+    std::unique_ptr<Gameboy> reference;
+    std::unique_ptr<Gameboy> fast;
+
+    u64 reference_instructions = 0;
+    u64 compared_instructions = 0;
+    u64 agreed_cycle = 0;
+
+    /* The reference's most recent instructions since the last comparison */
+    std::deque<TracedInstruction> trace;
+    bool trace_truncated = false;
+
+    bool diverged = false;
+    StateHashes reference_hashes = {};
+    StateHashes fast_hashes = {};
+};
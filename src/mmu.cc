@@ -1,483 +1,380 @@
 #include "mmu.h"
 #include "boot.h"
-#include "serial.h"
-#include "input.h"
 #include "timer.h"
 #include "util/log.h"
 #include "util/bitwise.h"
 #include "cpu/cpu.h"
-#include "video/video.h"
 
-MMU::MMU(std::shared_ptr<Cartridge> inCartridge, CPU& inCPU, Video& inVideo, Input& inInput, Serial& inSerial, Timer& inTimer, Options& inOptions) :
+MMU::MMU(std::shared_ptr<Cartridge> inCartridge, CPU& inCPU, IoBus& inIo, Timer& inTimer, Scheduler& inScheduler, Options& inOptions) :
     cartridge(inCartridge),
     cpu(inCPU),
-    video(inVideo),
-    input(inInput),
-    serial(inSerial),
+    io(inIo),
     timer(inTimer),
-    options(inOptions)
+    options(inOptions),
+    dma(*this, inScheduler, inOptions)
 {
     memory = std::vector<u8>(0x10000);
+    map_io();
+    map_memory();
 }
 
-u8 MMU::read(const Address& address) const {
-    if (address.in_range(0x0, 0x7FFF)) {
-        if (address.in_range(0x0, 0xFF) && boot_rom_active()) {
-            return bootDMG[address.value()];
-        }
-        return cartridge->read(address);
+MMU::~MMU() {
+    if (options.access_counts) {
+        accesses.write(stderr);
+    } else if (accesses.any_unexpected()) {
+        const AccessCount& mirrored = accesses.region(AccessRegion::MirroredRam);
+        const AccessCount& unusable = accesses.region(AccessRegion::Unusable);
+
+        log_warn("%llu writes to mirrored work RAM and %llu accesses to unusable memory (see --access-counts)",
+            static_cast<unsigned long long>(mirrored.writes),
+            static_cast<unsigned long long>(unusable.reads + unusable.writes));
     }
+}
 
-    /* VRAM */
-    if (address.in_range(0x8000, 0x9FFF)) {
-        return memory_read(address);
+void MMU::map_io() {
+    io.map_handlers(0xFF0F,
+        [this]() { return cpu.interrupts.flag(); },
+        [this](u8 byte) { cpu.interrupts.set_flag(byte); },
+        0x1F, 0x1F);
+
+    /* TODO: Audio. Channels 1-4 and the sound control registers. */
+    for (u16 address = 0xFF10; address <= 0xFF26; address++) {
+        if (address == 0xFF15 || address == 0xFF1F) { continue; }
+        io.map_unimplemented(address);
     }
 
-    /* External (cartridge) RAM */
-    if (address.in_range(0xA000, 0xBFFF)) {
-        return cartridge->read(address);
+    /* TODO: Audio - Wave Pattern RAM */
+    for (u16 address = 0xFF30; address <= 0xFF3F; address++) {
+        io.map_storage(address);
     }
 
+    io.map_handlers(0xFF46, nullptr, [this](u8 byte) { dma.start(byte); });
+
+    /* Prepare Speed Switch (CGB) */
+    io.map_unimplemented(0xFF4D, 0x0);
+
+    /* Disable boot rom switch */
+    io.map_handlers(0xFF50, nullptr, [this](u8 byte) {
+        if (byte == 0x0 || !boot_rom_overlaid) { return; }
+
+        boot_rom_overlaid = false;
+        map_cartridge();
+        global_logger.enable_tracing();
+        log_debug("Boot rom was disabled");
+    });
+
+    io.map_unimplemented(0xFF7F);
+}
+
+void MMU::map_memory() {
+    /* VRAM */
+    map_pages(0x8000, 0x9FFF, &memory[0x8000], &memory[0x8000]);
+
     /* Internal work RAM */
-    if (address.in_range(0xC000, 0xDFFF)) {
-        return memory_read(address);
-    }
+    map_pages(0xC000, 0xDFFF, &memory[0xC000], &memory[0xC000]);
 
-    if (address.in_range(0xE000, 0xFDFF)) {
-        /* log_warn("Attempting to read from mirrored work RAM"); */
-        auto mirrored_address = Address(address.value() - 0x2000);
-        return memory_read(mirrored_address);
-    }
+    /* Mirrored work RAM. Writes stay unmapped so that they can be counted. */
+    map_pages(0xE000, 0xFDFF, &memory[0xC000], nullptr);
 
-    /* OAM */
-    if (address.in_range(0xFE00, 0xFE9F)) {
-        return memory_read(address);
-    }
+    high_ram.read = &memory[0xFF00];
+    high_ram.write = &memory[0xFF00];
 
-    if (address.in_range(0xFEA0, 0xFEFF)) {
-        log_warn("Attempting to read from unusable memory 0x%x", address.value());
-        return 0xFF;
-    }
+    /* Where accesses go when a page isn't mapped, or isn't writable. VRAM is
+     * always mapped, and work RAM and its mirror are always readable. */
+    map_handlers(0x0000, 0xFFFF, &MMU::read_unmapped, &MMU::write_unmapped);
+    map_handlers(0x0000, 0x7FFF, &MMU::read_cartridge, &MMU::write_mbc);
+    map_handlers(0xA000, 0xBFFF, &MMU::read_cartridge, &MMU::write_cartridge_ram);
+    map_handlers(0xC000, 0xDFFF, &MMU::read_unmapped, &MMU::write_work_ram);
+    map_handlers(0xE000, 0xFDFF, &MMU::read_unmapped, &MMU::write_mirrored_ram);
+    map_handlers(0xFE00, 0xFEFF, &MMU::read_oam, &MMU::write_oam);
+    map_handlers(0xFF00, 0xFFFF, &MMU::read_last_page, &MMU::write_last_page);
+
+    /* While the bus is blocked, only the last page can be reached */
+    blocked_handlers.fill({&MMU::read_blocked, &MMU::write_blocked});
+    blocked_handlers[0xFF] = handlers[0xFF];
 
-    /* Mapped IO */
-    if (address.in_range(0xFF00, 0xFF7F)) {
-        return read_io(address);
+    map_cartridge();
+}
+
+void MMU::map_cartridge() {
+    map_pages(0x0000, 0x3FFF, cartridge->rom_bank_0_memory(), nullptr);
+    map_pages(0x4000, 0x7FFF, cartridge->rom_bank_memory(), nullptr);
+
+    u8* ram_bank = cartridge->ram_bank_memory();
+    map_pages(0xA000, 0xBFFF, ram_bank, ram_bank);
+
+    /* The boot ROM is overlaid on the first page until it is disabled */
+    if (boot_rom_overlaid) {
+        map_pages(0x0000, 0x00FF, bootDMG, nullptr);
     }
 
-    /* Zero Page ram */
-    if (address.in_range(0xFF80, 0xFFFE)) {
-        return memory_read(address);
+    rom_bank_0 = cartridge->rom_bank_0_number();
+    rom_bank = cartridge->rom_bank_number();
+
+    /* Code which was running from the previous mapping must be decoded again */
+    cpu.code_remapped();
+}
+
+void MMU::map_pages(u16 start, u16 end, const u8* read_memory, u8* write_memory) {
+    for (uint page = start / PAGE_SIZE; page <= end / PAGE_SIZE; page++) {
+        uint offset = page * PAGE_SIZE - start;
+
+        pages[page].read = read_memory != nullptr ? read_memory + offset : nullptr;
+        pages[page].write = write_memory != nullptr ? write_memory + offset : nullptr;
     }
+}
 
-    /* Interrupt Enable register */
-    if (address == 0xFFFF) {
-        return cpu.interrupt_enabled.value();
+void MMU::map_handlers(u16 start, u16 end, ReadHandler read, WriteHandler write) {
+    for (uint page = start / PAGE_SIZE; page <= end / PAGE_SIZE; page++) {
+        handlers[page] = {read, write};
     }
+}
 
-    fatal_error("Attempted to read from unmapped memory address 0x%X", address.value());
+const u8* MMU::page_memory(const uint page) const {
+    return page_table[page].read;
 }
 
-u8 MMU::memory_read(const Address& address) const {
-    return memory.at(address.value());
+uint MMU::mapped_rom_bank_0() const {
+    return rom_bank_0;
 }
 
-u8 MMU::read_io(const Address& address) const {
-    switch (address.value()) {
-        case 0xFF00:
-            return input.get_input();
-
-        case 0xFF01:
-            return serial.read();
-
-        case 0xFF02:
-            log_unimplemented("Attempted to read serial transfer control");
-            return 0xFF;
-
-        case 0xFF04:
-            return timer.get_divider();
-
-        case 0xFF05:
-            return timer.get_timer();
-
-        case 0xFF06:
-            return timer.get_timer_modulo();
-
-        case 0xFF07:
-            return timer.get_timer_control();
-
-        case 0xFF0F:
-            return cpu.interrupt_flag.value();
-
-        /* TODO: Audio - Channel 1: Tone & Sweep */
-        case 0xFF10:
-        case 0xFF11:
-        case 0xFF12:
-        case 0xFF13:
-        case 0xFF14:
-            return 0xFF;
-
-        /* TODO: Audio - Channel 2: Tone */
-        case 0xFF16:
-        case 0xFF17:
-        case 0xFF18:
-        case 0xFF19:
-            return 0xFF;
-
-        /* TODO: Audio - Channel 3: Wave Output */
-        case 0xFF1A:
-        case 0xFF1B:
-        case 0xFF1C:
-        case 0xFF1D:
-        case 0xFF1E:
-            return 0xFF;
-
-        /* TODO: Audio - Channel 4: Noise */
-        case 0xFF20:
-        case 0xFF21:
-        case 0xFF22:
-        case 0xFF23:
-            return 0xFF;
-
-        /* TODO: Audio - Sound Control Registers */
-        case 0xFF24:
-            /* TODO */
-            /* log_unimplemented("Read from channel control address 0x%x", address.value()); */
-            return 0xFF;
-
-        case 0xFF25:
-            /* TODO */
-            return 0xFF;
-
-        case 0xFF26:
-            /* TODO */
-            return 0xFF;
-
-        /* TODO: Audio - Wave Pattern RAM */
-        case 0xFF30:
-        case 0xFF31:
-        case 0xFF32:
-        case 0xFF33:
-        case 0xFF34:
-        case 0xFF35:
-        case 0xFF36:
-        case 0xFF37:
-        case 0xFF38:
-        case 0xFF39:
-        case 0xFF3A:
-        case 0xFF3B:
-        case 0xFF3C:
-        case 0xFF3D:
-        case 0xFF3E:
-        case 0xFF3F:
-            return memory_read(address);
-
-        case 0xFF40:
-            return video.control_byte;
-
-        case 0xFF41:
-            return video.lcd_status.value();
-
-        case 0xFF42:
-            return video.scroll_y.value();
-
-        case 0xFF43:
-            return video.scroll_x.value();
-
-        case 0xFF44:
-            return video.line.value();
-
-        case 0xFF45:
-            return video.ly_compare.value();
-
-        case 0xFF47:
-            return video.bg_palette.value();
-
-        case 0xFF48:
-            return video.sprite_palette_0.value();
-
-        case 0xFF49:
-            return video.sprite_palette_1.value();
-
-        case 0xFF4A:
-            return video.window_y.value();
-
-        case 0xFF4B:
-            return video.window_x.value();
-
-        case 0xFF4D:
-            log_unimplemented("Attempted to read from 'Prepare Speed Switch' register");
-            return 0x0;
-
-        /* Disable boot rom switch */
-        case 0xFF50:
-            return memory_read(address);
-
-        default:
-            fatal_error("Read from unknown IO address 0x%x", address.value());
-    }
+uint MMU::mapped_rom_bank() const {
+    return rom_bank;
 }
 
-void MMU::write(const Address& address, const u8 byte) {
-    if (address.in_range(0x0000, 0x7FFF)) {
-        cartridge->write(address, byte);
-        return;
-    }
+bool MMU::boot_rom_mapped() const {
+    return boot_rom_overlaid;
+}
 
-    /* VRAM */
-    if (address.in_range(0x8000, 0x9FFF)) {
-        memory_write(address, byte);
-        return;
-    }
+bool MMU::clock_registers_read() const {
+    return timer.counters_read();
+}
 
-    /* External (cartridge) RAM */
-    if (address.in_range(0xA000, 0xBFFF)) {
-        cartridge->write(address, byte);
-        return;
-    }
+void MMU::reset_clock_registers_read() {
+    timer.reset_counters_read();
+}
 
-    /* Internal work RAM */
-    if (address.in_range(0xC000, 0xDFFF)) {
-        memory_write(address, byte);
-        return;
-    }
+const AccessCounters& MMU::access_counters() const {
+    return accesses;
+}
 
-    /* Mirrored RAM */
-    if (address.in_range(0xE000, 0xFDFF)) {
-        log_warn("Attempting to write to mirrored work RAM");
-        auto mirrored_address = Address(address.value() - 0x2000);
-        memory_write(mirrored_address, byte);
-        return;
-    }
+void MMU::reset_access_counters() {
+    accesses.reset();
+}
 
-    /* OAM */
-    if (address.in_range(0xFE00, 0xFE9F)) {
-        memory_write(address, byte);
-        return;
-    }
+OamDma& MMU::oam_dma() {
+    return dma;
+}
 
-    if (address.in_range(0xFEA0, 0xFEFF)) {
-        log_warn("Attempting to write to unusable memory 0x%x - 0x%x", address.value(), byte);
-        return;
-    }
+void MMU::set_bus_blocked(const bool block) {
+    blocked = block;
+    page_table = blocked ? blocked_pages.data() : pages.data();
+    handler_table = blocked ? blocked_handlers.data() : handlers.data();
 
-    /* Mapped IO */
-    if (address.in_range(0xFF00, 0xFF7F)) {
-        write_io(address, byte);
-        return;
-    }
+    /* Code outside HRAM can't be fetched while the bus is blocked */
+    cpu.code_remapped();
+}
 
-    /* Zero Page ram */
-    if (address.in_range(0xFF80, 0xFFFE)) {
-        memory_write(address, byte);
-        return;
-    }
+bool MMU::bus_blocked() const {
+    return blocked;
+}
 
-    /* Interrupt Enable register */
-    if (address == 0xFFFF) {
-        cpu.interrupt_enabled.set(byte);
+void MMU::set_code_page(uint page, bool contains_code) {
+    u16 address = static_cast<u16>(page * PAGE_SIZE);
+
+    if (page == 0xFF) {
+        high_ram.write = contains_code ? nullptr : &memory[address];
         return;
     }
 
-    fatal_error("Attempted to write to unmapped memory address 0x%X", address.value());
+    /* Only work RAM is mapped writable */
+    if (address < 0xC000 || address > 0xDFFF) { return; }
+
+    pages[page].write = contains_code ? nullptr : &memory[address];
 }
 
-void MMU::write_io(const Address& address, const u8 byte) {
-    switch (address.value()) {
-        case 0xFF00:
-            input.write(byte);
-            return;
+u8 MMU::read(const Address& address) const {
+    u16 addr = address.value();
 
-        case 0xFF01:
-            /* Serial data transfer (SB) */
-            serial.write(byte);
-            return;
+    const u8* page = page_table[addr / PAGE_SIZE].read;
+    if (page != nullptr) {
+        return page[addr % PAGE_SIZE];
+    }
 
-        case 0xFF02:
-            /* Serial data transfer (SB) */
-            serial.write_control(byte);
-            return;
+    return (this->*handler_table[addr / PAGE_SIZE].read)(address);
+}
 
-        case 0xFF04:
-            timer.reset_divider();
-            return;
+u8 MMU::read_unmapped(const Address& address) const {
+    fatal_error("Attempted to read from unmapped memory address 0x%X", address.value());
+}
 
-        case 0xFF05:
-            /* TODO: Time control */
-            log_unimplemented("Wrote to timer counter");
-            return;
+/* Cartridge ROM and external RAM which isn't backed by host memory */
+u8 MMU::read_cartridge(const Address& address) const {
+    return cartridge->read(address);
+}
 
-        case 0xFF06:
-            timer.set_timer_modulo(byte);
-            return;
+u8 MMU::read_oam(const Address& address) const {
+    if (address.value() >= 0xFEA0) {
+        accesses.count_read(AccessRegion::Unusable);
+        return 0xFF;
+    }
 
-        case 0xFF07:
-            timer.set_timer_control(byte);
-            return;
+    return memory_read(address);
+}
 
-        case 0xFF0F:
-            cpu.interrupt_flag.set(byte);
-            return;
+u8 MMU::read_last_page(const Address& address) const {
+    u16 addr = address.value();
 
-        /* TODO: Audio - Channel 1: Tone & Sweep */
-        case 0xFF10:
-        case 0xFF11:
-        case 0xFF12:
-        case 0xFF13:
-        case 0xFF14:
-            return;
+    if (is_high_ram(addr)) {
+        return high_ram.read[addr % PAGE_SIZE];
+    }
 
-        /* TODO: Audio - Channel 2: Tone */
-        case 0xFF16:
-        case 0xFF17:
-        case 0xFF18:
-        case 0xFF19:
-            return;
+    /* Interrupt Enable register */
+    if (addr == 0xFFFF) {
+        return cpu.interrupts.enabled();
+    }
 
-        /* TODO: Audio - Channel 3: Wave Output */
-        case 0xFF1A:
-        case 0xFF1B:
-        case 0xFF1C:
-        case 0xFF1D:
-        case 0xFF1E:
-            return;
+    return read_io(address);
+}
 
-        /* TODO: Audio - Channel 4: Noise */
-        case 0xFF20:
-        case 0xFF21:
-        case 0xFF22:
-        case 0xFF23:
-            return;
+u8 MMU::read_blocked(const Address& address) const {
+    unused(address);
+    return 0xFF;
+}
 
-        /* TODO: Audio - Sound Control Registers */
-        case 0xFF24:
-            /* TODO */
-            /* log_unimplemented("Wrote to channel control address 0x%x - 0x%x", address.value(), byte); */
-            return;
+u8 MMU::memory_read(const Address& address) const {
+    return memory.at(address.value());
+}
 
-        case 0xFF25:
-            /* TODO */
-            /* log_unimplemented("Wrote to selection of sound output terminal address 0x%x - 0x%x", address.value(), byte); */
-            return;
+u8 MMU::read_io(const Address& address) const {
+    u16 addr = address.value();
+    const IoRegister& reg = io.at(addr);
 
-        case 0xFF26:
-            /* TODO */
-            log_unimplemented("Wrote to sound on/off address 0x%x - 0x%x", address.value(), byte);
-            return;
+    accesses.count_io_read(addr);
 
-        /* TODO: Audio - Wave Pattern RAM */
-        case 0xFF30:
-        case 0xFF31:
-        case 0xFF32:
-        case 0xFF33:
-        case 0xFF34:
-        case 0xFF35:
-        case 0xFF36:
-        case 0xFF37:
-        case 0xFF38:
-        case 0xFF39:
-        case 0xFF3A:
-        case 0xFF3B:
-        case 0xFF3C:
-        case 0xFF3D:
-        case 0xFF3E:
-        case 0xFF3F:
-            memory_write(address, byte);
-            return;
+    if (!reg.mapped) {
+        fatal_error("Read from unknown IO address 0x%x", addr);
+    }
 
-        /* Switch on LCD */
-        case 0xFF40:
-            video.control_byte = byte;
-            return;
+    if (!reg.implemented) {
+        accesses.count_read(AccessRegion::UnimplementedIo);
+    }
 
-        case 0xFF41:
-            /* TODO */
-            video.lcd_status.set(byte);
-            return;
+    return io.read(addr);
+}
 
-        /* Vertical Scroll Register */
-        case 0xFF42:
-            video.scroll_y.set(byte);
-            return;
+void MMU::write(const Address& address, const u8 byte) {
+    u16 addr = address.value();
 
-        /* Horizontal Scroll Register */
-        case 0xFF43:
-            video.scroll_x.set(byte);
-            return;
+    u8* page = page_table[addr / PAGE_SIZE].write;
+    if (page != nullptr) {
+        page[addr % PAGE_SIZE] = byte;
+        return;
+    }
 
-        /* LY - Line Y coordinate */
-        case 0xFF44:
-            /* "Writing will reset the counter */
-            video.line.set(0x0);
-            return;
+    (this->*handler_table[addr / PAGE_SIZE].write)(address, byte);
+}
 
-        case 0xFF45:
-            video.ly_compare.set(byte);
-            return;
+void MMU::write_unmapped(const Address& address, const u8 byte) {
+    unused(byte);
+    fatal_error("Attempted to write to unmapped memory address 0x%X", address.value());
+}
 
-        case 0xFF46:
-            dma_transfer(byte);
-            return;
+void MMU::write_mbc(const Address& address, const u8 byte) {
+    uint rom_bank_0_number = cartridge->rom_bank_0_number();
+    uint rom_bank_number = cartridge->rom_bank_number();
+    const u8* rom_bank_0_memory = cartridge->rom_bank_0_memory();
+    const u8* rom_bank_memory = cartridge->rom_bank_memory();
+    const u8* ram_bank_memory = cartridge->ram_bank_memory();
+
+    cartridge->write(address, byte);
+
+    /* Writes to the MBC registers can switch banks or toggle RAM, but games
+     * often select the bank which is already mapped. Remapping throws away
+     * the decoded code, so it's only done when something has changed. */
+    if (cartridge->rom_bank_0_number() == rom_bank_0_number
+        && cartridge->rom_bank_number() == rom_bank_number
+        && cartridge->rom_bank_0_memory() == rom_bank_0_memory
+        && cartridge->rom_bank_memory() == rom_bank_memory
+        && cartridge->ram_bank_memory() == ram_bank_memory) {
+        return;
+    }
 
-        case 0xFF47:
-            video.bg_palette.set(byte);
-            log_trace("Set video palette: 0x%x", byte);
-            return;
+    map_cartridge();
+}
 
-        case 0xFF48:
-            video.sprite_palette_0.set(byte);
-            log_trace("Set sprite palette 0: 0x%x", byte);
-            return;
+/* External (cartridge) RAM which isn't backed by host memory */
+void MMU::write_cartridge_ram(const Address& address, const u8 byte) {
+    cartridge->write(address, byte);
+}
 
-        case 0xFF49:
-            video.sprite_palette_1.set(byte);
-            log_trace("Set sprite palette 1: 0x%x", byte);
-            return;
+/* Work RAM on a page which holds cached code */
+void MMU::write_work_ram(const Address& address, const u8 byte) {
+    memory_write(address, byte);
+    cpu.code_written(address.value());
+}
 
-        case 0xFF4A:
-            video.window_y.set(byte);
-            return;
+void MMU::write_mirrored_ram(const Address& address, const u8 byte) {
+    accesses.count_write(AccessRegion::MirroredRam);
+    auto mirrored_address = Address(address.value() - 0x2000);
+    memory_write(mirrored_address, byte);
+    cpu.code_written(mirrored_address.value());
+}
 
-        case 0xFF4B:
-            video.window_x.set(byte);
-            return;
+void MMU::write_oam(const Address& address, const u8 byte) {
+    if (address.value() >= 0xFEA0) {
+        accesses.count_write(AccessRegion::Unusable);
+        return;
+    }
 
-        case 0xFF4D:
-            log_unimplemented("Attempted to write to 'Prepare Speed Switch' register");
-            return;
+    memory_write(address, byte);
+}
 
-        /* Disable boot rom switch */
-        case 0xFF50:
-            memory_write(address, byte);
-            global_logger.enable_tracing();
-            log_debug("Boot rom was disabled");
-            return;
+void MMU::write_last_page(const Address& address, const u8 byte) {
+    u16 addr = address.value();
 
-        case 0xFF7F:
-            log_warn("Attempt to write to unused memory 0x%x", address.value());
+    if (is_high_ram(addr)) {
+        if (high_ram.write != nullptr) {
+            high_ram.write[addr % PAGE_SIZE] = byte;
             return;
+        }
 
-        default:
-            /* TODO */
-            fatal_error("Wrote 0x%x to unknown address 0x%x", byte, address.value());
+        /* HRAM holding cached code */
+        memory_write(address, byte);
+        cpu.code_written(addr);
+        return;
     }
-}
 
-void MMU::memory_write(const Address& address, const u8 byte) {
-    memory.at(address.value()) = byte;
+    /* Interrupt Enable register */
+    if (addr == 0xFFFF) {
+        cpu.interrupts.set_enabled(byte);
+        return;
+    }
+
+    write_io(address, byte);
 }
 
-bool MMU::boot_rom_active() const {
-    return read(0xFF50) != 0x1;
+void MMU::write_blocked(const Address& address, const u8 byte) {
+    unused(address, byte);
 }
 
-void MMU::dma_transfer(const u8 byte) {
-    Address start_address = byte * 0x100;
+void MMU::write_io(const Address& address, const u8 byte) {
+    u16 addr = address.value();
+    const IoRegister& reg = io.at(addr);
 
-    for (u8 i = 0x0; i <= 0x9F; i++) {
-        Address from_address = start_address.value() + i;
-        Address to_address = 0xFE00 + i;
+    accesses.count_io_write(addr);
 
-        u8 value_at_address = read(from_address);
-        write(to_address, value_at_address);
+    if (!reg.mapped) {
+        fatal_error("Wrote 0x%x to unknown address 0x%x", byte, addr);
     }
+
+    if (!reg.implemented) {
+        accesses.count_write(AccessRegion::UnimplementedIo);
+    }
+
+    io.write(addr, byte);
+}
+
+void MMU::memory_write(const Address& address, const u8 byte) {
+    memory.at(address.value()) = byte;
 }
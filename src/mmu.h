@@ -1,27 +1,129 @@
 #pragma once
 
+#include "access_counters.h"
 #include "address.h"
+#include "io_bus.h"
+#include "oam_dma.h"
 #include "options.h"
+#include "scheduler.h"
 #include "cartridge/cartridge.h"
 
+#include <array>
 #include <vector>
 #include <memory>
 
-class Video;
 class CPU;
-class Serial;
-class Input;
 class Timer;
 
+const uint PAGE_SIZE = 0x100;
+const uint PAGE_COUNT = 0x100;
+
+/* A 256-byte page of the address space. Pages which are backed by plain memory
+ * hold host pointers so that accesses are a single load or store; a null
+ * pointer sends the access through the slow path instead (IO registers, MBC
+ * registers, unusable memory). */
+struct MemoryPage {
+    const u8* read = nullptr;
+    u8* write = nullptr;
+};
+
+/* HRAM, which shares the last page with the IO registers and the interrupt
+ * enable register, so can't be mapped through the page table */
+constexpr bool is_high_ram(const u16 address) {
+    return address >= 0xFF80 && address != 0xFFFF;
+}
+
 class MMU {
 public:
-    MMU(std::shared_ptr<Cartridge> inCartridge, CPU& inCPU, Video& inVideo, Input& input, Serial& serial, Timer& timer, Options& options);
+    MMU(std::shared_ptr<Cartridge> inCartridge, CPU& inCPU, IoBus& inIo, Timer& inTimer, Scheduler& inScheduler, Options& inOptions);
+    ~MMU();
 
     u8 read(const Address& address) const;
     void write(const Address& address, u8 byte);
 
+    /* VRAM and OAM as the PPU sees them, which isn't affected by DMA */
+    u8 read_video_memory(const Address& address) const { return memory[address.value()]; }
+
+    /* The host memory backing a page for reads, or null if reads from it
+     * have to go through read() */
+    const u8* page_memory(uint page) const;
+
+    /* Whether an access would be to plain memory, with no side effects and
+     * nothing which depends on when it's made */
+    bool plain_read(u16 address) const {
+        return page_table[address / PAGE_SIZE].read != nullptr || is_high_ram(address);
+    }
+
+    bool plain_write(u16 address) const {
+        return page_table[address / PAGE_SIZE].write != nullptr
+            || (is_high_ram(address) && high_ram.write != nullptr);
+    }
+
+    /* The ROM banks mapped into 0x0000-0x3FFF and 0x4000-0x7FFF and whether
+     * the boot ROM is overlaid on 0x0000-0x00FF, which identify the code
+     * visible at an address */
+    uint mapped_rom_bank_0() const;
+    uint mapped_rom_bank() const;
+    bool boot_rom_mapped() const;
+
+    /* Whether the divider or timer counter, which count up by themselves
+     * rather than changing on events, have been read since the last reset */
+    bool clock_registers_read() const;
+    void reset_clock_registers_read();
+
+    /* Pages of work RAM (and HRAM) holding cached code are write protected,
+     * so that writes to them reach the CPU's block cache */
+    void set_code_page(uint page, bool contains_code);
+
+    /* Accesses to IO registers and to memory which shouldn't be used, as
+     * counted by the slow path */
+    const AccessCounters& access_counters() const;
+    void reset_access_counters();
+
+    OamDma& oam_dma();
+
+    /* While an accurate OAM DMA transfer is running, the CPU can only reach
+     * the IO registers and HRAM */
+    void set_bus_blocked(bool blocked);
+    bool bus_blocked() const;
+
 private:
-    bool boot_rom_active() const;
+    /* The slow path for accesses to a page which aren't plain memory */
+    using ReadHandler = u8 (MMU::*)(const Address& address) const;
+    using WriteHandler = void (MMU::*)(const Address& address, u8 byte);
+
+    struct PageHandlers {
+        ReadHandler read;
+        WriteHandler write;
+    };
+
+    void map_io();
+    void map_memory();
+    void map_cartridge();
+    void map_pages(u16 start, u16 end, const u8* read_memory, u8* write_memory);
+    void map_handlers(u16 start, u16 end, ReadHandler read, WriteHandler write);
+
+    u8 read_unmapped(const Address& address) const;
+    void write_unmapped(const Address& address, u8 byte);
+
+    u8 read_cartridge(const Address& address) const;
+    void write_mbc(const Address& address, u8 byte);
+    void write_cartridge_ram(const Address& address, u8 byte);
+
+    void write_work_ram(const Address& address, u8 byte);
+    void write_mirrored_ram(const Address& address, u8 byte);
+
+    /* OAM, and the unusable memory after it */
+    u8 read_oam(const Address& address) const;
+    void write_oam(const Address& address, u8 byte);
+
+    /* The IO registers, HRAM and the interrupt enable register */
+    u8 read_last_page(const Address& address) const;
+    void write_last_page(const Address& address, u8 byte);
+
+    /* Everything below the last page while the bus is blocked */
+    u8 read_blocked(const Address& address) const;
+    void write_blocked(const Address& address, u8 byte);
 
     u8 read_io(const Address& address) const;
     void write_io(const Address& address, u8 byte);
@@ -29,17 +131,45 @@ private:
     u8 memory_read(const Address& address) const;
     void memory_write(const Address& address, u8 byte);
 
-    void dma_transfer(const u8 byte);
-
     std::shared_ptr<Cartridge> cartridge;
     CPU& cpu;
-    Video& video;
-    Input& input;
-    Serial& serial;
+    IoBus& io;
     Timer& timer;
     Options& options;
 
     std::vector<u8> memory;
+    std::array<MemoryPage, PAGE_COUNT> pages;
+
+    /* The pages accesses go through: normally 'pages', but while the bus is
+     * blocked, a table with nothing mapped, which sends every access through
+     * the slow path */
+    const MemoryPage* page_table = pages.data();
+    std::array<MemoryPage, PAGE_COUNT> blocked_pages = {};
+    bool blocked = false;
+
+    /* The slow path for each page, which is switched along with the page
+     * table */
+    std::array<PageHandlers, PAGE_COUNT> handlers;
+    std::array<PageHandlers, PAGE_COUNT> blocked_handlers;
+    const PageHandlers* handler_table = handlers.data();
+
+    /* The last page, for accesses to HRAM alone. It's still reachable while
+     * the bus is blocked, and not writable while it holds cached code. */
+    MemoryPage high_ram;
+
+    OamDma dma;
+
+    uint rom_bank_0 = 0;
+    uint rom_bank = 1;
+
+    /* Set until the boot ROM switches itself off by writing to 0xFF50, which
+     * can't be undone */
+    bool boot_rom_overlaid = true;
+
+    mutable AccessCounters accesses;
 
     friend class Debugger;
+    friend class Jit;
+    friend class Lockstep;
+    friend class OamDma;
 };
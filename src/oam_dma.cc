@@ -0,0 +1,52 @@
+#include "oam_dma.h"
+
+#include "mmu.h"
+
+#include <cstring>
+
+OamDma::OamDma(MMU& inMMU, Scheduler& inScheduler, Options& inOptions) :
+    mmu(inMMU),
+    scheduler(inScheduler),
+    accurate(inOptions.accurate_dma)
+{
+}
+
+void OamDma::start(const u8 source_page) {
+    source = source_page;
+
+    if (!accurate) {
+        copy();
+        return;
+    }
+
+    /* Starting again part way through restarts the transfer */
+    if (!transferring) {
+        transferring = true;
+        mmu.set_bus_blocked(true);
+    }
+
+    scheduler.schedule(Event::OamDma, OAM_DMA_CYCLES);
+}
+
+void OamDma::finish() {
+    transferring = false;
+    mmu.set_bus_blocked(false);
+    copy();
+}
+
+void OamDma::copy() {
+    u8* oam = &mmu.memory[OAM_START];
+
+    /* Work RAM, VRAM, ROM and mapped cartridge RAM are plain memory */
+    const u8* page = mmu.pages[source].read;
+    if (page != nullptr) {
+        memcpy(oam, page, OAM_SIZE);
+        return;
+    }
+
+    auto start_address = static_cast<u16>(source * PAGE_SIZE);
+
+    for (uint i = 0; i < OAM_SIZE; i++) {
+        oam[i] = mmu.read(static_cast<u16>(start_address + i));
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "definitions.h"
+#include "options.h"
+#include "scheduler.h"
+
+class MMU;
+
+const u16 OAM_START = 0xFE00;
+const uint OAM_SIZE = 0xA0;
+
+/* A transfer takes one machine cycle per byte */
+const uint OAM_DMA_CYCLES = OAM_SIZE;
+
+/**
+ * Copies a page of memory into OAM when 0xFF46 is written.
+ *
+ * By default the copy is done at once, straight from the host memory behind
+ * the source page. With --accurate-dma the transfer takes as long as it does
+ * on hardware instead: until Event::OamDma, the CPU can only reach the IO
+ * registers and HRAM, and reads anything else as 0xFF. Nothing else can see
+ * OAM in the meantime, so the bytes are all copied when the transfer ends.
+ */
+class OamDma {
+public:
+    OamDma(MMU& inMMU, Scheduler& inScheduler, Options& inOptions);
+
+    void start(u8 source_page);
+
+    /* Handles Event::OamDma */
+    void finish();
+
+    bool in_progress() const { return transferring; }
+
+private:
+    void copy();
+
+    MMU& mmu;
+    Scheduler& scheduler;
+
+    bool accurate;
+    bool transferring = false;
+    u8 source = 0;
+};
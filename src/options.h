@@ -1,5 +1,7 @@
 #pragma once
 
+#include <string>
+
 struct Options {
     bool debugger = false;
     bool trace = false;
@@ -8,4 +10,32 @@ struct Options {
     bool show_full_framebuffer = false;
     bool exit_on_infinite_jr = false;
     bool print_serial = false;
+    bool jit = false;
+    bool opcode_histogram = false;
+
+    /* Start at 0x0100 with the state the boot ROM leaves, instead of
+     * running it */
+    bool skip_boot = false;
+
+    /* Whether OAM DMA takes as long as on hardware, keeping the CPU off the
+     * bus meanwhile, rather than copying at once */
+    bool accurate_dma = false;
+    bool access_counts = false;
+
+    /* With GBEMU_PROFILE, where the profiler reads symbols from (<profile>.sym)
+     * and writes its reports to. Empty unless profiling. */
+    std::string profile;
+
+    /* Where to write each frame's host timings as Chrome trace events, if
+     * anywhere */
+    std::string frame_trace;
+
+    /* The interpreter's fast paths. Turning them all off leaves the reference
+     * interpreter, which fetches and decodes every instruction as it runs
+     * (lazy flags and the dispatch loop are chosen when building). */
+    bool block_cache = true;
+    bool fusion = true;
+    bool idle_skipping = true;
+    bool chain_instructions = true;
+    bool aot = true;
 };
@@ -0,0 +1,61 @@
+#include "scheduler.h"
+
+Scheduler::Scheduler() {
+    deadlines.fill(NEVER);
+    pending.fill(false);
+}
+
+uint Scheduler::cycles_until_next_event() const {
+    if (next <= clock) { return 0; }
+
+    u64 cycles = next - clock;
+    return cycles > ~0u ? ~0u : static_cast<uint>(cycles);
+}
+
+void Scheduler::schedule(const Event event, const uint cycles) {
+    schedule_at(event, now() + cycles);
+}
+
+void Scheduler::reschedule(const Event event, const uint cycles) {
+    schedule_at(event, deadline(event) + cycles);
+}
+
+void Scheduler::schedule_at(const Event event, const u64 time) {
+    deadlines[static_cast<uint>(event)] = time;
+    pending[static_cast<uint>(event)] = true;
+    update_next();
+}
+
+void Scheduler::cancel(const Event event) {
+    pending[static_cast<uint>(event)] = false;
+    update_next();
+}
+
+u64 Scheduler::deadline(const Event event) const {
+    return deadlines[static_cast<uint>(event)];
+}
+
+bool Scheduler::pop_due(Event& event) {
+    if (next > clock) { return false; }
+
+    for (uint slot = 0; slot < EVENT_COUNT; slot++) {
+        if (pending[slot] && deadlines[slot] == next) {
+            event = static_cast<Event>(slot);
+            pending[slot] = false;
+            update_next();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void Scheduler::update_next() {
+    next = NEVER;
+
+    for (uint slot = 0; slot < EVENT_COUNT; slot++) {
+        if (pending[slot] && deadlines[slot] < next) {
+            next = deadlines[slot];
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "definitions.h"
+
+#include <array>
+
+/* Everything outside the CPU which happens at a known time. Each kind of
+ * event has one slot, so scheduling it again replaces its deadline. */
+enum class Event : u8 {
+    VideoMode,      /* PPU mode changes, and LY increments during VBLANK */
+    TimerOverflow,  /* TIMA wrapping around to TMA */
+    SerialTransfer, /* The last bit of a serial transfer being shifted out */
+    OamDma,         /* The end of an OAM DMA transfer, with --accurate-dma */
+};
+
+const uint EVENT_COUNT = 4;
+
+/* The deadline of an event which isn't scheduled */
+const u64 NEVER = ~u64(0);
+
+/**
+ * Keeps the master clock, counted in CPU cycles since power on, and a fixed
+ * table of upcoming events. The CPU can run without interruption until the
+ * earliest deadline, when the events which are due are handed back one at a
+ * time in the order they were due.
+ */
+class Scheduler {
+public:
+    Scheduler();
+
+    u64 now() const { return clock + in_flight; }
+    u64 next_deadline() const { return next; }
+    uint cycles_until_next_event() const;
+
+    void advance(uint cycles) { clock += cycles; }
+
+    /* The cycles the CPU has run since the clock last advanced, while it
+     * carries on through a block without returning to the main loop. They
+     * count towards now(), so that an instruction part way through the block
+     * sees the time it started at. The CPU clears them before it returns. */
+    uint in_flight_cycles() const { return in_flight; }
+    void set_in_flight_cycles(uint cycles) { in_flight = cycles; }
+
+    /* Schedules an event some number of cycles from now */
+    void schedule(Event event, uint cycles);
+
+    /* Schedules an event relative to its previous deadline rather than now,
+     * so that periodic events don't drift if they're handled late */
+    void reschedule(Event event, uint cycles);
+
+    /* Schedules an event at a time on the master clock */
+    void schedule_at(Event event, u64 time);
+
+    void cancel(Event event);
+
+    /* When the event is (or was last) due */
+    u64 deadline(Event event) const;
+
+    /* Takes the earliest event which is due, returning false if none are */
+    bool pop_due(Event& event);
+
+private:
+    void update_next();
+
+    u64 clock = 0;
+    uint in_flight = 0;
+    u64 next = NEVER;
+
+    std::array<u64, EVENT_COUNT> deadlines;
+    std::array<bool, EVENT_COUNT> pending;
+};
@@ -1,21 +1,59 @@
 #include "serial.h"
 
+#include "cpu/cpu.h"
 #include "util/bitwise.h"
 #include "util/log.h"
 
 #include <cstdio>
 
+/* Bits are shifted out at 8192Hz when using the internal clock */
+const uint CYCLES_PER_TRANSFER = 8 * 128;
+
+Serial::Serial(CPU& inCPU, IoBus& io, Scheduler& inScheduler, Options& inOptions) :
+    cpu(inCPU),
+    scheduler(inScheduler),
+    options(inOptions)
+{
+    /* Serial data transfer (SB) */
+    io.map_handlers(0xFF01, [this]() { return read(); }, [this](u8 byte) { write(byte); });
+
+    /* Serial transfer control (SC) */
+    io.map_handlers(0xFF02, [this]() { return read_control(); }, [this](u8 byte) { write_control(byte); }, 0x81, 0x81);
+}
+
 u8 Serial::read() const {
     return data;
 }
 
+u8 Serial::read_control() const {
+    return control;
+}
+
 void Serial::write(const u8 byte) {
     data = byte;
 }
 
 void Serial::write_control(const u8 byte) {
     if (bitwise::check_bit(byte, 7) && options.print_serial) {
+        /* Keep the output in order with anything still queued for the log */
+        log_flush();
         printf("%c", data);
         fflush(stdout);
     }
+
+    control = byte;
+
+    /* Without a link partner to provide the clock, an externally clocked
+     * transfer never finishes */
+    if (bitwise::check_bit(byte, 7) && bitwise::check_bit(byte, 0)) {
+        scheduler.schedule(Event::SerialTransfer, CYCLES_PER_TRANSFER);
+    } else {
+        scheduler.cancel(Event::SerialTransfer);
+    }
+}
+
+void Serial::transfer_complete() {
+    data = 0xFF;
+    control = bitwise::clear_bit(control, 7);
+    cpu.interrupts.request(Interrupt::Serial);
 }
@@ -1,18 +1,30 @@
 #pragma once
 
 #include "definitions.h"
+#include "io_bus.h"
 #include "options.h"
+#include "scheduler.h"
+
+class CPU;
 
 class Serial {
 public:
-    Serial(Options& inOptions) : options(inOptions) {}
+    Serial(CPU& inCPU, IoBus& io, Scheduler& inScheduler, Options& inOptions);
 
     u8 read() const;
+    u8 read_control() const;
     void write(u8 byte);
     void write_control(u8 byte);
 
+    /* Handles Event::SerialTransfer. With nothing connected, the byte
+     * shifted in is all 1s. */
+    void transfer_complete();
+
 private:
+    CPU& cpu;
+    Scheduler& scheduler;
     Options& options;
 
     u8 data;
+    u8 control = 0;
 };
@@ -1,16 +1,30 @@
 #include "timer.h"
 
-void Timer::tick(uint cycles) {
-    u8 new_divider = static_cast<u8>(divider.value() + cycles);
-    divider.set(new_divider);
+#include "cpu/cpu.h"
+#include "util/bitwise.h"
+
+Timer::Timer(CPU& inCPU, IoBus& io, Scheduler& inScheduler) :
+    cpu(inCPU),
+    scheduler(inScheduler)
+{
+    io.map_handlers(0xFF04,
+        [this]() { counter_read = true; return get_divider(); },
+        [this](u8) { reset_divider(); });
+
+    io.map_handlers(0xFF05,
+        [this]() { counter_read = true; return get_timer(); },
+        [this](u8 byte) { set_timer(byte); });
+
+    io.map_handlers(0xFF06, [this]() { return get_timer_modulo(); }, [this](u8 byte) { set_timer_modulo(byte); });
+    io.map_handlers(0xFF07, [this]() { return get_timer_control(); }, [this](u8 byte) { set_timer_control(byte); }, 0x07, 0x07);
 }
 
 u8 Timer::get_divider() const {
-    return divider.value();
+    return static_cast<u8>(scheduler.now() - divider_reset);
 }
 
 u8 Timer::get_timer() const {
-    return timer_counter.value();
+    return current_counter();
 }
 
 u8 Timer::get_timer_modulo() const {
@@ -22,11 +36,71 @@ u8 Timer::get_timer_control() const {
 }
 
 void Timer::reset_divider() {
-    divider.set(0x0);
+    divider_reset = scheduler.now();
+}
+
+void Timer::set_timer(u8 value) {
+    set_counter(value, scheduler.now());
+    schedule_overflow();
 }
 
 void Timer::set_timer_modulo(u8 value) {
+    timer_modulo.set(value);
 }
 
 void Timer::set_timer_control(u8 value) {
+    set_counter(current_counter(), scheduler.now());
+    timer_control.set(value);
+    schedule_overflow();
+}
+
+bool Timer::counters_read() const {
+    return counter_read;
+}
+
+void Timer::reset_counters_read() {
+    counter_read = false;
+}
+
+void Timer::overflow() {
+    set_counter(timer_modulo.value(), scheduler.deadline(Event::TimerOverflow));
+    cpu.interrupts.request(Interrupt::Timer);
+    schedule_overflow();
+}
+
+bool Timer::timer_enabled() const {
+    return bitwise::check_bit(timer_control.value(), 2);
+}
+
+uint Timer::cycles_per_increment() const {
+    /* 4096Hz, 262144Hz, 65536Hz and 16384Hz */
+    switch (timer_control.value() & 0x3) {
+        case 0: return 256;
+        case 1: return 4;
+        case 2: return 16;
+        default: return 64;
+    }
+}
+
+u8 Timer::current_counter() const {
+    if (!timer_enabled()) { return timer_counter.value(); }
+
+    u64 increments = (scheduler.now() - timer_counter_set) / cycles_per_increment();
+    return static_cast<u8>(timer_counter.value() + increments);
+}
+
+void Timer::set_counter(u8 value, u64 time) {
+    timer_counter.set(value);
+    timer_counter_set = time;
+}
+
+void Timer::schedule_overflow() {
+    if (!timer_enabled()) {
+        scheduler.cancel(Event::TimerOverflow);
+        return;
+    }
+
+    uint increments = 0x100 - timer_counter.value();
+    u64 overflow_time = timer_counter_set + increments * cycles_per_increment();
+    scheduler.schedule_at(Event::TimerOverflow, overflow_time);
 }
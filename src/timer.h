@@ -1,11 +1,15 @@
 #pragma once
 
 #include "definitions.h"
+#include "io_bus.h"
 #include "register.h"
+#include "scheduler.h"
+
+class CPU;
 
 class Timer {
 public:
-    void tick(uint cycles);
+    Timer(CPU& inCPU, IoBus& io, Scheduler& inScheduler);
 
     u8 get_divider() const;
     u8 get_timer() const;
@@ -13,13 +17,40 @@ public:
     u8 get_timer_control() const;
 
     void reset_divider();
+    void set_timer(u8 value);
     void set_timer_modulo(u8 value);
     void set_timer_control(u8 value);
 
+    /* Whether the divider or timer counter, which count up by themselves
+     * rather than changing on events, have been read since the last reset */
+    bool counters_read() const;
+    void reset_counters_read();
+
+    /* Handles Event::TimerOverflow: reloads the counter from the modulo and
+     * requests the timer interrupt */
+    void overflow();
+
 private:
-    ByteRegister divider;
+    bool timer_enabled() const;
+    uint cycles_per_increment() const;
+
+    /* The counter is only brought up to date when it's read or its rate
+     * changes; in between, it's worked out from the time it was last set */
+    u8 current_counter() const;
+    void set_counter(u8 value, u64 time);
+    void schedule_overflow();
+
+    CPU& cpu;
+    Scheduler& scheduler;
+
+    /* The divider counts up from the last time it was reset */
+    u64 divider_reset = 0;
+
     ByteRegister timer_counter;
+    u64 timer_counter_set = 0;
 
     ByteRegister timer_modulo;
     ByteRegister timer_control;
+
+    bool counter_read = false;
 };
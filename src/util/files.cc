@@ -16,13 +16,12 @@ std::vector<u8> read_bytes(const std::string& filename) {
     ifstream::pos_type position = stream.tellg();
     size_t file_size = static_cast<size_t>(position);
 
-    std::vector<char> file_contents(file_size);
+    /* Read straight into the result, rather than through a buffer of chars */
+    std::vector<u8> data(file_size);
 
     stream.seekg(0, ios::beg);
-    stream.read(&file_contents[0], static_cast<std::streamsize>(position));
+    stream.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(position));
     stream.close();
 
-    auto data = std::vector<u8>(file_contents.begin(), file_contents.end());
-
     return data;
 }
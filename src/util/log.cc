@@ -16,9 +16,13 @@
 
 #include "log.h"
 
-#include "string_utils.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
 
-#include <cstdarg>
+using std::chrono::steady_clock;
 
 Logger global_logger;
 const char* COLOR_TRACE = "\033[1;30m";
@@ -29,19 +33,359 @@ const char* COLOR_WARNING = "\033[1;33m";
 const char* COLOR_ERROR = "\033[1;31m";
 const char* COLOR_RESET = "\033[0m";
 
-void Logger::log(LogLevel level, const char* fmt, ...) {
-    if (!should_log(level)) {
+/* How many of the same message (by format string) are written each second
+ * before the rest are only counted */
+const uint64_t MESSAGES_PER_SECOND = 20;
+
+void LogMessage::add_string(const char* string) {
+    if (argument_count == MAX_LOG_ARGUMENTS) { return; }
+
+    if (string == nullptr) { string = "(null)"; }
+
+    LogArgument& argument = arguments[argument_count++];
+    argument.kind = LogArgument::Kind::String;
+    argument.size = sizeof(string);
+    argument.string_offset = strings_used;
+
+    /* Long strings are cut short to fit */
+    std::size_t space = LOG_STRING_SPACE - strings_used - 1;
+    std::size_t length = std::min(strlen(string), space);
+
+    memcpy(&strings[strings_used], string, length);
+    strings[strings_used + length] = '\0';
+    strings_used += length + 1;
+
+    if (strings_used >= LOG_STRING_SPACE) { strings_used = LOG_STRING_SPACE - 1; }
+}
+
+static long long signed_value(const LogArgument& argument) {
+    return static_cast<long long>(argument.integer);
+}
+
+static unsigned long long unsigned_value(const LogArgument& argument) {
+    /* Negative numbers print in the width they were passed as, like printf */
+    if (argument.size >= sizeof(uint64_t)) { return argument.integer; }
+
+    return argument.integer & ((1ull << (argument.size * 8)) - 1);
+}
+
+std::string LogMessage::format() const {
+    std::string text;
+    std::size_t next = 0;
+
+    const char* p = fmt;
+
+    while (*p != '\0') {
+        if (*p != '%') {
+            text += *p++;
+            continue;
+        }
+
+        const char* start = p++;
+
+        if (*p == '%') {
+            text += '%';
+            p++;
+            continue;
+        }
+
+        /* Rebuild the conversion with the length of the value as captured */
+        std::string spec = "%";
+
+        while (*p != '\0' && strchr("-+ #0", *p) != nullptr) { spec += *p++; }
+        while (*p >= '0' && *p <= '9') { spec += *p++; }
+
+        if (*p == '.') {
+            spec += *p++;
+            while (*p >= '0' && *p <= '9') { spec += *p++; }
+        }
+
+        while (*p != '\0' && strchr("hljztL", *p) != nullptr) { p++; }
+
+        char conversion = *p;
+        if (conversion == '\0') { break; }
+        p++;
+
+        if (next == argument_count) {
+            text.append(start, p);
+            continue;
+        }
+
+        const LogArgument& argument = arguments[next++];
+        bool is_float = argument.kind == LogArgument::Kind::Float;
+        char buffer[512];
+
+        switch (conversion) {
+            case 'd':
+            case 'i':
+                spec += "ll";
+                spec += conversion;
+                snprintf(buffer, sizeof(buffer), spec.c_str(), is_float ? static_cast<long long>(argument.real) : signed_value(argument));
+                break;
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X':
+                spec += "ll";
+                spec += conversion;
+                snprintf(buffer, sizeof(buffer), spec.c_str(), is_float ? static_cast<unsigned long long>(argument.real) : unsigned_value(argument));
+                break;
+            case 'c':
+                spec += 'c';
+                snprintf(buffer, sizeof(buffer), spec.c_str(), static_cast<int>(argument.integer));
+                break;
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A':
+                spec += conversion;
+                snprintf(buffer, sizeof(buffer), spec.c_str(), is_float ? argument.real : static_cast<double>(signed_value(argument)));
+                break;
+            case 's':
+                spec += 's';
+                snprintf(buffer, sizeof(buffer), spec.c_str(), argument.kind == LogArgument::Kind::String
+                    ? &strings[argument.string_offset]
+                    : "(?)");
+                break;
+            case 'p':
+                spec += 'p';
+                snprintf(buffer, sizeof(buffer), spec.c_str(), argument.pointer);
+                break;
+            default:
+                text.append(start, p);
+                continue;
+        }
+
+        text += buffer;
+    }
+
+    return text;
+}
+
+Logger::Logger() {
+    for (std::size_t i = 0; i < QUEUE_SIZE; i++) {
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    running.store(true, std::memory_order_release);
+    writer = std::thread([this]() { run(); });
+}
+
+Logger::~Logger() {
+    running.store(false, std::memory_order_release);
+    wake_writer();
+
+    if (writer.joinable()) { writer.join(); }
+}
+
+void Logger::submit(const LogMessage& message) {
+    /* Once the writer has stopped (e.g. while exiting), messages are written
+     * directly, as are errors, which may be followed by a crash */
+    if (message.level == LogLevel::Error || !running.load(std::memory_order_acquire)) {
+        flush();
+        write(message.level, message.format());
         return;
     }
 
-    va_list args;
-    va_start(args, fmt);
-    std::string msg = str_format(fmt, args);
-    va_end(args);
+    if (!push(message)) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /* Pairs with the fence in wait_for_messages(): either the writer sees
+     * the message, or this sees that the writer is parked */
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (writer_parked.load(std::memory_order_relaxed)) {
+        wake_writer();
+    }
+}
+
+bool Logger::push(const LogMessage& message) {
+    std::size_t position = enqueue_position.load(std::memory_order_relaxed);
+
+    while (true) {
+        Cell& cell = cells[position % QUEUE_SIZE];
+        std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        auto difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+
+        if (difference == 0) {
+            if (enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                /* Only the arguments in use are copied */
+                LogMessage& slot = cell.message;
+                slot.level = message.level;
+                slot.fmt = message.fmt;
+                slot.argument_count = message.argument_count;
+                slot.strings_used = message.strings_used;
+                std::copy_n(message.arguments.begin(), message.argument_count, slot.arguments.begin());
+                std::copy_n(message.strings.begin(), message.strings_used, slot.strings.begin());
+
+                cell.sequence.store(position + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (difference < 0) {
+            /* The writer hasn't caught up with the last lap */
+            return false;
+        } else {
+            position = enqueue_position.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool Logger::pop(LogMessage& message) {
+    Cell& cell = cells[dequeue_position % QUEUE_SIZE];
+    std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+
+    if (sequence != dequeue_position + 1) { return false; }
 
+    message = cell.message;
+    cell.sequence.store(dequeue_position + QUEUE_SIZE, std::memory_order_release);
+    dequeue_position++;
+    return true;
+}
+
+bool Logger::has_work() const {
+    const Cell& cell = cells[dequeue_position % QUEUE_SIZE];
+
+    return cell.sequence.load(std::memory_order_acquire) == dequeue_position + 1
+        || dropped.load(std::memory_order_relaxed) > 0
+        || !running.load(std::memory_order_acquire);
+}
+
+void Logger::wake_writer() {
+    /* Taking the lock means the writer is either waiting already or hasn't
+     * yet checked for work, so the notification can't be missed */
+    { std::lock_guard<std::mutex> lock(wake_mutex); }
+    wake.notify_one();
+}
+
+void Logger::wait_for_messages() {
+    std::unique_lock<std::mutex> lock(wake_mutex);
+
+    writer_parked.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    /* Wake at least once a second to report what was held back */
+    wake.wait_for(lock, std::chrono::seconds(1), [this]() { return has_work(); });
+
+    writer_parked.store(false, std::memory_order_relaxed);
+}
+
+void Logger::flush() {
+    std::size_t target = enqueue_position.load(std::memory_order_acquire);
+
+    while (running.load(std::memory_order_acquire) && written.load(std::memory_order_acquire) < target) {
+        std::this_thread::yield();
+    }
+}
+
+void Logger::write(const LogLevel level, const std::string& text) const {
     fprintf((level < LogLevel::Error) ? stdout : stderr,
         "%s| %s%s\n",
-        level_color(level), COLOR_RESET, msg.c_str());
+        level_color(level), COLOR_RESET, text.c_str());
+}
+
+void Logger::run() {
+    struct RateLimit {
+        steady_clock::time_point window_start;
+        LogLevel level;
+        uint64_t written;
+        uint64_t suppressed;
+    };
+
+    std::unordered_map<const char*, RateLimit> limits;
+
+    LogLevel repeated_level = LogLevel::Info;
+    std::string repeated_text;
+    uint64_t repeats = 0;
+    bool have_previous = false;
+
+    auto report_repeats = [&]() {
+        if (repeats == 0) { return; }
+
+        write(repeated_level, "(the last message was repeated " + std::to_string(repeats) + " times)");
+        repeats = 0;
+    };
+
+    auto report_suppressed = [&](const char* fmt, RateLimit& limit) {
+        if (limit.suppressed == 0) { return; }
+
+        write(limit.level, "(" + std::to_string(limit.suppressed) + " more like \"" + fmt + "\" were left out)");
+        limit.suppressed = 0;
+    };
+
+    LogMessage message;
+    auto last_report = steady_clock::now();
+
+    while (true) {
+        bool stopping = !running.load(std::memory_order_acquire);
+
+        while (pop(message)) {
+            auto now = steady_clock::now();
+
+            auto found = limits.find(message.fmt);
+            if (found == limits.end()) {
+                found = limits.emplace(message.fmt, RateLimit{now, message.level, 0, 0}).first;
+            }
+
+            RateLimit& limit = found->second;
+
+            if (now - limit.window_start >= std::chrono::seconds(1)) {
+                report_repeats();
+                report_suppressed(message.fmt, limit);
+                limit.window_start = now;
+                limit.written = 0;
+            }
+
+            if (limit.written == MESSAGES_PER_SECOND) {
+                limit.suppressed++;
+            } else {
+                std::string text = message.format();
+
+                if (have_previous && message.level == repeated_level && text == repeated_text) {
+                    repeats++;
+                    written.fetch_add(1, std::memory_order_release);
+                    continue;
+                }
+
+                report_repeats();
+                write(message.level, text);
+
+                limit.written++;
+                repeated_text = std::move(text);
+                repeated_level = message.level;
+                have_previous = true;
+            }
+
+            written.fetch_add(1, std::memory_order_release);
+        }
+
+        uint64_t lost = dropped.exchange(0, std::memory_order_relaxed);
+        if (lost > 0) {
+            report_repeats();
+            write(LogLevel::Warning, "(" + std::to_string(lost) + " messages were dropped as the log queue was full)");
+        }
+
+        /* Say what was held back at most once a second, and before exiting */
+        auto now = steady_clock::now();
+        if (stopping || now - last_report >= std::chrono::seconds(1)) {
+            report_repeats();
+
+            for (auto& limit : limits) {
+                report_suppressed(limit.first, limit.second);
+            }
+
+            last_report = now;
+        }
+
+        fflush(stdout);
+
+        if (stopping) { break; }
+
+        wait_for_messages();
+    }
 }
 
 void Logger::set_level(LogLevel level) {
@@ -52,13 +396,7 @@ void Logger::enable_tracing() {
     tracing_enabled = true;
 }
 
-bool Logger::should_log(LogLevel level) const {
-    if (!tracing_enabled && level == LogLevel::Trace) { return false; }
-
-    return enabled && (current_level <= level);
-}
-
-inline const char* Logger::level_color(LogLevel level) const {
+const char* Logger::level_color(LogLevel level) const {
     switch (level) {
         case LogLevel::Trace:
             return COLOR_TRACE;
@@ -78,3 +416,7 @@ inline const char* Logger::level_color(LogLevel level) const {
 void log_set_level(LogLevel level) {
     global_logger.set_level(level);
 }
+
+void log_flush() {
+    global_logger.flush();
+}
@@ -16,7 +16,14 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <type_traits>
 
 enum class LogLevel {
     Trace,
@@ -27,24 +34,161 @@ enum class LogLevel {
     Error,
 };
 
+/* An argument to a log message, captured as its raw value. Strings are copied
+ * into the message, as they may not outlive the call. */
+struct LogArgument {
+    enum class Kind : uint8_t { Signed, Unsigned, Float, String, Pointer };
+
+    Kind kind;
+    uint8_t size;
+
+    union {
+        uint64_t integer;
+        double real;
+        const void* pointer;
+        std::size_t string_offset;
+    };
+};
+
+const std::size_t MAX_LOG_ARGUMENTS = 8;
+const std::size_t LOG_STRING_SPACE = 256;
+
+/* A message waiting to be formatted: the format string (always a literal, so
+ * it outlives the message) and its arguments */
+struct LogMessage {
+    LogLevel level;
+    const char* fmt;
+    std::size_t argument_count;
+    std::size_t strings_used;
+    std::array<LogArgument, MAX_LOG_ARGUMENTS> arguments;
+    std::array<char, LOG_STRING_SPACE> strings;
+
+    template <typename T> void add(const T& value);
+    void add_string(const char* string);
+
+    std::string format() const;
+};
+
+/**
+ * Logs asynchronously: messages are put on a bounded lock-free queue, which
+ * any thread can add to, and a background thread formats and writes them.
+ * The emulator only pays for copying the arguments.
+ *
+ * The writer collapses runs of identical messages into a count, and limits
+ * each message (by format string) to a burst per second, summarising what
+ * it left out. Errors are written straight away, after anything before them.
+ * If the queue is full, messages are dropped and counted rather than making
+ * the emulator wait.
+ */
 class Logger {
 public:
-    Logger() = default;
+    Logger();
+    ~Logger();
+
+    template <std::size_t N, typename... Args>
+    void log(LogLevel level, const char (&fmt)[N], const Args&... args) {
+        if (!should_log(level)) { return; }
+
+        LogMessage message;
+        message.level = level;
+        message.fmt = fmt;
+        message.argument_count = 0;
+        message.strings_used = 0;
+        (message.add(args), ...);
+
+        submit(message);
+    }
+
+    /* Waits until everything logged so far has been written */
+    void flush();
 
-    void log(LogLevel level, const char* fmt, ...);
     void set_level(LogLevel level);
 
     void enable_tracing();
 
+    /* Inline, so that the log macros can skip evaluating their arguments */
+    bool should_log(LogLevel level) const {
+        if (!tracing_enabled && level == LogLevel::Trace) { return false; }
+
+        return enabled && (current_level <= level);
+    }
+
 private:
-    bool should_log(LogLevel level) const;
     const char* level_color(LogLevel level) const;
 
+    void submit(const LogMessage& message);
+    bool push(const LogMessage& message);
+    bool pop(LogMessage& message);
+
+    void write(LogLevel level, const std::string& text) const;
+    void run();
+
+    bool has_work() const;
+    void wake_writer();
+    void wait_for_messages();
+
     LogLevel current_level = LogLevel::Debug;
     bool enabled = true;
     bool tracing_enabled = false;
+
+    /* A bounded MPSC queue: each cell's sequence number says whether it's
+     * free for the producer at that position or ready for the consumer */
+    static const std::size_t QUEUE_SIZE = 1024;
+
+    struct Cell {
+        std::atomic<std::size_t> sequence;
+        LogMessage message;
+    };
+
+    std::array<Cell, QUEUE_SIZE> cells;
+    std::atomic<std::size_t> enqueue_position{0};
+    std::size_t dequeue_position = 0;
+
+    /* Messages the writer has finished with, for flush() */
+    std::atomic<std::size_t> written{0};
+    std::atomic<uint64_t> dropped{0};
+
+    std::atomic<bool> running{false};
+    std::thread writer;
+
+    /* The writer sleeps on 'wake' once the queue is empty. Producers only
+     * take the lock to wake it when it's parked. */
+    std::mutex wake_mutex;
+    std::condition_variable wake;
+    std::atomic<bool> writer_parked{false};
 };
 
+template <typename T>
+void LogMessage::add(const T& value) {
+    using Value = std::decay_t<T>;
+
+    if constexpr (std::is_same<Value, char*>::value || std::is_same<Value, const char*>::value) {
+        add_string(value);
+    } else if constexpr (std::is_same<Value, std::string>::value) {
+        add_string(value.c_str());
+    } else if constexpr (std::is_enum<Value>::value) {
+        add(static_cast<std::underlying_type_t<Value>>(value));
+    } else {
+        if (argument_count == MAX_LOG_ARGUMENTS) { return; }
+        LogArgument& argument = arguments[argument_count++];
+        argument.size = sizeof(Value);
+
+        if constexpr (std::is_integral<Value>::value) {
+            argument.kind = std::is_signed<Value>::value ? LogArgument::Kind::Signed : LogArgument::Kind::Unsigned;
+            argument.integer = std::is_signed<Value>::value
+                ? static_cast<uint64_t>(static_cast<int64_t>(value))
+                : static_cast<uint64_t>(value);
+        } else if constexpr (std::is_floating_point<Value>::value) {
+            argument.kind = LogArgument::Kind::Float;
+            argument.real = static_cast<double>(value);
+        } else {
+            static_assert(std::is_pointer<Value>::value, "Log arguments must be numbers, strings or pointers");
+            argument.kind = LogArgument::Kind::Pointer;
+            argument.pointer = static_cast<const void*>(value);
+        }
+    }
+}
+
 extern Logger global_logger;
 extern const char* COLOR_TRACE;
 extern const char* COLOR_DEBUG;
@@ -57,13 +201,26 @@ extern const char* COLOR_RESET;
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wgnu-zero-variadic-macro-arguments"
 
-#define log_trace(...) global_logger.log(LogLevel::Trace, ##__VA_ARGS__);
-#define log_debug(...) global_logger.log(LogLevel::Debug, ##__VA_ARGS__);
-#define log_unimplemented(...) global_logger.log(LogLevel::Unimplemented, ##__VA_ARGS__);
-#define log_info(...) global_logger.log(LogLevel::Info, ##__VA_ARGS__);
-#define log_warn(...) global_logger.log(LogLevel::Warning, ##__VA_ARGS__);
-#define log_error(...) global_logger.log(LogLevel::Error, ##__VA_ARGS__);
+#define log_at_level(level, ...) \
+    do { if (global_logger.should_log(level)) { global_logger.log(level, ##__VA_ARGS__); } } while (0)
+
+/* Trace logging is compiled out of builds without GBEMU_TRACE */
+#ifdef GBEMU_TRACE
+#define log_trace(...) log_at_level(LogLevel::Trace, ##__VA_ARGS__);
+#else
+#define log_trace(...) do {} while (0);
+#endif
+
+#define log_debug(...) log_at_level(LogLevel::Debug, ##__VA_ARGS__);
+#define log_unimplemented(...) log_at_level(LogLevel::Unimplemented, ##__VA_ARGS__);
+#define log_info(...) log_at_level(LogLevel::Info, ##__VA_ARGS__);
+#define log_warn(...) log_at_level(LogLevel::Warning, ##__VA_ARGS__);
+#define log_error(...) log_at_level(LogLevel::Error, ##__VA_ARGS__);
 
 #pragma clang diagnostic pop
 
 extern void log_set_level(LogLevel level);
+
+/* Called before writing to stdout directly, so that the output isn't
+ * interleaved with log messages from before it */
+extern void log_flush();
@@ -8,88 +8,122 @@
 
 using bitwise::check_bit;
 
-Video::Video(CPU& inCPU, MMU& inMMU, Options& inOptions) :
+Video::Video(CPU& inCPU, MMU& inMMU, IoBus& io, Scheduler& inScheduler, Options& inOptions) :
     cpu(inCPU),
     mmu(inMMU),
+    scheduler(inScheduler),
     buffer(GAMEBOY_WIDTH, GAMEBOY_HEIGHT),
     background_map(BG_MAP_SIZE, BG_MAP_SIZE)
 {
-}
+    auto map_register = [&io](u16 address, ByteRegister& reg, u8 read_mask = 0xFF, u8 write_mask = 0xFF) {
+        io.map_handlers(address, [&reg]() { return reg.value(); }, [&reg](u8 byte) { reg.set(byte); }, read_mask, write_mask);
+    };
+
+    io.map_handlers(0xFF40, [this]() { return control_byte; }, [this](u8 byte) { control_byte = byte; });
+
+    /* Bits 0-2 (the mode and coincidence flag) belong to the PPU */
+    map_register(0xFF41, lcd_status, 0x7F, 0x78);
+
+    map_register(0xFF42, scroll_y);
+    map_register(0xFF43, scroll_x);
+
+    /* "Writing will reset the counter" */
+    io.map_handlers(0xFF44, [this]() { return line.value(); }, [this](u8) { line.set(0x0); });
+
+    map_register(0xFF45, ly_compare);
+
+    io.map_handlers(0xFF47, [this]() { return bg_palette.value(); }, [this](u8 byte) {
+        bg_palette.set(byte);
+        log_trace("Set video palette: 0x%x", byte);
+    });
+
+    io.map_handlers(0xFF48, [this]() { return sprite_palette_0.value(); }, [this](u8 byte) {
+        sprite_palette_0.set(byte);
+        log_trace("Set sprite palette 0: 0x%x", byte);
+    });
+
+    io.map_handlers(0xFF49, [this]() { return sprite_palette_1.value(); }, [this](u8 byte) {
+        sprite_palette_1.set(byte);
+        log_trace("Set sprite palette 1: 0x%x", byte);
+    });
 
-void Video::tick(Cycles cycles) {
-    cycle_counter += cycles.cycles;
+    map_register(0xFF4A, window_y);
+    map_register(0xFF4B, window_x);
 
+    scheduler.schedule(Event::VideoMode, mode_length());
+}
+
+void Video::advance_mode() {
     switch (current_mode) {
         case VideoMode::ACCESS_OAM:
-            if (cycle_counter >= CLOCKS_PER_SCANLINE_OAM) {
-                cycle_counter = cycle_counter % CLOCKS_PER_SCANLINE_OAM;
-                lcd_status.set_bit_to(1, 1);
-                lcd_status.set_bit_to(0, 1);
-                current_mode = VideoMode::ACCESS_VRAM;
-            }
+            lcd_status.set_bit_to(1, 1);
+            lcd_status.set_bit_to(0, 1);
+            current_mode = VideoMode::ACCESS_VRAM;
             break;
-        case VideoMode::ACCESS_VRAM:
-            if (cycle_counter >= CLOCKS_PER_SCANLINE_VRAM) {
-                cycle_counter = cycle_counter % CLOCKS_PER_SCANLINE_VRAM;
-                current_mode = VideoMode::HBLANK;
-
-                bool hblank_interrupt = bitwise::check_bit(lcd_status.value(), 3);
+        case VideoMode::ACCESS_VRAM: {
+            current_mode = VideoMode::HBLANK;
 
-                if (hblank_interrupt) {
-                    cpu.interrupt_flag.set_bit_to(1, true);
-                }
+            bool hblank_interrupt = bitwise::check_bit(lcd_status.value(), 3);
 
-                bool ly_coincidence_interrupt = bitwise::check_bit(lcd_status.value(), 6);
-                bool ly_coincidence = ly_compare.value() == line.value();
-                if (ly_coincidence_interrupt && ly_coincidence) {
-                    cpu.interrupt_flag.set_bit_to(1, true);
-                }
-                lcd_status.set_bit_to(2, ly_coincidence);
+            if (hblank_interrupt) {
+                cpu.interrupts.request(Interrupt::LcdStatus);
+            }
 
-                lcd_status.set_bit_to(1, 0);
-                lcd_status.set_bit_to(0, 0);
+            bool ly_coincidence_interrupt = bitwise::check_bit(lcd_status.value(), 6);
+            bool ly_coincidence = ly_compare.value() == line.value();
+            if (ly_coincidence_interrupt && ly_coincidence) {
+                cpu.interrupts.request(Interrupt::LcdStatus);
             }
+            lcd_status.set_bit_to(2, ly_coincidence);
+
+            lcd_status.set_bit_to(1, 0);
+            lcd_status.set_bit_to(0, 0);
             break;
+        }
         case VideoMode::HBLANK:
-            if (cycle_counter >= CLOCKS_PER_HBLANK) {
-
-                write_scanline(line.value());
-                line.increment();
-
-                cycle_counter = cycle_counter % CLOCKS_PER_HBLANK;
-
-                /* Line 145 (index 144) is the first line of VBLANK */
-                if (line == 144) {
-                    current_mode = VideoMode::VBLANK;
-                    lcd_status.set_bit_to(1, 0);
-                    lcd_status.set_bit_to(0, 1);
-                    cpu.interrupt_flag.set_bit_to(0, true);
-                } else {
-                    lcd_status.set_bit_to(1, 1);
-                    lcd_status.set_bit_to(0, 0);
-                    current_mode = VideoMode::ACCESS_OAM;
-                }
+            write_scanline(line.value());
+            line.increment();
+
+            /* Line 145 (index 144) is the first line of VBLANK */
+            if (line == 144) {
+                current_mode = VideoMode::VBLANK;
+                lcd_status.set_bit_to(1, 0);
+                lcd_status.set_bit_to(0, 1);
+                cpu.interrupts.request(Interrupt::VBlank);
+            } else {
+                lcd_status.set_bit_to(1, 1);
+                lcd_status.set_bit_to(0, 0);
+                current_mode = VideoMode::ACCESS_OAM;
             }
             break;
         case VideoMode::VBLANK:
-            if (cycle_counter >= CLOCKS_PER_SCANLINE) {
-                line.increment();
-
-                cycle_counter = cycle_counter % CLOCKS_PER_SCANLINE;
-
-                /* Line 155 (index 154) is the last line */
-                if (line == 154) {
-                    write_sprites();
-                    draw();
-                    buffer.reset();
-                    line.reset();
-                    current_mode = VideoMode::ACCESS_OAM;
-                    lcd_status.set_bit_to(1, 1);
-                    lcd_status.set_bit_to(0, 0);
-                };
-            }
+            line.increment();
+
+            /* Line 155 (index 154) is the last line */
+            if (line == 154) {
+                write_sprites();
+                draw();
+                buffer.reset();
+                line.reset();
+                current_mode = VideoMode::ACCESS_OAM;
+                lcd_status.set_bit_to(1, 1);
+                lcd_status.set_bit_to(0, 0);
+            };
             break;
     }
+
+    scheduler.reschedule(Event::VideoMode, mode_length());
+}
+
+uint Video::mode_length() const {
+    switch (current_mode) {
+        case VideoMode::ACCESS_OAM: return CLOCKS_PER_SCANLINE_OAM;
+        case VideoMode::ACCESS_VRAM: return CLOCKS_PER_SCANLINE_VRAM;
+        case VideoMode::HBLANK: return CLOCKS_PER_HBLANK;
+        case VideoMode::VBLANK: return CLOCKS_PER_SCANLINE;
+    }
+
+    return CLOCKS_PER_SCANLINE;
 }
 
 bool Video::display_enabled() const { return check_bit(control_byte, 7); }
@@ -163,7 +197,7 @@ void Video::draw_bg_line(uint current_line) {
         Address tile_id_address = tile_map_address + tile_index;
 
         /* Grab the ID of the tile we'll get data from in the tile map */
-        u8 tile_id = mmu.read(tile_id_address);
+        u8 tile_id = mmu.read_video_memory(tile_id_address);
 
         /* Calculate the offset from the start of the tile data memory where
          * the data for our tile lives */
@@ -181,8 +215,8 @@ void Video::draw_bg_line(uint current_line) {
         /* FIXME: We fetch the full line of pixels for each pixel in the tile
          * we render. This could be altered to work in a way that avoids re-fetching
          * for a more performant renderer */
-        u8 pixels_1 = mmu.read(tile_line_data_start_address);
-        u8 pixels_2 = mmu.read(tile_line_data_start_address + 1);
+        u8 pixels_1 = mmu.read_video_memory(tile_line_data_start_address);
+        u8 pixels_2 = mmu.read_video_memory(tile_line_data_start_address + 1);
 
         GBColor pixel_color = get_pixel_from_line(pixels_1, pixels_2, tile_pixel_x);
         Color screen_color = get_color_from_palette(pixel_color, palette);
@@ -230,7 +264,7 @@ void Video::draw_window_line(uint current_line) {
         Address tile_id_address = tile_map_address + tile_index;
 
         /* Grab the ID of the tile we'll get data from in the tile map */
-        u8 tile_id = mmu.read(tile_id_address);
+        u8 tile_id = mmu.read_video_memory(tile_id_address);
 
         /* Calculate the offset from the start of the tile data memory where
          * the data for our tile lives */
@@ -248,8 +282,8 @@ void Video::draw_window_line(uint current_line) {
         /* FIXME: We fetch the full line of pixels for each pixel in the tile
          * we render. This could be altered to work in a way that avoids re-fetching
          * for a more performant renderer */
-        u8 pixels_1 = mmu.read(tile_line_data_start_address);
-        u8 pixels_2 = mmu.read(tile_line_data_start_address + 1);
+        u8 pixels_1 = mmu.read_video_memory(tile_line_data_start_address);
+        u8 pixels_2 = mmu.read_video_memory(tile_line_data_start_address + 1);
 
         GBColor pixel_color = get_pixel_from_line(pixels_1, pixels_2, tile_pixel_x);
         Color screen_color = get_color_from_palette(pixel_color, palette);
@@ -265,8 +299,8 @@ void Video::draw_sprite(const uint sprite_n) {
     Address offset_in_oam = sprite_n * SPRITE_BYTES;
 
     Address oam_start = 0xFE00 + offset_in_oam.value();
-    u8 sprite_y = mmu.read(oam_start);
-    u8 sprite_x = mmu.read(oam_start + 1);
+    u8 sprite_y = mmu.read_video_memory(oam_start);
+    u8 sprite_x = mmu.read_video_memory(oam_start + 1);
 
     /* If the sprite would be drawn offscreen, don't draw it */
     if (sprite_y == 0 || sprite_y >= 160) { return; }
@@ -278,8 +312,8 @@ void Video::draw_sprite(const uint sprite_n) {
     /* Sprites are always taken from the first tileset */
     Address tile_set_location = TILE_SET_ZERO_ADDRESS;
 
-    u8 pattern_n = mmu.read(oam_start + 2);
-    u8 sprite_attrs = mmu.read(oam_start + 3);
+    u8 pattern_n = mmu.read_video_memory(oam_start + 2);
+    u8 sprite_attrs = mmu.read_video_memory(oam_start + 3);
 
     /* Bits 0-3 are used only for CGB */
     bool use_palette_1 = check_bit(sprite_attrs, 4);
@@ -6,7 +6,9 @@
 #include "../mmu.h"
 #include "../register.h"
 #include "../definitions.h"
+#include "../io_bus.h"
 #include "../options.h"
+#include "../scheduler.h"
 
 #include <vector>
 #include <memory>
@@ -28,9 +30,12 @@ struct TileInfo {
 
 class Video {
 public:
-    Video(CPU& inCPU, MMU& inMMU, Options& inOptions);
+    Video(CPU& inCPU, MMU& inMMU, IoBus& io, Scheduler& inScheduler, Options& inOptions);
+
+    /* Handles Event::VideoMode: moves on to the next mode (or the next line
+     * of VBLANK) and schedules the change after it */
+    void advance_mode();
 
-    void tick(Cycles cycles);
     void register_vblank_callback(const vblank_callback_t& _vblank_callback);
 
     u8 control_byte;
@@ -89,15 +94,19 @@ private:
     Palette load_palette(ByteRegister& palette_register) const;
     Color get_color_from_palette(GBColor color, const Palette& palette);
 
+    uint mode_length() const;
+
     CPU& cpu;
     MMU& mmu;
+    Scheduler& scheduler;
     FrameBuffer buffer;
     FrameBuffer background_map;
 
     VideoMode current_mode = VideoMode::ACCESS_OAM;
-    uint cycle_counter = 0;
 
     vblank_callback_t vblank_callback;
+
+    friend class Lockstep;
 };
 
 const uint CLOCKS_PER_HBLANK = 204; /* Mode 0 */